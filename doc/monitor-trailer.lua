@@ -0,0 +1,69 @@
+--[[
+	Wireshark dissector for the trailers the ethernet-tap can append to frames on its monitor ports
+
+	Install by copying into the Wireshark personal plugins directory (Help -> About -> Folders), or run
+	    tshark -X lua_script:monitor-trailer.lua ...
+
+	Trailer layout, from the last byte of the frame backwards (FCS is not included; capture NICs strip it):
+
+	    ... original frame, possibly truncated ...
+	    [2 bytes]  original length in bytes, big endian, not counting FCS   ("monitor snaplen ... trailer")
+	    [8 bytes]  arrival time, nanoseconds, big endian                      ("monitor timestamp")
+	    [1 byte]   direction: 0 = received on porta, 1 = received on portb    ("monitor tag trailer")
+
+	Each field is only there if enabled, and nothing in the frame says which ones are, so set the preferences under
+	Protocols -> TAPTRAILER to match the tap configuration ("show monitor" on the tap CLI).
+
+	Arrival time is sampled when the MAC sees the start of frame delimiter, with 8 ns resolution. The counter runs from
+	whatever "clock set" loaded, normally seconds since the Unix epoch.
+
+	The 802.1Q direction tag ("monitor tag vlan") is ordinary VLAN tagging and needs no help from this script.
+ ]]
+
+local p_tap = Proto("taptrailer", "Ethernet tap monitor trailer")
+
+local f_origlen		= ProtoField.uint16("taptrailer.origlen", "Original length", base.DEC)
+local f_timestamp	= ProtoField.absolute_time("taptrailer.timestamp", "Arrival time", base.UTC)
+local f_timestamp_ns	= ProtoField.uint64("taptrailer.timestamp_ns", "Arrival time (ns)", base.DEC)
+local f_direction	= ProtoField.uint8("taptrailer.direction", "Received on", base.DEC,
+	{ [0] = "porta", [1] = "portb" })
+p_tap.fields = { f_origlen, f_timestamp, f_timestamp_ns, f_direction }
+
+p_tap.prefs.origlen		= Pref.bool("Original length present", false, "monitor snaplen ... trailer")
+p_tap.prefs.timestamp	= Pref.bool("Arrival timestamp present", true, "monitor timestamp")
+p_tap.prefs.direction	= Pref.bool("Direction byte present", false, "monitor tag trailer")
+
+function p_tap.dissector(tvb, pinfo, tree)
+
+	local len = 0
+	if p_tap.prefs.origlen then len = len + 2 end
+	if p_tap.prefs.timestamp then len = len + 8 end
+	if p_tap.prefs.direction then len = len + 1 end
+	if len == 0 or tvb:len() < len + 14 then
+		return
+	end
+
+	local off = tvb:len() - len
+	local subtree = tree:add(p_tap, tvb(off, len))
+
+	if p_tap.prefs.origlen then
+		subtree:add(f_origlen, tvb(off, 2))
+		off = off + 2
+	end
+
+	if p_tap.prefs.timestamp then
+		local ns = tvb(off, 8):uint64()
+		local secs = (ns / 1000000000):tonumber()
+		local frac = (ns % 1000000000):tonumber()
+		subtree:add(f_timestamp, tvb(off, 8), NSTime.new(secs, frac))
+		subtree:add(f_timestamp_ns, tvb(off, 8))
+		off = off + 8
+	end
+
+	if p_tap.prefs.direction then
+		subtree:add(f_direction, tvb(off, 1))
+	end
+
+end
+
+register_postdissector(p_tap)
@@ -0,0 +1,82 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "ethernet-tap.h"
+#include "BackgroundJob.h"
+
+/**
+	@brief The job currently running, if any
+ */
+static BackgroundJob* g_activeJob = nullptr;
+
+/**
+	@brief Starts a job
+
+	@return False if another job is already running
+ */
+bool StartBackgroundJob(BackgroundJob* job)
+{
+	if(g_activeJob)
+		return false;
+
+	g_activeJob = job;
+	SchedulerWake(g_taskTable[TASK_BACKGROUND]);
+	return true;
+}
+
+bool IsBackgroundJobRunning()
+{
+	return (g_activeJob != nullptr);
+}
+
+/**
+	@brief Asks the running job (if any) to stop early
+ */
+void AbortBackgroundJob()
+{
+	if(g_activeJob)
+		g_activeJob->Abort();
+}
+
+/**
+	@brief Runs one step of the active job
+
+	@return True if the job finished during this call
+ */
+bool RunBackgroundJob()
+{
+	if(!g_activeJob)
+		return false;
+
+	if(g_activeJob->Step())
+		return false;
+
+	g_activeJob = nullptr;
+	return true;
+}
@@ -0,0 +1,71 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of BackgroundJob
+ */
+#ifndef BackgroundJob_h
+#define BackgroundJob_h
+
+/**
+	@brief A long running operation that is broken up into short steps and run from the main loop
+
+	Each call to Step() should do a small amount of work (typically queue some asynchronous PHY accesses, or check
+	whether the ones it queued last time have completed) and return right away, so the rest of the firmware keeps
+	running while the job is in progress.
+
+	Only one job runs at a time. The CLI prompt is held back until it finishes.
+ */
+class BackgroundJob
+{
+public:
+	virtual ~BackgroundJob()
+	{}
+
+	/**
+		@brief Runs the next step of the job
+
+		@return True if there is more work to do, false once the job has finished
+	 */
+	virtual bool Step() =0;
+
+	/**
+		@brief Requests that the job stop early. It should clean up and finish on a subsequent Step() call.
+	 */
+	virtual void Abort()
+	{}
+};
+
+bool StartBackgroundJob(BackgroundJob* job);
+bool IsBackgroundJobRunning();
+void AbortBackgroundJob();
+bool RunBackgroundJob();
+
+#endif
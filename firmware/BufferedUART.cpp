@@ -0,0 +1,122 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "ethernet-tap.h"
+#include "BufferedUART.h"
+
+BufferedUART::BufferedUART(volatile usart_t* lane, uint32_t baud_div)
+	: UART(lane, baud_div)
+	, m_highWaterMark(0)
+	, m_stalls(0)
+	, m_txBytes(0)
+	, m_lane(lane)
+{
+}
+
+/**
+	@brief Checks if the TXE interrupt will be able to drain the buffer
+
+	Not the case from inside an exception handler or with interrupts masked.
+ */
+bool ITCM_CODE BufferedUART::CanUseInterrupts()
+{
+	return InterruptsAvailable();
+}
+
+void ITCM_CODE BufferedUART::EnableTxInterrupt()
+{
+	m_lane->CR1 |= USART_CR1_TXEIE;
+}
+
+uint32_t BufferedUART::GetBufferedBytes() const
+{
+	return m_txBuffer.size();
+}
+
+/**
+	@brief Queues a byte for transmission
+ */
+void ITCM_CODE BufferedUART::PrintBinary(char ch)
+{
+	if(!CanUseInterrupts())
+	{
+		BlockingFlush();
+		while(0 == (m_lane->ISR & USART_ISR_TXE))
+		{}
+		m_lane->TDR = ch;
+		m_txBytes ++;
+		return;
+	}
+
+	//Buffer full? Wait for the ISR to make room
+	if(!m_txBuffer.Push(ch))
+	{
+		m_stalls ++;
+		EnableTxInterrupt();
+		while(!m_txBuffer.Push(ch))
+		{}
+	}
+	EnableTxInterrupt();
+
+	uint32_t depth = m_txBuffer.size();
+	if(depth > m_highWaterMark)
+		m_highWaterMark = depth;
+}
+
+/**
+	@brief Moves the next byte to the hardware. Called from the UART ISR.
+ */
+void ITCM_CODE BufferedUART::OnIRQTxEmpty()
+{
+	char ch;
+	if(m_txBuffer.Pop(ch))
+	{
+		m_lane->TDR = ch;
+		m_txBytes ++;
+	}
+
+	//Nothing left to send, stop interrupting
+	else
+		m_lane->CR1 &= ~USART_CR1_TXEIE;
+}
+
+/**
+	@brief Sends everything in the buffer by polling, without relying on interrupts
+ */
+void BufferedUART::BlockingFlush()
+{
+	char ch;
+	while(m_txBuffer.Pop(ch))
+	{
+		while(0 == (m_lane->ISR & USART_ISR_TXE))
+		{}
+		m_lane->TDR = ch;
+		m_txBytes ++;
+	}
+}
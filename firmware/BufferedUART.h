@@ -0,0 +1,80 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of BufferedUART
+ */
+#ifndef BufferedUART_h
+#define BufferedUART_h
+
+#include <peripheral/UART.h>
+#include "SPSCQueue.h"
+
+//Size of the console transmit buffer
+#define UART_TX_BUFFER_SIZE 4096
+
+/**
+	@brief UART with an interrupt-driven transmit ring buffer
+
+	PrintBinary() only copies into the buffer. The TXE interrupt moves bytes out to the hardware.
+	If the buffer fills up, the caller waits for space (and the stall is counted) rather than losing output.
+
+	From fault handlers, or anywhere else interrupts can't run, output falls back to polled mode.
+ */
+class BufferedUART : public UART
+{
+public:
+	BufferedUART(volatile usart_t* lane, uint32_t baud_div);
+
+	virtual void PrintBinary(char ch);
+
+	void OnIRQTxEmpty();
+	void BlockingFlush();
+
+	uint32_t GetBufferedBytes() const;
+
+	///@brief Largest number of bytes ever waiting in the buffer
+	uint32_t m_highWaterMark;
+
+	///@brief Number of times a writer had to wait for the buffer to drain
+	uint32_t m_stalls;
+
+	///@brief Total bytes sent
+	uint32_t m_txBytes;
+
+protected:
+	bool CanUseInterrupts();
+	void EnableTxInterrupt();
+
+	volatile usart_t* m_lane;
+	SPSCQueue<char, UART_TX_BUFFER_SIZE> m_txBuffer;
+};
+
+#endif
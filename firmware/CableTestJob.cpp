@@ -0,0 +1,474 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "ethernet-tap.h"
+#include "CableTestJob.h"
+
+//Minimum and maximum number of tests to average per pair.
+//We stop early once the minimum is reached if every run agrees.
+static const int g_cableTestMinAverages = 3;
+static const int g_cableTestMaxAverages = 10;
+
+//Runs "agree" if the fault type matches and distances are within this many 4ns steps of each other
+static const int g_cableTestConvergence = 1;
+
+//Number of times to poll for test completion before giving up (10 ticks apart, so 50 ms)
+static const int g_cableTestMaxPolls = 50;
+
+//Print a progress line this often while tests are running (1 second)
+static const uint32_t g_cableTestProgressInterval = 10000;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CableTestPort
+
+CableTestPort::CableTestPort()
+	: m_state(STATE_DONE)
+	, m_iface(0)
+	, m_pending(0)
+	, m_nunsent(0)
+	, m_mdioError(false)
+	, m_nvalues(0)
+	, m_pair(0)
+	, m_polls(0)
+	, m_pollTime(0)
+{
+	for(int i=0; i<3; i++)
+		m_saved[i] = 0;
+}
+
+void CableTestPort::Start(int iface)
+{
+	m_iface = iface;
+	m_pending = 0;
+	m_nunsent = 0;
+	m_mdioError = false;
+	m_nvalues = 0;
+	m_pair = 0;
+
+	for(auto& r : m_results)
+	{
+		r.runs = 0;
+		r.faultType = 0;
+		r.faultMismatch = false;
+		r.distSum = 0;
+		r.distMin = 0;
+		r.distMax = 0;
+		r.done = false;
+	}
+
+	//Save the old values for a few registers so we can restore them afterwards
+	Read(PHY_REG_BASIC_CONTROL);
+	Read(PHY_REG_MDIX);
+	Read(PHY_REG_GIG_CONTROL);
+	m_state = STATE_SAVE;
+}
+
+int CableTestPort::GetPairsDone() const
+{
+	int n = 0;
+	for(auto& r : m_results)
+	{
+		if(r.done)
+			n ++;
+	}
+	return n;
+}
+
+void CableTestPort::OnReadDone(void* param, bool ok, uint16_t value)
+{
+	auto port = reinterpret_cast<CableTestPort*>(param);
+	port->m_values[port->m_nvalues ++] = value;
+	port->m_pending --;
+	if(!ok)
+		port->m_mdioError = true;
+}
+
+void CableTestPort::OnWriteDone(void* param, bool ok, uint16_t /*value*/)
+{
+	auto port = reinterpret_cast<CableTestPort*>(param);
+	port->m_pending --;
+	if(!ok)
+		port->m_mdioError = true;
+}
+
+void CableTestPort::Read(uint8_t regid)
+{
+	Send(regid, 0, false);
+}
+
+void CableTestPort::Write(uint8_t regid, uint16_t value)
+{
+	Send(regid, value, true);
+}
+
+/**
+	@brief Queues a request, or holds on to it for the next Step() if the async queue is full
+
+	The queue is shared with everything else using the MDIO bus, so it can fill up under us.
+ */
+void CableTestPort::Send(uint8_t regid, uint16_t value, bool write)
+{
+	//Anything already waiting has to go first
+	if(m_nunsent == 0)
+	{
+		bool ok = write ?
+			PhyAsyncWrite(m_iface, regid, value, OnWriteDone, this) :
+			PhyAsyncRead(m_iface, regid, OnReadDone, this);
+		if(ok)
+		{
+			m_pending ++;
+			return;
+		}
+	}
+
+	auto& req = m_unsent[m_nunsent ++];
+	req.regid = regid;
+	req.value = value;
+	req.write = write;
+}
+
+/**
+	@brief Retries requests that didn't fit in the async queue, in order
+
+	@return True if they all went out
+ */
+bool CableTestPort::SendUnsent()
+{
+	int nsent = 0;
+	for(; nsent < m_nunsent; nsent ++)
+	{
+		auto& req = m_unsent[nsent];
+		bool ok = req.write ?
+			PhyAsyncWrite(m_iface, req.regid, req.value, OnWriteDone, this) :
+			PhyAsyncRead(m_iface, req.regid, OnReadDone, this);
+		if(!ok)
+			break;
+		m_pending ++;
+	}
+
+	for(int i=nsent; i<m_nunsent; i++)
+		m_unsent[i - nsent] = m_unsent[i];
+	m_nunsent -= nsent;
+
+	return (m_nunsent == 0);
+}
+
+/**
+	@brief Moves on to the next pair that still needs testing, round robin
+
+	@return False if every pair is done
+ */
+bool CableTestPort::NextPair()
+{
+	for(int i=1; i<=4; i++)
+	{
+		int pair = (m_pair + i) % 4;
+		if(!m_results[pair].done)
+		{
+			m_pair = pair;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+	@brief Adds one LinkMD result to the current pair, and decides if we've seen enough
+ */
+void CableTestPort::AddResult(uint16_t result)
+{
+	auto& r = m_results[m_pair];
+
+	int faultcode = (result >> 8) & 3;
+	int rawDistance = (result & 0xff) - 13;
+	if(rawDistance < 0)
+		rawDistance = 0;
+
+	if(r.runs == 0)
+	{
+		r.faultType = faultcode;
+		r.distMin = rawDistance;
+		r.distMax = rawDistance;
+	}
+	else
+	{
+		//Report a fault if any of the runs was a failure
+		if(faultcode != r.faultType)
+		{
+			r.faultMismatch = true;
+			if(faultcode != 0)
+				r.faultType = faultcode;
+		}
+		if(rawDistance < r.distMin)
+			r.distMin = rawDistance;
+		if(rawDistance > r.distMax)
+			r.distMax = rawDistance;
+	}
+	r.distSum += rawDistance;
+	r.runs ++;
+
+	if(r.runs >= g_cableTestMaxAverages)
+		r.done = true;
+	else if( (r.runs >= g_cableTestMinAverages) && !r.faultMismatch &&
+		( (r.faultType == 0) || ( (r.distMax - r.distMin) <= g_cableTestConvergence) ) )
+	{
+		r.done = true;
+	}
+}
+
+/**
+	@brief Runs the next step of the test on this port
+
+	@return True if there is more work to do
+ */
+bool CableTestPort::Step(bool abort)
+{
+	//Nothing to do until all outstanding requests have gone out and completed
+	if(!SendUnsent() || m_pending)
+		return true;
+
+	//Stop between steps if asked to, or if the PHY stopped answering
+	if(m_mdioError)
+		abort = true;
+	if(abort && (m_state != STATE_SAVE) && (m_state != STATE_RESTORE) && (m_state != STATE_DONE) )
+	{
+		StartRestore();
+		return true;
+	}
+
+	switch(m_state)
+	{
+		//Configure for testing
+		//Need to have speed forced to 1000baseT, no negotiation, slave mode, no auto mdix
+		//Reference: https://microchipsupport.force.com/s/article/How-to-test-the-4-differential-pairs-between-KSZ9031-Gigabit-Ethernet-PHY-and-RJ-45-connector-for-opens-and-shorts
+		case STATE_SAVE:
+			for(int i=0; i<3; i++)
+				m_saved[i] = m_values[i];
+			m_nvalues = 0;
+
+			//Nothing has been changed yet, and if a read failed we don't know what to put back
+			if(abort)
+			{
+				m_state = STATE_DONE;
+				return false;
+			}
+
+			Write(PHY_REG_BASIC_CONTROL, 0x0140);
+			Write(PHY_REG_MDIX, 0x0040);
+			Write(PHY_REG_GIG_CONTROL, 0x1000);
+			m_state = STATE_CONFIGURE;
+			break;
+
+		case STATE_CONFIGURE:
+			m_state = STATE_START_TEST;
+			break;
+
+		//Request a test of this pair
+		case STATE_START_TEST:
+			Write(PHY_REG_LINKMD, 0x8000 | (m_pair << 12) );
+			m_polls = 0;
+			m_pollTime = g_logTimer->GetCount();
+			m_state = STATE_WAIT_POLL;
+			break;
+
+		//Poll every 10 ticks until the test completes
+		case STATE_WAIT_POLL:
+			if( (g_logTimer->GetCount() - m_pollTime) < 10)
+				break;
+			m_nvalues = 0;
+			m_polls ++;
+			m_pollTime = g_logTimer->GetCount();
+			Read(PHY_REG_LINKMD);
+			m_state = STATE_CHECK;
+			break;
+
+		case STATE_CHECK:
+			{
+				uint16_t result = m_values[0];
+
+				//Still running? Check again later, unless we've been waiting too long
+				if( (result & 0x8000) && (m_polls < g_cableTestMaxPolls) )
+				{
+					m_state = STATE_WAIT_POLL;
+					break;
+				}
+
+				AddResult(result);
+
+				if(NextPair())
+					m_state = STATE_START_TEST;
+				else
+					StartRestore();
+			}
+			break;
+
+		case STATE_RESTORE:
+			m_state = STATE_DONE;
+			return false;
+
+		case STATE_DONE:
+		default:
+			return false;
+	}
+
+	return true;
+}
+
+/**
+	@brief Puts the original mode register values back
+ */
+void CableTestPort::StartRestore()
+{
+	Write(PHY_REG_BASIC_CONTROL, m_saved[0]);
+	Write(PHY_REG_MDIX, m_saved[1]);
+	Write(PHY_REG_GIG_CONTROL, m_saved[2]);
+	m_state = STATE_RESTORE;
+}
+
+void CableTestPort::Report(CLIOutputStream* stream)
+{
+	stream->Printf("Interface %s:\n", g_portDescriptions[m_iface]);
+	if(m_mdioError)
+		stream->Printf("MDIO timeout, test stopped early\n");
+	stream->Printf("Local pair     Status      Length (ns)        Length (m)    Runs\n");
+	for(int pair=0; pair<4; pair++)
+	{
+		auto& r = m_results[pair];
+		if(!r.done)
+			stream->Printf("%c              Not tested\n", 'A' + pair);
+		else if(r.faultType == 0)
+			stream->Printf("%c              Normal              N/A               N/A    %4d\n", 'A' + pair, r.runs);
+		else
+		{
+			int oneWayNs = (r.distSum * 4 / r.runs);
+			int cableCm = 21 * oneWayNs;
+
+			stream->Printf("%c              %-5s               %3d            %3d.%02d    %4d\n",
+				'A' + pair,
+				(r.faultType == 1) ? "Open" : "Short",
+				oneWayNs,
+				cableCm / 100,
+				cableCm % 100,
+				r.runs
+				);
+		}
+	}
+	stream->Flush();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CableTestJob
+
+CableTestJob::CableTestJob()
+	: m_stream(nullptr)
+	, m_portmask(0)
+	, m_reported(0)
+	, m_aborted(false)
+	, m_lastProgress(0)
+{
+}
+
+/**
+	@brief Sets up the job. Call StartBackgroundJob() to actually run it.
+ */
+void CableTestJob::Start(CLIOutputStream* stream, uint8_t portmask)
+{
+	m_stream = stream;
+	m_portmask = portmask;
+	m_reported = 0;
+	m_aborted = false;
+	m_lastProgress = g_logTimer->GetCount();
+
+	m_stream->Printf("Running TDR cable test on interface");
+	for(int i=0; i<4; i++)
+	{
+		if(portmask & (1 << i))
+		{
+			m_stream->Printf(" %s", g_portDescriptions[i]);
+			m_ports[i].Start(i);
+		}
+	}
+	m_stream->Printf("\n");
+	m_stream->Printf("Uncertainty: +/- 4ns or 0.85m\n");
+	m_stream->Flush();
+}
+
+void CableTestJob::Abort()
+{
+	m_aborted = true;
+}
+
+bool CableTestJob::Step()
+{
+	bool busy = false;
+	for(int i=0; i<4; i++)
+	{
+		if(!(m_portmask & (1 << i)))
+			continue;
+
+		if(m_ports[i].Step(m_aborted))
+			busy = true;
+
+		//Report each port as soon as it's done, unless we were cut short
+		else if(!(m_reported & (1 << i)))
+		{
+			m_reported |= (1 << i);
+			if(!m_aborted)
+				m_ports[i].Report(m_stream);
+		}
+	}
+
+	if(!busy)
+	{
+		if(m_aborted)
+			m_stream->Printf("Aborted\n");
+		return false;
+	}
+
+	//Let the user know we're still alive during long tests
+	if( (g_logTimer->GetCount() - m_lastProgress) >= g_cableTestProgressInterval)
+	{
+		m_lastProgress = g_logTimer->GetCount();
+
+		int done = 0;
+		int total = 0;
+		for(int i=0; i<4; i++)
+		{
+			if(m_portmask & (1 << i))
+			{
+				done += m_ports[i].GetPairsDone();
+				total += 4;
+			}
+		}
+		m_stream->Printf("%d of %d pairs complete\n", done, total);
+		m_stream->Flush();
+	}
+
+	return true;
+}
@@ -0,0 +1,158 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of CableTestJob
+ */
+#ifndef CableTestJob_h
+#define CableTestJob_h
+
+#include <embedded-cli/CLIOutputStream.h>
+#include "BackgroundJob.h"
+
+/**
+	@brief LinkMD TDR test of all four pairs on one interface
+
+	Each interface has its own MDIO bus, so one of these runs per port in parallel. The PHY can only test one pair at
+	a time, so pairs take turns: each pass over the pairs runs one more test on every pair that hasn't converged yet.
+ */
+class CableTestPort
+{
+public:
+	CableTestPort();
+
+	void Start(int iface);
+	bool Step(bool abort);
+	void Report(CLIOutputStream* stream);
+
+	bool IsRunning() const
+	{ return m_state != STATE_DONE; }
+
+	int GetPairsDone() const;
+
+protected:
+	static void OnReadDone(void* param, bool ok, uint16_t value);
+	static void OnWriteDone(void* param, bool ok, uint16_t value);
+
+	void Read(uint8_t regid);
+	void Write(uint8_t regid, uint16_t value);
+	void Send(uint8_t regid, uint16_t value, bool write);
+	bool SendUnsent();
+	void StartRestore();
+	bool NextPair();
+	void AddResult(uint16_t result);
+
+	enum state_t
+	{
+		STATE_SAVE,
+		STATE_CONFIGURE,
+		STATE_START_TEST,
+		STATE_WAIT_POLL,
+		STATE_CHECK,
+		STATE_RESTORE,
+		STATE_DONE
+	} m_state;
+
+	int m_iface;
+
+	///@brief Number of asynchronous requests we're waiting on
+	int m_pending;
+
+	/**
+		@brief A request that didn't fit in the async queue
+	 */
+	struct UnsentRequest
+	{
+		uint8_t		regid;
+		uint16_t	value;
+		bool		write;
+	};
+
+	///@brief Requests to retry on the next Step(), in order (no step issues more than three)
+	UnsentRequest m_unsent[3];
+	int m_nunsent;
+
+	///@brief Set if any request timed out
+	bool m_mdioError;
+
+	///@brief Results of asynchronous reads, in the order they were issued
+	uint16_t m_values[4];
+	int m_nvalues;
+
+	///@brief Register values to put back when we're done (basic control, MDI-X, 1000base-T control)
+	uint16_t m_saved[3];
+
+	int m_pair;
+	int m_polls;
+	uint32_t m_pollTime;
+
+	/**
+		@brief Running statistics for one pair
+	 */
+	struct PairResult
+	{
+		int		runs;
+		int		faultType;
+		bool	faultMismatch;
+		int		distSum;
+		int		distMin;
+		int		distMax;
+		bool	done;
+	} m_results[4];
+};
+
+/**
+	@brief Runs LinkMD TDR tests on one or more interfaces, without blocking the main loop
+ */
+class CableTestJob : public BackgroundJob
+{
+public:
+	CableTestJob();
+
+	void Start(CLIOutputStream* stream, uint8_t portmask);
+
+	virtual bool Step();
+	virtual void Abort();
+
+protected:
+	CLIOutputStream* m_stream;
+	uint8_t m_portmask;
+
+	///@brief Ports that have finished and been reported
+	uint8_t m_reported;
+
+	bool m_aborted;
+
+	uint32_t m_lastProgress;
+
+	CableTestPort m_ports[4];
+};
+
+#endif
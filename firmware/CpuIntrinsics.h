@@ -0,0 +1,118 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Wrappers for the few Cortex-M instructions the firmware uses directly
+
+	The host simulator (see sim/) builds with SIMULATION defined and gets plain C++ equivalents instead.
+ */
+#ifndef CpuIntrinsics_h
+#define CpuIntrinsics_h
+
+#include <stdint.h>
+#include "TCM.h"
+
+#ifndef SIMULATION
+
+TCM_INLINE void MaskInterrupts()
+{ asm volatile("cpsid i" ::: "memory"); }
+
+TCM_INLINE void UnmaskInterrupts()
+{ asm volatile("cpsie i" ::: "memory"); }
+
+TCM_INLINE void WaitForInterrupt()
+{ asm volatile("wfi"); }
+
+TCM_INLINE void DataMemoryBarrier()
+{ asm volatile("dmb" ::: "memory"); }
+
+/**
+	@brief Returns true if interrupts can be taken right now (thread mode, PRIMASK clear)
+ */
+TCM_INLINE bool InterruptsAvailable()
+{
+	uint32_t ipsr;
+	uint32_t primask;
+	asm volatile("mrs %[result], IPSR" : [result]"=r"(ipsr));
+	asm volatile("mrs %[result], PRIMASK" : [result]"=r"(primask));
+	return (ipsr == 0) && (primask == 0);
+}
+
+/**
+	@brief Turns on the DWT cycle counter
+ */
+inline void EnableCycleCounter()
+{
+	//TODO: Make a DWT driver for this
+	volatile uint32_t* DEMCR = (volatile uint32_t*)(0xe000edfc);
+	volatile uint32_t* DWT_CTRL = (volatile uint32_t*)(0xe0001000);
+	volatile uint32_t* DWT_CYCCNT = (volatile uint32_t*)(0xe0001004);
+	volatile uint32_t* DWT_LAR = (volatile uint32_t*)(0xe0001fb0);
+	*DEMCR |= 0x01000000;	//TRCENA
+	*DWT_LAR = 0xc5acce55;	//the M7 DWT is locked out of reset
+	*DWT_CYCCNT = 0;
+	*DWT_CTRL |= 1;			//CYCCNTENA
+}
+
+/**
+	@brief Returns the DWT cycle counter. Wraps every 2^32 CPU clocks.
+ */
+TCM_INLINE uint32_t GetCycleCount()
+{ return *(volatile uint32_t*)(0xe0001004); }
+
+#else
+
+#include <atomic>
+
+inline void MaskInterrupts()
+{}
+
+inline void UnmaskInterrupts()
+{}
+
+inline void WaitForInterrupt()
+{}
+
+inline void DataMemoryBarrier()
+{ std::atomic_thread_fence(std::memory_order_seq_cst); }
+
+//There are no interrupts in the simulator, so everything runs in polled mode
+inline bool InterruptsAvailable()
+{ return false; }
+
+inline void EnableCycleCounter()
+{}
+
+//Simulated time in CPU cycles, provided by the simulator
+uint32_t GetCycleCount();
+
+#endif
+
+#endif
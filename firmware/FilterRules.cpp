@@ -0,0 +1,128 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+#include "ethernet-tap.h"
+#include "FilterRules.h"
+
+//All rules start out disabled, matching everything
+FilterRule g_filterRules[FILTER_RULES];
+
+const FilterField g_filterFields[FIELD_COUNT] =
+{
+	{ "dst-mac",	0,	6 },
+	{ "src-mac",	6,	6 },
+	{ "ethertype",	12,	2 },
+	{ "vlan",		14,	2 },
+	{ "protocol",	16,	1 },
+	{ "ip-version",	17,	1 },
+	{ "src-ip",		18,	16 },
+	{ "src-port",	34,	2 },
+	{ "dst-ip",		36,	16 },
+	{ "dst-port",	52,	2 }
+};
+
+const char* g_filterActionNames[4] =
+{
+	"off",
+	"mirror",
+	"drop",
+	"truncate"
+};
+
+//Bytes per row of the FPGA rule table (value, then mask)
+#define FILTER_ROW_SIZE 18
+
+/**
+	@brief Pushes one rule of g_filterRules to the FPGA
+
+	The rule is disabled while its rows are rewritten, so no frame sees half of the old rule and half of the new.
+ */
+void FilterRuleApply(int rule)
+{
+	auto& r = g_filterRules[rule];
+
+	uint8_t buf[2 + 3*2*FILTER_ROW_SIZE];
+	buf[0] = rule;
+	buf[1] = FILTER_OFF;
+	g_qspi->BlockingWrite(REG_FILTER_RULE, 0, buf, 2);
+	if(r.action == FILTER_OFF)
+		return;
+
+	buf[1] = r.action;
+	for(int row=0; row<3; row++)
+	{
+		uint8_t* p = buf + 2 + row*2*FILTER_ROW_SIZE;
+		for(int i=0; i<FILTER_ROW_SIZE; i++)
+		{
+			p[i] = r.value[row*FILTER_ROW_SIZE + i] & r.mask[row*FILTER_ROW_SIZE + i];
+			p[FILTER_ROW_SIZE + i] = r.mask[row*FILTER_ROW_SIZE + i];
+		}
+	}
+	g_qspi->BlockingWrite(REG_FILTER_RULE, 0, buf, sizeof(buf));
+}
+
+/**
+	@brief Latches the hit counters of every rule at once, and reads them back in one burst
+
+	Counters are 32 bits and wrap.
+
+	@return True if the snapshot completed, false if the values returned are stale
+ */
+bool FilterHitsSnapshot(uint32_t hits[2][FILTER_RULES])
+{
+	g_qspi->BlockingWrite8(REG_STATS_SNAPSHOT, 0, 0);
+
+	uint8_t buf[1 + 2*FILTER_RULES*4];
+	for(int i=0; i<5; i++)
+	{
+		g_qspi->BlockingRead(REG_FILTER_HITS, 0, buf, sizeof(buf));
+		if(buf[0] == 0)
+			break;
+	}
+
+	for(int port=0; port<2; port++)
+	{
+		for(int i=0; i<FILTER_RULES; i++)
+		{
+			const uint8_t* p = buf + 1 + (port*FILTER_RULES + i)*4;
+			hits[port][i] = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+		}
+	}
+
+	return (buf[0] == 0);
+}
+
+/**
+	@brief Zeroes the hit counters of every rule
+ */
+void FilterHitsClear()
+{
+	g_qspi->BlockingWrite8(REG_STATS_CLEAR, 0, 0x40);
+}
@@ -0,0 +1,94 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of monitor filter rule access
+ */
+#ifndef FilterRules_h
+#define FilterRules_h
+
+#include <stdint.h>
+#include "MonitorConfig.h"
+
+//Rules in the FPGA table, checked in order
+#define FILTER_RULES 16
+
+//Bytes in a filter key (filterkey_t in the FPGA, big endian)
+#define FILTER_KEY_SIZE 54
+
+//Fields of the filter key
+enum filterfield_t
+{
+	FIELD_DST_MAC,
+	FIELD_SRC_MAC,
+	FIELD_ETHERTYPE,
+	FIELD_VLAN,			//[15] frame is tagged, [11:0] VID
+	FIELD_PROTOCOL,
+	FIELD_IP_VERSION,	//4, 6, or 0 if not IP
+	FIELD_SRC_IP,		//IPv4 addresses are mapped to ::ffff:a.b.c.d
+	FIELD_SRC_PORT,
+	FIELD_DST_IP,
+	FIELD_DST_PORT,
+
+	FIELD_COUNT
+};
+
+/**
+	@brief Location of one field within a filter key
+ */
+struct FilterField
+{
+	const char*	name;
+	uint8_t		offset;
+	uint8_t		len;
+};
+
+/**
+	@brief One rule: matches when (key & mask) == (value & mask)
+
+	The FPGA table is write only, so this is the authoritative copy
+ */
+struct FilterRule
+{
+	filteraction_t	action;
+	uint8_t			value[FILTER_KEY_SIZE];
+	uint8_t			mask[FILTER_KEY_SIZE];
+};
+
+extern FilterRule g_filterRules[FILTER_RULES];
+extern const FilterField g_filterFields[FIELD_COUNT];
+extern const char* g_filterActionNames[4];
+
+void FilterRuleApply(int rule);
+bool FilterHitsSnapshot(uint32_t hits[2][FILTER_RULES]);
+void FilterHitsClear();
+
+#endif
@@ -0,0 +1,159 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+#include "ethernet-tap.h"
+#include "MonitorConfig.h"
+
+//Matches the FPGA power-on state
+MonitorConfig g_monitorConfig =
+{
+	false,
+	MON_TAG_NONE,
+	{ 0, 0 },
+	false,
+	FILTER_OFF,
+	{ 0, 0 },
+	{ false, false },
+	{ false, false },
+	{ SAMPLE_OFF, SAMPLE_OFF },
+	{ 1, 1 }
+};
+
+/**
+	@brief Pushes g_monitorConfig to the FPGA
+ */
+void MonitorConfigApply()
+{
+	uint8_t buf[5] =
+	{
+		static_cast<uint8_t>(
+			(g_monitorConfig.aggregate ? 1 : 0) |
+			(g_monitorConfig.tagMode << 1) |
+			(g_monitorConfig.timestamp ? 8 : 0) |
+			(g_monitorConfig.filterDefault << 4) ),
+		static_cast<uint8_t>(g_monitorConfig.vlanId[0] & 0xff),
+		static_cast<uint8_t>(g_monitorConfig.vlanId[0] >> 8),
+		static_cast<uint8_t>(g_monitorConfig.vlanId[1] & 0xff),
+		static_cast<uint8_t>(g_monitorConfig.vlanId[1] >> 8)
+	};
+	g_qspi->BlockingWrite(REG_MONITOR_CFG, 0, buf, sizeof(buf));
+
+	uint8_t snap[6];
+	for(int i=0; i<2; i++)
+	{
+		snap[i*3] = g_monitorConfig.snaplen[i] & 0xff;
+		snap[i*3 + 1] = g_monitorConfig.snaplen[i] >> 8;
+		snap[i*3 + 2] = (g_monitorConfig.snapHeader[i] ? 1 : 0) | (g_monitorConfig.snapTrailer[i] ? 2 : 0);
+	}
+	g_qspi->BlockingWrite(REG_MONITOR_SNAPLEN, 0, snap, sizeof(snap));
+
+	//Random and flow modes keep a frame if a 32 bit random number or hash is at or below the threshold
+	uint8_t sample[16];
+	for(int i=0; i<2; i++)
+	{
+		uint32_t rate = g_monitorConfig.sampleRate[i];
+		uint32_t threshold = (rate > 1) ? static_cast<uint32_t>(0x100000000ULL / rate - 1) : 0xffffffff;
+
+		uint8_t* p = sample + i*8;
+		p[0] = g_monitorConfig.sampleMode[i];
+		for(int j=0; j<3; j++)
+			p[1 + j] = (rate >> (j*8)) & 0xff;
+		for(int j=0; j<4; j++)
+			p[4 + j] = (threshold >> (j*8)) & 0xff;
+	}
+	g_qspi->BlockingWrite(REG_MONITOR_SAMPLE, 0, sample, sizeof(sample));
+}
+
+/**
+	@brief Loads the FPGA timestamp counter
+
+	@param ns	Nanoseconds since the Unix epoch (or any other epoch the capture host agrees on)
+ */
+void TimestampSet(uint64_t ns)
+{
+	uint8_t buf[8];
+	for(int i=0; i<8; i++)
+		buf[i] = (ns >> (i*8)) & 0xff;
+	g_qspi->BlockingWrite(REG_TIMESTAMP_SET, 0, buf, sizeof(buf));
+}
+
+/**
+	@brief Reads the current value of the FPGA timestamp counter
+ */
+uint64_t TimestampRead()
+{
+	uint8_t buf[8];
+	g_qspi->BlockingRead(REG_TIMESTAMP, 0, buf, sizeof(buf));
+
+	uint64_t ns = 0;
+	for(int i=7; i>=0; i--)
+		ns = (ns << 8) | buf[i];
+	return ns;
+}
+
+/**
+	@brief Latches the kept and skipped frame counts of both samplers at once, and reads them back in one burst
+
+	@return True if the snapshot completed, false if the values returned are stale
+ */
+bool SampleStatsSnapshot(SampleStats stats[2])
+{
+	g_qspi->BlockingWrite8(REG_STATS_SNAPSHOT, 0, 0);
+
+	uint8_t buf[33];
+	for(int i=0; i<5; i++)
+	{
+		g_qspi->BlockingRead(REG_SAMPLE_STATS, 0, buf, sizeof(buf));
+		if(buf[0] == 0)
+			break;
+	}
+
+	for(int port=0; port<2; port++)
+	{
+		const uint8_t* p = buf + 1 + port*16;
+		stats[port].kept = 0;
+		stats[port].skipped = 0;
+		for(int i=7; i>=0; i--)
+		{
+			stats[port].kept = (stats[port].kept << 8) | p[i];
+			stats[port].skipped = (stats[port].skipped << 8) | p[8 + i];
+		}
+	}
+
+	return (buf[0] == 0);
+}
+
+/**
+	@brief Zeroes the kept and skipped frame counts of both samplers
+ */
+void SampleStatsClear()
+{
+	g_qspi->BlockingWrite8(REG_STATS_CLEAR, 0, 0x80);
+}
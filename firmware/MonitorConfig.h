@@ -0,0 +1,109 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@brief Declaration of monitor path configuration
+ */
+#ifndef MonitorConfig_h
+#define MonitorConfig_h
+
+#include <stdint.h>
+
+//Direction tag added to monitor copies of frames
+enum montag_t
+{
+	MON_TAG_NONE,		//frames forwarded unmodified
+	MON_TAG_VLAN,		//802.1Q tag after the source MAC, VID set per direction
+	MON_TAG_TRAILER		//one byte after the end of the frame: 0 if received on porta, 1 if on portb
+};
+
+//What the monitor filter does with a frame
+enum filteraction_t
+{
+	FILTER_OFF,			//rule disabled (as the default action: same as FILTER_MIRROR)
+	FILTER_MIRROR,		//send to the monitor port
+	FILTER_DROP,		//don't send to the monitor port
+	FILTER_TRUNCATE		//send, cut at the end of the L4 header
+};
+
+//How the monitor path thins out frames that pass the filter
+enum samplemode_t
+{
+	SAMPLE_OFF,			//keep everything
+	SAMPLE_COUNT,		//every Nth frame
+	SAMPLE_RANDOM,		//each frame with probability 1/N
+	SAMPLE_FLOW			//each 5-tuple flow with probability 1/N, same answer in both directions
+};
+
+//Largest N the FPGA can count to
+#define SAMPLE_RATE_MAX 0xffffff
+
+/**
+	@brief Monitor path settings
+
+	The FPGA registers are write only, so this is the authoritative copy
+ */
+struct MonitorConfig
+{
+	bool		aggregate;		//both directions go out mona, in arrival order
+	montag_t	tagMode;
+	uint16_t	vlanId[2];		//VID for frames received on porta / portb
+	bool		timestamp;		//append arrival time (64 bit big endian nanoseconds)
+	filteraction_t	filterDefault;	//for frames no filter rule matches (see FilterRules.h)
+
+	//Truncation, indexed by receiving port like vlanId
+	uint16_t	snaplen[2];		//bytes to keep, 0 = whole frame
+	bool		snapHeader[2];	//also cut at the end of the L4 header
+	bool		snapTrailer[2];	//append the original length (16 bit big endian)
+
+	//Sampling, indexed by receiving port
+	samplemode_t	sampleMode[2];
+	uint32_t	sampleRate[2];	//N, keep one frame (or flow) in this many
+};
+
+//Frames the sampler of one direction has seen since the counters were cleared
+struct SampleStats
+{
+	uint64_t	kept;
+	uint64_t	skipped;
+};
+
+extern MonitorConfig g_monitorConfig;
+
+void MonitorConfigApply();
+
+void TimestampSet(uint64_t ns);
+uint64_t TimestampRead();
+
+bool SampleStatsSnapshot(SampleStats stats[2]);
+void SampleStatsClear();
+
+#endif
@@ -0,0 +1,86 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "ethernet-tap.h"
+#include "PathStats.h"
+
+const char* g_pathNames[PATH_COUNT] =
+{
+	"porta -> portb",
+	"portb -> porta",
+	"porta -> mona",
+	"portb -> monb"
+};
+
+static uint64_t ReadLE(const uint8_t* p, int len)
+{
+	uint64_t value = 0;
+	for(int i=len-1; i>=0; i--)
+		value = (value << 8) | p[i];
+	return value;
+}
+
+/**
+	@brief Latches the overflow statistics of every path at once, and reads them back in one burst
+
+	@return True if the snapshot completed, false if the values returned are stale
+ */
+bool PathStatsSnapshot(PathStats stats[PATH_COUNT])
+{
+	g_qspi->BlockingWrite8(REG_STATS_SNAPSHOT, 0, 0);
+
+	uint8_t buf[1 + PATH_COUNT*PATH_STATS_SIZE];
+	for(int i=0; i<5; i++)
+	{
+		g_qspi->BlockingRead(REG_PATH_STATS, 0, buf, sizeof(buf));
+		if(buf[0] == 0)
+			break;
+	}
+
+	for(int i=0; i<PATH_COUNT; i++)
+	{
+		const uint8_t* p = buf + 1 + i*PATH_STATS_SIZE;
+		stats[i].dropFrames = ReadLE(p, 8);
+		stats[i].dropBytes = ReadLE(p + 8, 8);
+		stats[i].highWater = ReadLE(p + 16, 2);
+		stats[i].fifoSize = ReadLE(p + 18, 2);
+	}
+
+	return (buf[0] == 0);
+}
+
+/**
+	@brief Zeroes drop counters and high water marks for some paths
+
+	@param pathmask	One bit per pathid_t
+ */
+void PathStatsClear(uint8_t pathmask)
+{
+	g_qspi->BlockingWrite8(REG_STATS_CLEAR, 0, (pathmask & 0xf) << 2);
+}
@@ -0,0 +1,79 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of ProfiledOctoSPI
+ */
+#ifndef ProfiledOctoSPI_h
+#define ProfiledOctoSPI_h
+
+#include <peripheral/OctoSPI.h>
+#include "Profiler.h"
+#include "TCM.h"
+
+/**
+	@brief OctoSPI with the blocking transfers we use timed by the profiler
+
+	The wrappers hide (rather than override) the base class methods, so calls only get profiled when made through a
+	ProfiledOctoSPI pointer, as with g_qspi. They're on the hot path, so they go in ITCM too.
+ */
+class ProfiledOctoSPI : public OctoSPI
+{
+public:
+	ProfiledOctoSPI(volatile octospi_t* lane, uint32_t sizeBytes, uint8_t prescale)
+		: OctoSPI(lane, sizeBytes, prescale)
+	{}
+
+	void ITCM_CODE BlockingWrite(uint32_t insn, uint32_t addr, const uint8_t* data, uint32_t len)
+	{
+		ProfileScope ps(PROBE_QSPI_WRITE);
+		OctoSPI::BlockingWrite(insn, addr, data, len);
+	}
+
+	void ITCM_CODE BlockingWrite8(uint32_t insn, uint32_t addr, uint8_t data)
+	{
+		ProfileScope ps(PROBE_QSPI_WRITE);
+		OctoSPI::BlockingWrite8(insn, addr, data);
+	}
+
+	void ITCM_CODE BlockingRead(uint32_t insn, uint32_t addr, uint8_t* data, uint32_t len)
+	{
+		ProfileScope ps(PROBE_QSPI_READ);
+		OctoSPI::BlockingRead(insn, addr, data, len);
+	}
+
+	uint16_t ITCM_CODE BlockingRead16(uint32_t insn, uint32_t addr)
+	{
+		ProfileScope ps(PROBE_QSPI_READ);
+		return OctoSPI::BlockingRead16(insn, addr);
+	}
+};
+
+#endif
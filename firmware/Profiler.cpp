@@ -0,0 +1,67 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "ethernet-tap.h"
+#include "Profiler.h"
+
+DTCM_DATA ProfileProbe g_profileProbes[PROBE_COUNT] =
+{
+	{ "poll-io",	0, 0, 0, 0, {0} },
+	{ "fpga-irq",	0, 0, 0, 0, {0} },
+	{ "leds",		0, 0, 0, 0, {0} },
+	{ "buttons",	0, 0, 0, 0, {0} },
+	{ "background",	0, 0, 0, 0, {0} },
+	{ "log",		0, 0, 0, 0, {0} },
+	{ "qspi-read",	0, 0, 0, 0, {0} },
+	{ "qspi-write",	0, 0, 0, 0, {0} },
+	{ "mdio-wait",	0, 0, 0, 0, {0} },
+	{ "mdio-batch",	0, 0, 0, 0, {0} }
+};
+
+/**
+	@brief Starts the cycle counter and resets all probes
+ */
+void InitProfiler()
+{
+	EnableCycleCounter();
+	ProfilerClear();
+}
+
+void ProfilerClear()
+{
+	for(auto& probe : g_profileProbes)
+	{
+		probe.count = 0;
+		probe.minCycles = 0xffffffff;
+		probe.maxCycles = 0;
+		probe.totalCycles = 0;
+		for(auto& bin : probe.histogram)
+			bin = 0;
+	}
+}
@@ -0,0 +1,115 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of the cycle counter profiler
+ */
+#ifndef Profiler_h
+#define Profiler_h
+
+#include "CpuIntrinsics.h"
+
+/**
+	@brief Every code region we profile. Names are in g_profileProbes.
+ */
+enum probeid_t
+{
+	PROBE_POLL_IO,
+	PROBE_FPGA_IRQ,
+	PROBE_LEDS,
+	PROBE_BUTTONS,
+	PROBE_BACKGROUND,
+	PROBE_LOG,
+	PROBE_QSPI_READ,
+	PROBE_QSPI_WRITE,
+	PROBE_MDIO_WAIT,
+	PROBE_MDIO_BATCH,
+
+	PROBE_COUNT
+};
+
+//One histogram bin per power of two of CPU cycles
+#define PROFILE_HIST_BINS 32
+
+/**
+	@brief Statistics for one probe, all in CPU cycles
+ */
+struct ProfileProbe
+{
+	const char*	name;
+	uint32_t	count;
+	uint32_t	minCycles;
+	uint32_t	maxCycles;
+	uint64_t	totalCycles;
+	uint32_t	histogram[PROFILE_HIST_BINS];
+};
+
+extern ProfileProbe g_profileProbes[PROBE_COUNT];
+
+void InitProfiler();
+void ProfilerClear();
+
+/**
+	@brief Adds one measurement to a probe
+
+	Not reentrant: only use probes from thread mode, never from an ISR.
+ */
+TCM_INLINE void ProfilerRecord(probeid_t id, uint32_t cycles)
+{
+	auto& probe = g_profileProbes[id];
+	probe.count ++;
+	probe.totalCycles += cycles;
+	if(cycles < probe.minCycles)
+		probe.minCycles = cycles;
+	if(cycles > probe.maxCycles)
+		probe.maxCycles = cycles;
+	probe.histogram[31 - __builtin_clz(cycles | 1)] ++;
+}
+
+/**
+	@brief Measures the time from construction to the end of the enclosing scope
+ */
+class ProfileScope
+{
+public:
+	TCM_INLINE ProfileScope(probeid_t id)
+		: m_id(id)
+		, m_start(GetCycleCount())
+	{}
+
+	TCM_INLINE ~ProfileScope()
+	{ ProfilerRecord(m_id, GetCycleCount() - m_start); }
+
+protected:
+	probeid_t	m_id;
+	uint32_t	m_start;
+};
+
+#endif
@@ -0,0 +1,434 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "ethernet-tap.h"
+#include <ctype.h>
+
+//Rate limit for each format string: burst size, then one token per interval (in log timer ticks)
+#define LOG_RATE_BURST 8
+#define LOG_RATE_INTERVAL 10000
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Output helpers, so Format() can be shared between the console and CLI streams
+
+static void PutChar(CharacterDevice* out, char c)
+{ out->PrintBinary(c); }
+
+static void PutChar(CLIOutputStream* out, char c)
+{ out->PutCharacter(c); }
+
+static void PutString(CharacterDevice* out, const char* str)
+{ out->PrintString(str); }
+
+static void PutString(CLIOutputStream* out, const char* str)
+{ out->PutString(str); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+RingLogger::RingLogger()
+	: m_logged(0)
+	, m_dropped(0)
+	, m_suppressed(0)
+	, m_target(nullptr)
+	, m_timer(nullptr)
+	, m_indentLevel(0)
+	, m_deferred(false)
+	, m_head(0)
+	, m_drained(0)
+{
+	memset(m_rateSlots, 0, sizeof(m_rateSlots));
+}
+
+void RingLogger::Initialize(CharacterDevice* target, Timer* timer)
+{
+	m_target = target;
+	m_timer = timer;
+}
+
+/**
+	@brief Switches between printing messages as they're logged, and leaving them for the log task
+
+	Early boot logs synchronously since the scheduler isn't running yet. Anything still queued is printed when
+	deferred mode is turned off.
+ */
+void RingLogger::SetDeferred(bool deferred)
+{
+	if(!deferred)
+		Flush();
+	m_deferred = deferred;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Logging
+
+/**
+	@brief Back end for operator(), once the argument count has been checked
+ */
+void RingLogger::LogVarargs(Logger::LogType type, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	Log(type, format, args);
+	va_end(args);
+}
+
+/**
+	@brief Copies a message and its arguments into the ring
+
+	Arguments are pulled from the va_list by walking the format string, so only conversions we know how to
+	store are supported: d i u x X c s p, with optional flags, width, and l/h length modifiers.
+ */
+void RingLogger::Log(Logger::LogType type, const char* format, va_list args)
+{
+	LogRecord rec;
+	rec.timestamp = m_timer ? m_timer->GetCount() : 0;
+	rec.format = format;
+	rec.type = type;
+	rec.indent = m_indentLevel;
+	rec.suppressed = 0;
+
+	bool firstIsString = false;
+	uint32_t nstring = 0;
+	uint32_t nargs = 0;
+	for(const char* p = format; *p && (nargs < LOG_MAX_ARGS); p++)
+	{
+		if(*p != '%')
+			continue;
+		p++;
+
+		//Skip flags, width, and length modifiers
+		bool islong = false;
+		while(*p && (strchr("-+ #0", *p) || isdigit(*p) || (*p == 'l') || (*p == 'h')) )
+		{
+			if(*p == 'l')
+				islong = true;
+			p++;
+		}
+
+		switch(*p)
+		{
+			case 'd':
+			case 'i':
+				rec.args[nargs++] = islong ? va_arg(args, long) : va_arg(args, int);
+				break;
+
+			case 'u':
+			case 'x':
+			case 'X':
+				rec.args[nargs++] = islong ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+				break;
+
+			case 'c':
+				rec.args[nargs++] = va_arg(args, int);
+				break;
+
+			case 'p':
+				rec.args[nargs++] = reinterpret_cast<uintptr_t>(va_arg(args, void*));
+				break;
+
+			//Copy strings, truncating if we run out of space
+			case 's':
+				{
+					if(nargs == 0)
+						firstIsString = true;
+					const char* str = va_arg(args, const char*);
+					rec.args[nargs++] = (nstring < LOG_STRING_SPACE) ? nstring : LOG_STRING_SPACE-1;
+					while(*str && (nstring + 1 < LOG_STRING_SPACE))
+						rec.strings[nstring++] = *(str++);
+					if(nstring < LOG_STRING_SPACE)
+						rec.strings[nstring++] = '\0';
+				}
+				break;
+
+			//%% or end of string, no argument consumed
+			default:
+				if(*p == '\0')
+					p--;
+				break;
+		}
+	}
+	if(nstring < LOG_STRING_SPACE)
+		rec.strings[nstring] = '\0';
+	else
+		rec.strings[LOG_STRING_SPACE-1] = '\0';
+
+	if(m_deferred)
+	{
+		//Rate limit on the first argument too (FNV-1a of the string, for %s)
+		uint32_t key = 0;
+		if(firstIsString)
+		{
+			key = 0x811c9dc5;
+			for(const char* str = rec.strings; *str; str++)
+				key = (key ^ static_cast<uint8_t>(*str)) * 0x01000193;
+		}
+		else if(nargs)
+			key = rec.args[0];
+
+		if(!RateLimit(format, key, rec.suppressed))
+			return;
+	}
+
+	Append(rec);
+}
+
+/**
+	@brief Adds a finished record to the ring, and prints it now if we're not deferring
+ */
+void RingLogger::Append(const LogRecord& rec)
+{
+	//If the console hasn't caught up with the oldest record, it's about to be lost
+	if(m_head - m_drained >= LOG_RING_SIZE)
+	{
+		m_drained ++;
+		m_dropped ++;
+	}
+
+	m_ring[m_head % LOG_RING_SIZE] = rec;
+	m_head ++;
+	m_logged ++;
+
+	if(m_deferred)
+		SchedulerWake(g_taskTable[TASK_LOG]);
+	else
+		Flush();
+}
+
+/**
+	@brief Checks the token bucket for a message's format string and first argument
+
+	@param format		Format string of the message
+	@param key			First argument of the message (see Log())
+	@param suppressed	Set to the number of messages dropped since the last one that got through
+
+	@return True if the message should be logged
+ */
+bool RingLogger::RateLimit(const char* format, uint32_t key, uint16_t& suppressed)
+{
+	uint32_t now = m_timer ? m_timer->GetCount() : 0;
+
+	//Find the slot for this message, or the one that's been idle longest
+	RateSlot* slot = &m_rateSlots[0];
+	for(auto& s : m_rateSlots)
+	{
+		if( (s.format == format) && (s.key == key) )
+		{
+			slot = &s;
+			break;
+		}
+		if(!s.format || (now - s.lastRefill) > (now - slot->lastRefill) )
+			slot = &s;
+	}
+
+	if( (slot->format != format) || (slot->key != key) )
+	{
+		slot->format = format;
+		slot->key = key;
+		slot->lastRefill = now;
+		slot->tokens = LOG_RATE_BURST;
+		slot->suppressed = 0;
+	}
+
+	//Refill
+	uint32_t refill = (now - slot->lastRefill) / LOG_RATE_INTERVAL;
+	if(refill)
+	{
+		slot->lastRefill += refill * LOG_RATE_INTERVAL;
+		slot->tokens = (slot->tokens + refill > LOG_RATE_BURST) ? LOG_RATE_BURST : slot->tokens + refill;
+	}
+
+	if(slot->tokens == 0)
+	{
+		if(slot->suppressed < 0xffff)
+			slot->suppressed ++;
+		m_suppressed ++;
+		return false;
+	}
+
+	slot->tokens --;
+	suppressed = slot->suppressed;
+	slot->suppressed = 0;
+	return true;
+}
+
+/**
+	@brief Logs the count for any rate limited message that hasn't been followed by one that got through
+
+	Called by the log task. Once a slot has gone a whole LOG_RATE_INTERVAL since it last let a message through, the
+	count is logged on its own, since the next message with that format may never come.
+ */
+void RingLogger::FlushSuppressed()
+{
+	uint32_t now = m_timer ? m_timer->GetCount() : 0;
+	for(auto& s : m_rateSlots)
+	{
+		if(!s.format || !s.suppressed || ( (now - s.lastRefill) < LOG_RATE_INTERVAL) )
+			continue;
+
+		LogRecord rec;
+		rec.timestamp = now;
+		rec.format = "(%d messages like \"%s\" suppressed)\n";
+		rec.type = Logger::NOTICE;
+		rec.indent = 0;
+		rec.suppressed = 0;
+		rec.args[0] = s.suppressed;
+		rec.args[1] = 0;
+
+		//Quote the format string, up to the newline
+		uint32_t len = 0;
+		for(const char* p = s.format; *p && (*p != '\n') && (len + 1 < LOG_STRING_SPACE); p++)
+			rec.strings[len++] = *p;
+		rec.strings[len] = '\0';
+
+		s.suppressed = 0;
+		Append(rec);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Output
+
+/**
+	@brief Prints up to maxRecords queued messages to the console
+
+	@return True if there's more left to print
+ */
+bool RingLogger::Drain(int maxRecords)
+{
+	for(int i=0; (i < maxRecords) && (m_drained != m_head); i++)
+	{
+		Format(m_ring[m_drained % LOG_RING_SIZE], m_target);
+		m_drained ++;
+	}
+	return m_drained != m_head;
+}
+
+/**
+	@brief Prints everything queued, e.g. before a reset
+ */
+void RingLogger::Flush()
+{
+	if(m_target)
+		Drain(LOG_RING_SIZE);
+}
+
+/**
+	@brief Prints every message still in the ring to a CLI stream, oldest first
+ */
+void RingLogger::Replay(CLIOutputStream* stream)
+{
+	uint32_t start = (m_head > LOG_RING_SIZE) ? (m_head - LOG_RING_SIZE) : 0;
+	for(uint32_t i=start; i != m_head; i++)
+		Format(m_ring[i % LOG_RING_SIZE], stream);
+}
+
+/**
+	@brief Formats one record, one conversion at a time
+ */
+template<class T>
+void RingLogger::Format(const LogRecord& rec, T* out)
+{
+	out->Printf("[%6d.%04d] ", rec.timestamp / 10000, rec.timestamp % 10000);
+	for(uint32_t i=0; i<rec.indent; i++)
+		PutString(out, "    ");
+
+	if(rec.suppressed)
+	{
+		out->Printf("(%d similar messages suppressed)\n", rec.suppressed);
+		out->Printf("[%6d.%04d] ", rec.timestamp / 10000, rec.timestamp % 10000);
+		for(uint32_t i=0; i<rec.indent; i++)
+			PutString(out, "    ");
+	}
+
+	if(rec.type == Logger::WARNING)
+		PutString(out, "Warning: ");
+	else if(rec.type == Logger::ERROR)
+		PutString(out, "Error: ");
+
+	uint32_t nargs = 0;
+	for(const char* p = rec.format; *p; p++)
+	{
+		if(*p != '%')
+		{
+			PutChar(out, *p);
+			continue;
+		}
+
+		//Copy the conversion, minus length modifiers since everything was stored as 32 bits
+		char spec[16];
+		uint32_t len = 0;
+		spec[len++] = *(p++);
+		while(*p && (strchr("-+ #0", *p) || isdigit(*p) || (*p == 'l') || (*p == 'h')) )
+		{
+			if( (*p != 'l') && (*p != 'h') && (len < sizeof(spec) - 2) )
+				spec[len++] = *p;
+			p++;
+		}
+		if(*p == '\0')
+			break;
+		spec[len++] = *p;
+		spec[len] = '\0';
+
+		if(*p == '%')
+		{
+			PutChar(out, '%');
+			continue;
+		}
+
+		//Ran out of argument slots
+		if(nargs >= LOG_MAX_ARGS)
+		{
+			PutString(out, "?");
+			continue;
+		}
+
+		uint32_t arg = rec.args[nargs++];
+		switch(*p)
+		{
+			case 's':
+				out->Printf(spec, rec.strings + arg);
+				break;
+
+			case 'p':
+				out->Printf("0x%08x", arg);
+				break;
+
+			case 'd':
+			case 'i':
+				spec[len-1] = 'd';
+				out->Printf(spec, static_cast<int>(arg));
+				break;
+
+			default:
+				out->Printf(spec, arg);
+				break;
+		}
+	}
+}
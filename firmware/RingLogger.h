@@ -0,0 +1,181 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of RingLogger
+ */
+#ifndef RingLogger_h
+#define RingLogger_h
+
+#include <stdarg.h>
+#include <util/CharacterDevice.h>
+#include <util/Logger.h>
+#include <peripheral/Timer.h>
+#include <embedded-cli/CLIOutputStream.h>
+
+//Number of records kept in RAM for "show logging"
+#define LOG_RING_SIZE 128
+
+//Max number of printf arguments per message (checked at compile time), and space for copies of %s arguments
+#define LOG_MAX_ARGS 8
+#define LOG_STRING_SPACE 48
+
+//Number of distinct messages tracked for rate limiting
+#define LOG_RATE_SLOTS 16
+
+/**
+	@brief One log message, stored unformatted
+
+	The format string is kept by pointer (it's always a literal), numeric arguments as raw words, and %s arguments
+	are copied into strings[] since they may not outlive the call.
+ */
+struct LogRecord
+{
+	uint32_t		timestamp;
+	const char*		format;
+	uint8_t			type;
+	uint8_t			indent;
+	uint16_t		suppressed;
+	uint32_t		args[LOG_MAX_ARGS];
+	char			strings[LOG_STRING_SPACE];
+};
+
+/**
+	@brief Logger that writes binary records into a RAM ring and formats them later
+
+	Once SetDeferred(true) is called, logging a message is just a copy into the ring. The log task formats and writes
+	records out to the console when there's room in the UART buffer, and the ring keeps the most recent messages
+	around for "show logging" after they've been printed.
+
+	Each format string is rate limited separately (burst of LOG_RATE_BURST, then one per LOG_RATE_INTERVAL ticks), and
+	so is each value of its first argument, so e.g. one port flapping doesn't hide link messages from the others.
+	Messages over the limit are counted. The count is printed with the next one that gets through, or on its own by
+	FlushSuppressed() if none has by the end of the interval.
+
+	Not reentrant: only log from thread mode, never from an ISR.
+ */
+class RingLogger
+{
+public:
+	RingLogger();
+
+	void Initialize(CharacterDevice* target, Timer* timer);
+	void SetDeferred(bool deferred);
+
+	template<typename... Args>
+	void operator()(const char* format, Args... args)
+	{
+		static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many arguments for one log message (see LOG_MAX_ARGS)");
+		LogVarargs(Logger::NOTICE, format, args...);
+	}
+
+	template<typename... Args>
+	void operator()(Logger::LogType type, const char* format, Args... args)
+	{
+		static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many arguments for one log message (see LOG_MAX_ARGS)");
+		LogVarargs(type, format, args...);
+	}
+
+	void Indent()
+	{ m_indentLevel ++; }
+
+	void Unindent()
+	{
+		if(m_indentLevel)
+			m_indentLevel --;
+	}
+
+	bool Drain(int maxRecords);
+	void Flush();
+	void FlushSuppressed();
+
+	void Replay(CLIOutputStream* stream);
+
+	///@brief Total number of messages logged
+	uint32_t m_logged;
+
+	///@brief Number of messages overwritten in the ring before they were printed
+	uint32_t m_dropped;
+
+	///@brief Number of messages dropped by rate limiting
+	uint32_t m_suppressed;
+
+protected:
+	void LogVarargs(Logger::LogType type, const char* format, ...);
+	void Log(Logger::LogType type, const char* format, va_list args);
+	bool RateLimit(const char* format, uint32_t key, uint16_t& suppressed);
+	void Append(const LogRecord& rec);
+
+	template<class T> void Format(const LogRecord& rec, T* out);
+
+	CharacterDevice*	m_target;
+	Timer*				m_timer;
+	uint8_t				m_indentLevel;
+	bool				m_deferred;
+
+	LogRecord			m_ring[LOG_RING_SIZE];
+
+	///@brief Total records ever written (the newest is at (m_head - 1) % LOG_RING_SIZE)
+	uint32_t			m_head;
+
+	///@brief Total records printed to the console so far
+	uint32_t			m_drained;
+
+	/**
+		@brief Token bucket for one format string and first argument
+	 */
+	struct RateSlot
+	{
+		const char*		format;
+		uint32_t		key;			//first argument, or a hash of it for %s
+		uint32_t		lastRefill;
+		uint16_t		tokens;
+		uint16_t		suppressed;
+	} m_rateSlots[LOG_RATE_SLOTS];
+};
+
+/**
+	@brief Increases the log indent level until the end of the scope
+ */
+class RingLogIndenter
+{
+public:
+	RingLogIndenter(RingLogger& log)
+		: m_log(log)
+	{ m_log.Indent(); }
+
+	~RingLogIndenter()
+	{ m_log.Unindent(); }
+
+protected:
+	RingLogger& m_log;
+};
+
+#endif
@@ -0,0 +1,138 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "ethernet-tap.h"
+#include "RmonCounters.h"
+
+const char* g_rmonNames[RMON_COUNT] =
+{
+	"Frames",
+	"Bytes",
+	"Drops",
+	"Errors",
+	"Broadcast",
+	"Multicast"
+};
+
+const char* g_rmonBinNames[RMON_BIN_COUNT] =
+{
+	"64",
+	"65-127",
+	"128-255",
+	"256-511",
+	"512-1023",
+	"1024-1518",
+	"1519-1522",
+	"Runt/oversize"
+};
+
+/**
+	@brief Takes a snapshot and reads back one bank of 64 bit counters, RMON_SLOTS per port
+
+	@return True if the snapshot completed, false if the values returned are stale
+ */
+static bool ReadCounterBank(uint32_t regid, uint64_t values[RMON_PORTS][RMON_SLOTS])
+{
+	g_qspi->BlockingWrite8(REG_STATS_SNAPSHOT, 0, 0);
+
+	uint8_t buf[1 + RMON_PORTS*RMON_SLOTS*8];
+	for(int i=0; i<5; i++)
+	{
+		g_qspi->BlockingRead(regid, 0, buf, sizeof(buf));
+		if(buf[0] == 0)
+			break;
+	}
+
+	for(int port=0; port<RMON_PORTS; port++)
+	{
+		for(int i=0; i<RMON_SLOTS; i++)
+		{
+			const uint8_t* p = buf + 1 + (port*RMON_SLOTS + i)*8;
+			uint64_t value = 0;
+			for(int j=7; j>=0; j--)
+				value = (value << 8) | p[j];
+			values[port][i] = value;
+		}
+	}
+
+	return (buf[0] == 0);
+}
+
+/**
+	@brief Latches the counters for both tap ports at once, and reads them back in one burst
+
+	The snapshot is taken in each port's RX clock domain, so it needs a few RX clocks to land. That's normally done
+	before the read starts, but with a slow (or stopped) RX clock it may not be.
+
+	@return True if the snapshot completed, false if the values returned are stale
+ */
+bool RmonSnapshot(RmonCounters counters[RMON_PORTS])
+{
+	uint64_t values[RMON_PORTS][RMON_SLOTS];
+	bool ok = ReadCounterBank(REG_RMON_COUNTERS, values);
+
+	for(int port=0; port<RMON_PORTS; port++)
+	{
+		for(int i=0; i<RMON_COUNT; i++)
+			counters[port].values[i] = values[port][i];
+	}
+
+	return ok;
+}
+
+/**
+	@brief Latches the frame size histograms for both tap ports at once, and reads them back in one burst
+
+	Every frame in RMON_FRAMES or RMON_ERRORS lands in exactly one bin.
+
+	@return True if the snapshot completed, false if the values returned are stale
+ */
+bool RmonHistogramSnapshot(RmonHistogram histograms[RMON_PORTS])
+{
+	uint64_t values[RMON_PORTS][RMON_SLOTS];
+	bool ok = ReadCounterBank(REG_RMON_HISTOGRAM, values);
+
+	for(int port=0; port<RMON_PORTS; port++)
+	{
+		for(int i=0; i<RMON_BIN_COUNT; i++)
+			histograms[port].bins[i] = values[port][i];
+	}
+
+	return ok;
+}
+
+/**
+	@brief Zeroes the counters and size histograms for some tap ports
+
+	@param portmask	Bit 0 for porta, bit 1 for portb
+ */
+void RmonClear(uint8_t portmask)
+{
+	g_qspi->BlockingWrite8(REG_STATS_CLEAR, 0, portmask & 3);
+}
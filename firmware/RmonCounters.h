@@ -0,0 +1,96 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of RMON counter access
+ */
+#ifndef RmonCounters_h
+#define RmonCounters_h
+
+#include <stdint.h>
+
+//Counters kept by the FPGA for each tap port (same order as rmon_index_t in MicrocontrollerInterface.svh)
+enum rmonid_t
+{
+	RMON_FRAMES,
+	RMON_BYTES,
+	RMON_DROPS,
+	RMON_ERRORS,
+	RMON_BROADCAST,
+	RMON_MULTICAST,
+
+	RMON_COUNT
+};
+
+//Frame size histogram bins, sizes including FCS (same order as rmon_bin_t in MicrocontrollerInterface.svh)
+enum rmonbin_t
+{
+	RMON_BIN_64,
+	RMON_BIN_65_127,
+	RMON_BIN_128_255,
+	RMON_BIN_256_511,
+	RMON_BIN_512_1023,
+	RMON_BIN_1024_1518,
+	RMON_BIN_1519_MAX,
+	RMON_BIN_BAD_LEN,
+
+	RMON_BIN_COUNT
+};
+
+//Only the two tap ports receive traffic, so only they have counters
+#define RMON_PORTS 2
+
+//Counter slots per port in the snapshot bank, including reserved ones
+#define RMON_SLOTS 8
+
+/**
+	@brief One port's counters, as of the last snapshot
+ */
+struct RmonCounters
+{
+	uint64_t	values[RMON_COUNT];
+};
+
+/**
+	@brief One port's frame size histogram, as of the last snapshot
+ */
+struct RmonHistogram
+{
+	uint64_t	bins[RMON_BIN_COUNT];
+};
+
+extern const char* g_rmonNames[RMON_COUNT];
+extern const char* g_rmonBinNames[RMON_BIN_COUNT];
+
+bool RmonSnapshot(RmonCounters counters[RMON_PORTS]);
+bool RmonHistogramSnapshot(RmonHistogram histograms[RMON_PORTS]);
+void RmonClear(uint8_t portmask);
+
+#endif
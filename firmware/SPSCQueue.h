@@ -0,0 +1,115 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SPSCQueue
+ */
+#ifndef SPSCQueue_h
+#define SPSCQueue_h
+
+#include "CpuIntrinsics.h"
+#include "TCM.h"
+
+/**
+	@brief Lock-free single producer, single consumer queue for passing events from an ISR to the main loop
+
+	The producer only ever writes m_head and the consumer only ever writes m_tail, so no locking is needed as long as
+	there is exactly one of each. One slot is always left empty to tell a full queue from an empty one.
+ */
+template<class T, uint32_t depth>
+class SPSCQueue
+{
+public:
+	SPSCQueue()
+		: m_head(0)
+		, m_tail(0)
+		, m_overflows(0)
+	{}
+
+	/**
+		@brief Adds an item to the queue (producer side)
+
+		@return False if the queue was full and the item was dropped
+	 */
+	TCM_INLINE bool Push(const T& item)
+	{
+		uint32_t head = m_head;
+		uint32_t next = (head + 1) % depth;
+		if(next == m_tail)
+		{
+			m_overflows ++;
+			return false;
+		}
+
+		m_items[head] = item;
+
+		//Make sure the item is visible before the consumer sees the new head
+		DataMemoryBarrier();
+		m_head = next;
+		return true;
+	}
+
+	/**
+		@brief Removes the oldest item from the queue (consumer side)
+
+		@return False if the queue was empty
+	 */
+	TCM_INLINE bool Pop(T& item)
+	{
+		uint32_t tail = m_tail;
+		if(tail == m_head)
+			return false;
+
+		DataMemoryBarrier();
+		item = m_items[tail];
+
+		//Don't let the producer reuse the slot until we're done reading it
+		DataMemoryBarrier();
+		m_tail = (tail + 1) % depth;
+		return true;
+	}
+
+	TCM_INLINE bool IsEmpty() const
+	{ return m_head == m_tail; }
+
+	TCM_INLINE uint32_t size() const
+	{ return (m_head + depth - m_tail) % depth; }
+
+	TCM_INLINE uint32_t GetOverflowCount() const
+	{ return m_overflows; }
+
+protected:
+	T m_items[depth];
+	volatile uint32_t m_head;
+	volatile uint32_t m_tail;
+	volatile uint32_t m_overflows;
+};
+
+#endif
@@ -0,0 +1,70 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Attributes for placing code and data in the tightly coupled memories
+
+	ITCM_CODE functions are copied from flash to ITCM by Reset_Handler() and run from there instead of flash.
+	DTCM_DATA and DTCM_BSS variables live in DTCM, which is not behind the cache. See tcm.ld for the sections.
+
+	Calls between ITCM (0x00000000) and flash (0x08000000) are out of BL range, the linker adds veneers for them. Keep
+	the hot path itself in ITCM so those are only taken on the way in and out. We build at -O0, where nothing is
+	inlined unless forced, so small helpers called from ITCM code (SPSCQueue, the profiler, the CPU intrinsics) are
+	TCM_INLINE. Anything in stm32-cpp (the OctoSPI transfers, Timer::GetCount(), UART) still runs from flash.
+
+	Nothing has been measured yet. Building with NO_TCM (make NO_TCM=1) leaves everything in the default sections,
+	compare "show profile" against the default build on hardware before relying on any of this. The simulator has no
+	TCMs at all.
+ */
+#ifndef TCM_h
+#define TCM_h
+
+//Inlined even at -O0, in both target builds so NO_TCM runs the same code
+#ifdef SIMULATION
+#define TCM_INLINE	inline
+#else
+#define TCM_INLINE	__attribute__((always_inline)) inline
+#endif
+
+#if defined(SIMULATION) || defined(NO_TCM)
+
+#define ITCM_CODE
+#define DTCM_DATA
+#define DTCM_BSS
+
+#else
+
+#define ITCM_CODE	__attribute__((section(".itcm_text"), noinline))
+#define DTCM_DATA	__attribute__((section(".dtcm_data")))
+#define DTCM_BSS	__attribute__((section(".dtcm_bss")))
+
+#endif
+
+#endif
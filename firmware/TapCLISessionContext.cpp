@@ -38,45 +38,83 @@
 //List of all valid command tokens
 enum cmdid_t
 {
+	CMD_ACTION,
+	CMD_AGGREGATE,
+	CMD_ALL,
 	CMD_AUTO,
 	CMD_AUTONEGOTIATION,
 	CMD_10,
 	CMD_100,
 	CMD_1000,
+	CMD_CLEAR,
+	CMD_CLOCK,
 	CMD_COMMIT,
+	CMD_COUNT,
+	CMD_COUNTERS,
 	CMD_CROSSOVER,
+	CMD_DATAPATH,
+	CMD_DEFAULT,
 	CMD_DETAIL,
 	CMD_DISTORTION,
 	CMD_DROP,
+	CMD_DST_IP,
+	CMD_DST_MAC,
+	CMD_DST_PORT,
+	CMD_ETHERTYPE,
 	CMD_EXIT,
+	CMD_FILTER,
+	CMD_FLOW,
 	CMD_HARDWARE,
+	CMD_HEADER,
+	CMD_HISTOGRAM,
 	CMD_INTERFACE,
 	CMD_ILA,
 	CMD_JITTER,
+	CMD_LOGGING,
 	CMD_MASTER,
+	CMD_MATCH,
 	CMD_MODE,
 	CMD_MDI,
+	CMD_MDIO,
+	CMD_MIRROR,
 	CMD_MMD,
 	CMD_MONA,
 	CMD_MONB,
+	CMD_MONITOR,
 	CMD_NO,
 	CMD_NONE,
 	CMD_PORTA,
 	CMD_PORTB,
 	CMD_PREFER,
+	CMD_PROFILE,
+	CMD_PROTOCOL,
+	CMD_RANDOM,
+	CMD_RANGE,
 	CMD_REGISTER,
 	CMD_RELOAD,
+	CMD_RULE,
+	CMD_SAMPLE,
 	CMD_SET,
 	CMD_SHOW,
 	CMD_SLAVE,
+	CMD_SNAPLEN,
 	CMD_SPEED,
+	CMD_SRC_IP,
+	CMD_SRC_MAC,
+	CMD_SRC_PORT,
 	CMD_START,
 	CMD_STATUS,
 	CMD_STRAIGHT,
+	CMD_TAG,
+	CMD_TASKS,
 	CMD_TEST,
 	CMD_TESTPATTERN,
+	CMD_TIMESTAMP,
+	CMD_TRAILER,
 	CMD_TRIGGER,
+	CMD_TRUNCATE,
 	CMD_VERSION,
+	CMD_VLAN,
 	CMD_VOLATILITY,
 	CMD_WAVEFORM_TEST
 };
@@ -99,6 +137,8 @@ static const clikeyword_t g_interfaceCommands[] =
 
 static const clikeyword_t g_showInterfaceCommands[] =
 {
+	{"counters",		CMD_COUNTERS,			nullptr,					"Print traffic counters of tap ports"},
+	{"histogram",		CMD_HISTOGRAM,			nullptr,					"Print frame size distribution of tap ports"},
 	{"status",			CMD_STATUS,				nullptr,					"Print status of interfaces"},
 
 	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
@@ -107,13 +147,46 @@ static const clikeyword_t g_showInterfaceCommands[] =
 static const clikeyword_t g_showCommands[] =
 {
 	{"interface",		CMD_INTERFACE,			g_showInterfaceCommands,	"Print interface information"},
+	{"clock",			CMD_CLOCK,				nullptr,					"Print the arrival timestamp counter"},
+	{"datapath",		CMD_DATAPATH,			nullptr,					"Print overflow statistics of each path"},
+	{"filter",			CMD_FILTER,				nullptr,					"Print monitor filter rules and hit counts"},
 	{"hardware",		CMD_HARDWARE,			nullptr,					"Print hardware information"},
+	{"logging",			CMD_LOGGING,			nullptr,					"Print recent log messages"},
+	{"mdio",			CMD_MDIO,				nullptr,					"Print MDIO bus status"},
+	{"monitor",			CMD_MONITOR,			nullptr,					"Print monitor port configuration"},
+	{"profile",			CMD_PROFILE,			nullptr,					"Print cycle counts of profiled code"},
+	{"tasks",			CMD_TASKS,				nullptr,					"Print main loop task statistics"},
 	{"version",			CMD_VERSION,			nullptr,					"Print firmware version information"},
 	{"volatility",		CMD_VOLATILITY,			nullptr,					"Print Statement of Volatility"},
 
 	{nullptr,			INVALID_COMMAND,		nullptr,	nullptr}
 };
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "clear"
+
+static const clikeyword_t g_clearCommands[] =
+{
+	{"counters",		CMD_COUNTERS,			nullptr,					"Reset traffic counters"},
+	{"profile",			CMD_PROFILE,			nullptr,					"Reset profiler statistics"},
+
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "test"
+
+static const clikeyword_t g_testCommands[] =
+{
+	{"all",				CMD_ALL,				nullptr,					"All interfaces at once"},
+	{"mona",			CMD_MONA,				nullptr,					"Monitor of port A"},
+	{"monb",			CMD_MONB,				nullptr,					"Monitor of port B"},
+	{"porta",			CMD_PORTA,				nullptr,					"Left tap port"},
+	{"portb",			CMD_PORTB,				nullptr,					"Right tap port"},
+
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // "set"
 
@@ -163,8 +236,23 @@ static const clikeyword_t g_showRegisterCommands[] =
 	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
 };
 
+static const clikeyword_t g_showMmdRangeCountCommands[] =
+{
+	{"<count>",			FREEFORM_TOKEN,			nullptr,					"Number of registers to read (decimal)"},
+
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_showMmdRangeCommands[] =
+{
+	{"<start>",			FREEFORM_TOKEN,			g_showMmdRangeCountCommands,	"Hexadecimal address of first register"},
+
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
 static const clikeyword_t g_showMmdRegisterCommands[] =
 {
+	{"range",			CMD_RANGE,				g_showMmdRangeCommands,		"Block of registers within the MMD"},
 	{"register",		CMD_REGISTER,			g_showRegisterCommands,		"Register within the MMD"},
 
 	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
@@ -241,6 +329,247 @@ static const clikeyword_t g_interfaceNoCommands[] =
 	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
 };
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "monitor"
+
+static const clikeyword_t g_monitorVlanBCommands[] =
+{
+	{"<portb-vid>",		FREEFORM_TOKEN,			nullptr,					"VLAN ID for frames received on portb (decimal)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorVlanCommands[] =
+{
+	{"<porta-vid>",		FREEFORM_TOKEN,			g_monitorVlanBCommands,		"VLAN ID for frames received on porta (decimal)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorTagCommands[] =
+{
+	{"trailer",			CMD_TRAILER,			nullptr,					"Append one byte: 0 if received on porta, 1 if on portb"},
+	{"vlan",			CMD_VLAN,				g_monitorVlanCommands,		"Insert an 802.1Q tag"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorSnaplenTrailerCommands[] =
+{
+	{"trailer",			CMD_TRAILER,			nullptr,					"Append the original length"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorSnaplenOptionCommands[] =
+{
+	{"header",			CMD_HEADER,				g_monitorSnaplenTrailerCommands,	"Cut at the end of the L4 header if that comes first"},
+	{"trailer",			CMD_TRAILER,			nullptr,					"Append the original length"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorSnaplenLengthCommands[] =
+{
+	{"<bytes>",			FREEFORM_TOKEN,			g_monitorSnaplenOptionCommands,	"Bytes to keep (at least 60, or 0 for no limit)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorPortCommands[] =
+{
+	{"mona",			CMD_MONA,				g_monitorSnaplenLengthCommands,	"Frames received on porta"},
+	{"monb",			CMD_MONB,				g_monitorSnaplenLengthCommands,	"Frames received on portb"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorSampleRateCommands[] =
+{
+	{"<n>",				FREEFORM_TOKEN,			nullptr,					"Keep one in this many (1-16777215)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorSampleModeCommands[] =
+{
+	{"count",			CMD_COUNT,				g_monitorSampleRateCommands,	"Keep every Nth frame"},
+	{"flow",			CMD_FLOW,				g_monitorSampleRateCommands,	"Keep whole flows, 1 in N (use the same N both ways)"},
+	{"random",			CMD_RANDOM,				g_monitorSampleRateCommands,	"Keep frames at random, 1 in N"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorSamplePortCommands[] =
+{
+	{"mona",			CMD_MONA,				g_monitorSampleModeCommands,	"Frames received on porta"},
+	{"monb",			CMD_MONB,				g_monitorSampleModeCommands,	"Frames received on portb"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_monitorCommands[] =
+{
+	{"aggregate",		CMD_AGGREGATE,			nullptr,					"Send both directions out mona, in arrival order"},
+	{"sample",			CMD_SAMPLE,				g_monitorSamplePortCommands,	"Forward a fraction of monitored frames"},
+	{"snaplen",			CMD_SNAPLEN,			g_monitorPortCommands,		"Truncate monitored frames"},
+	{"tag",				CMD_TAG,				g_monitorTagCommands,		"Mark monitored frames with their direction"},
+	{"timestamp",		CMD_TIMESTAMP,			nullptr,					"Append arrival time to monitored frames"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "clock"
+
+static const clikeyword_t g_clockSetCommands[] =
+{
+	{"<seconds>",		FREEFORM_TOKEN,			nullptr,					"Seconds since 1970-01-01 00:00:00 UTC"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_clockCommands[] =
+{
+	{"set",				CMD_SET,				g_clockSetCommands,			"Set the arrival timestamp counter"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "filter"
+
+static const clikeyword_t g_filterActionCommands[] =
+{
+	{"drop",			CMD_DROP,				nullptr,					"Don't send to the monitor port"},
+	{"mirror",			CMD_MIRROR,				nullptr,					"Send to the monitor port"},
+	{"truncate",		CMD_TRUNCATE,			nullptr,					"Send, cut at the end of the L4 header"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterPrefixCommands[] =
+{
+	{"<prefix-len>",	FREEFORM_TOKEN,			nullptr,					"Leading bits to compare (default all)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterMacCommands[] =
+{
+	{"<mac>",			FREEFORM_TOKEN,			g_filterPrefixCommands,		"Address (xx:xx:xx:xx:xx:xx)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterIpCommands[] =
+{
+	{"<address>",		FREEFORM_TOKEN,			g_filterPrefixCommands,		"IPv4 or IPv6 address"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterEthertypeCommands[] =
+{
+	{"<ethertype>",		FREEFORM_TOKEN,			nullptr,					"EtherType after any 802.1Q tag (hex)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterPortCommands[] =
+{
+	{"<port>",			FREEFORM_TOKEN,			nullptr,					"TCP, UDP or SCTP port (decimal)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterProtocolCommands[] =
+{
+	{"<protocol>",		FREEFORM_TOKEN,			nullptr,					"IPv4 protocol or IPv6 next header (decimal)"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterVlanCommands[] =
+{
+	{"<vid>",			FREEFORM_TOKEN,			nullptr,					"VLAN ID (decimal), or \"untagged\""},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterMatchCommands[] =
+{
+	{"dst-ip",			CMD_DST_IP,				g_filterIpCommands,			"Destination IP address"},
+	{"dst-mac",			CMD_DST_MAC,			g_filterMacCommands,		"Destination MAC address"},
+	{"dst-port",		CMD_DST_PORT,			g_filterPortCommands,		"Destination port"},
+	{"ethertype",		CMD_ETHERTYPE,			g_filterEthertypeCommands,	"EtherType"},
+	{"protocol",		CMD_PROTOCOL,			g_filterProtocolCommands,	"L4 protocol"},
+	{"src-ip",			CMD_SRC_IP,				g_filterIpCommands,			"Source IP address"},
+	{"src-mac",			CMD_SRC_MAC,			g_filterMacCommands,		"Source MAC address"},
+	{"src-port",		CMD_SRC_PORT,			g_filterPortCommands,		"Source port"},
+	{"vlan",			CMD_VLAN,				g_filterVlanCommands,		"802.1Q VLAN ID"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterRuleCommands[] =
+{
+	{"action",			CMD_ACTION,				g_filterActionCommands,		"What to do with matching frames"},
+	{"match",			CMD_MATCH,				g_filterMatchCommands,		"Add a header field to compare"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterRuleIndexCommands[] =
+{
+	{"<rule>",			FREEFORM_TOKEN,			g_filterRuleCommands,		"Rule number (0-15), lowest matching rule wins"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_filterCommands[] =
+{
+	{"default",			CMD_DEFAULT,			g_filterActionCommands,		"What to do with frames no rule matches"},
+	{"rule",			CMD_RULE,				g_filterRuleIndexCommands,	"Configure one rule"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "no" (top level)
+
+static const clikeyword_t g_noFilterMatchCommands[] =
+{
+	{"dst-ip",			CMD_DST_IP,				nullptr,					"Destination IP address"},
+	{"dst-mac",			CMD_DST_MAC,			nullptr,					"Destination MAC address"},
+	{"dst-port",		CMD_DST_PORT,			nullptr,					"Destination port"},
+	{"ethertype",		CMD_ETHERTYPE,			nullptr,					"EtherType"},
+	{"protocol",		CMD_PROTOCOL,			nullptr,					"L4 protocol"},
+	{"src-ip",			CMD_SRC_IP,				nullptr,					"Source IP address"},
+	{"src-mac",			CMD_SRC_MAC,			nullptr,					"Source MAC address"},
+	{"src-port",		CMD_SRC_PORT,			nullptr,					"Source port"},
+	{"vlan",			CMD_VLAN,				nullptr,					"802.1Q VLAN ID"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_noFilterRuleCommands[] =
+{
+	{"match",			CMD_MATCH,				g_noFilterMatchCommands,	"Stop comparing a header field"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_noFilterRuleIndexCommands[] =
+{
+	{"<rule>",			FREEFORM_TOKEN,			g_noFilterRuleCommands,		"Rule number (0-15), deleted unless a field is given"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_noFilterCommands[] =
+{
+	{"default",			CMD_DEFAULT,			nullptr,					"Send frames no rule matches to the monitor port"},
+	{"rule",			CMD_RULE,				g_noFilterRuleIndexCommands,	"Delete a rule, or one of its fields"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_noMonitorPortCommands[] =
+{
+	{"mona",			CMD_MONA,				nullptr,					"Frames received on porta"},
+	{"monb",			CMD_MONB,				nullptr,					"Frames received on portb"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_noMonitorCommands[] =
+{
+	{"aggregate",		CMD_AGGREGATE,			nullptr,					"Send each direction out its own monitor port"},
+	{"sample",			CMD_SAMPLE,				g_noMonitorPortCommands,	"Forward every monitored frame"},
+	{"snaplen",			CMD_SNAPLEN,			g_noMonitorPortCommands,	"Forward whole frames"},
+	{"tag",				CMD_TAG,				nullptr,					"Forward monitored frames unmodified"},
+	{"timestamp",		CMD_TIMESTAMP,			nullptr,					"Stop appending arrival time"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
+static const clikeyword_t g_noCommands[] =
+{
+	{"filter",			CMD_FILTER,				g_noFilterCommands,			"Monitor filter rules"},
+	{"monitor",			CMD_MONITOR,			g_noMonitorCommands,		"Monitor port settings"},
+	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // "mode"
 
@@ -281,10 +610,15 @@ static const clikeyword_t g_testpatternCommands[] =
 
 static const clikeyword_t g_rootCommands[] =
 {
+	{"clear",			CMD_CLEAR,				g_clearCommands,			"Reset statistics"},
+	{"clock",			CMD_CLOCK,				g_clockCommands,			"Configure arrival timestamps"},
+	{"filter",			CMD_FILTER,				g_filterCommands,			"Configure monitor filter rules"},
 	{"interface",		CMD_INTERFACE,			g_interfaceCommands,		"Interface properties"},
+	{"monitor",			CMD_MONITOR,			g_monitorCommands,			"Configure monitor ports"},
+	{"no",				CMD_NO,					g_noCommands,				"Turn settings off"},
 	{"reload",			CMD_RELOAD,				nullptr,					"Restart the system"},
 	{"show",			CMD_SHOW,				g_showCommands,				"Print information"},
-	{"test",			CMD_TEST,				g_interfaceCommands,		"Run a cable test"},
+	{"test",			CMD_TEST,				g_testCommands,				"Run a cable test"},
 	{"trigger",			CMD_TRIGGER,			g_triggerCommands,			"Configure oscilloscope trigger sync output"},
 	{nullptr,			INVALID_COMMAND,		nullptr,					nullptr}
 };
@@ -327,6 +661,10 @@ TapCLISessionContext::TapCLISessionContext()
 
 void TapCLISessionContext::PrintPrompt()
 {
+	//Don't show a prompt while a long-running command is still producing output
+	if(IsBackgroundJobRunning())
+		return;
+
 	if(m_rootCommands == g_interfaceRootCommands)
 		m_stream->Printf("tap(%s)$ ", g_portDescriptions[m_activeInterface]);
 	else
@@ -345,10 +683,22 @@ void TapCLISessionContext::OnExecute()
 			OnAutonegotiation();
 			break;
 
+		case CMD_CLEAR:
+			OnClearCommand();
+			break;
+
+		case CMD_CLOCK:
+			OnClockCommand();
+			break;
+
 		case CMD_EXIT:
 			m_rootCommands = g_rootCommands;
 			break;
 
+		case CMD_FILTER:
+			OnFilterCommand();
+			break;
+
 		case CMD_INTERFACE:
 			OnInterfaceCommand();
 			break;
@@ -361,6 +711,10 @@ void TapCLISessionContext::OnExecute()
 			OnModeCommand();
 			break;
 
+		case CMD_MONITOR:
+			OnMonitorCommand();
+			break;
+
 		case CMD_NO:
 			OnNoCommand();
 			break;
@@ -399,6 +753,440 @@ void TapCLISessionContext::OnExecute()
 	m_stream->Flush();
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "clear"
+
+void TapCLISessionContext::OnClearCommand()
+{
+	switch(m_command[1].m_commandID)
+	{
+		case CMD_COUNTERS:
+			RmonClear(0x3);
+			PathStatsClear(0xf);
+			FilterHitsClear();
+			SampleStatsClear();
+			break;
+
+		case CMD_PROFILE:
+			ProfilerClear();
+			break;
+
+		default:
+			break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "clock"
+
+void TapCLISessionContext::OnClockCommand()
+{
+	if(m_command[1].m_commandID != CMD_SET)
+		return;
+
+	//Plain decimal parse, strtol is only 32 bits here
+	uint64_t seconds = 0;
+	for(const char* p = m_command[2].m_text; *p; p++)
+	{
+		if(!isdigit(*p))
+		{
+			m_stream->Printf("Invalid time\n");
+			return;
+		}
+		seconds = seconds*10 + (*p - '0');
+	}
+
+	TimestampSet(seconds * 1000000000ULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "filter"
+
+/**
+	@brief Parses a rule number, or returns -1 if it's not a valid one
+ */
+static int ParseFilterRule(const char* text)
+{
+	char* end;
+	auto rule = strtol(text, &end, 10);
+	if( (end == text) || (*end != '\0') || (rule < 0) || (rule >= FILTER_RULES) )
+		return -1;
+	return rule;
+}
+
+static filteraction_t FilterActionFromCommand(uint16_t cmd)
+{
+	switch(cmd)
+	{
+		case CMD_DROP:		return FILTER_DROP;
+		case CMD_TRUNCATE:	return FILTER_TRUNCATE;
+		default:			return FILTER_MIRROR;
+	}
+}
+
+static filterfield_t FilterFieldFromCommand(uint16_t cmd)
+{
+	switch(cmd)
+	{
+		case CMD_DST_IP:	return FIELD_DST_IP;
+		case CMD_DST_MAC:	return FIELD_DST_MAC;
+		case CMD_DST_PORT:	return FIELD_DST_PORT;
+		case CMD_ETHERTYPE:	return FIELD_ETHERTYPE;
+		case CMD_PROTOCOL:	return FIELD_PROTOCOL;
+		case CMD_SRC_IP:	return FIELD_SRC_IP;
+		case CMD_SRC_MAC:	return FIELD_SRC_MAC;
+		case CMD_SRC_PORT:	return FIELD_SRC_PORT;
+		case CMD_VLAN:		return FIELD_VLAN;
+		default:			return FIELD_COUNT;
+	}
+}
+
+static int HexDigit(char c)
+{
+	if( (c >= '0') && (c <= '9') )
+		return c - '0';
+	if( (c >= 'a') && (c <= 'f') )
+		return c - 'a' + 10;
+	if( (c >= 'A') && (c <= 'F') )
+		return c - 'A' + 10;
+	return -1;
+}
+
+/**
+	@brief Parses a MAC address in xx:xx:xx:xx:xx:xx form
+ */
+static bool ParseMac(const char* p, uint8_t* mac)
+{
+	for(int i=0; i<6; i++)
+	{
+		int value = 0;
+		int digits = 0;
+		for(; HexDigit(*p) >= 0; p++)
+		{
+			if(++digits > 2)
+				return false;
+			value = value*16 + HexDigit(*p);
+		}
+		if(digits == 0)
+			return false;
+		mac[i] = value;
+
+		if(i < 5)
+		{
+			if(*p != ':')
+				return false;
+			p++;
+		}
+	}
+	return (*p == '\0');
+}
+
+/**
+	@brief Parses a dotted quad IPv4 address, mapped to ::ffff:a.b.c.d like the FPGA does
+ */
+static bool ParseIPv4(const char* p, uint8_t* ip)
+{
+	memset(ip, 0, 16);
+	ip[10] = 0xff;
+	ip[11] = 0xff;
+
+	for(int i=0; i<4; i++)
+	{
+		int value = 0;
+		int digits = 0;
+		for(; isdigit(*p); p++)
+		{
+			if(++digits > 3)
+				return false;
+			value = value*10 + (*p - '0');
+		}
+		if( (digits == 0) || (value > 255) )
+			return false;
+		ip[12 + i] = value;
+
+		if(i < 3)
+		{
+			if(*p != '.')
+				return false;
+			p++;
+		}
+	}
+	return (*p == '\0');
+}
+
+/**
+	@brief Parses an IPv6 address, with at most one "::" (no embedded IPv4)
+ */
+static bool ParseIPv6(const char* p, uint8_t* ip)
+{
+	uint16_t groups[8];
+	int count = 0;
+	int gap = -1;		//group index the "::" expands at
+
+	if( (p[0] == ':') && (p[1] == ':') )
+	{
+		gap = 0;
+		p += 2;
+	}
+
+	while(*p)
+	{
+		if(count == 8)
+			return false;
+
+		int value = 0;
+		int digits = 0;
+		for(; HexDigit(*p) >= 0; p++)
+		{
+			if(++digits > 4)
+				return false;
+			value = value*16 + HexDigit(*p);
+		}
+		if(digits == 0)
+			return false;
+		groups[count++] = value;
+
+		if(*p == '\0')
+			break;
+		if(*p != ':')
+			return false;
+		p++;
+
+		if(*p == ':')
+		{
+			if(gap >= 0)
+				return false;
+			gap = count;
+			p++;
+		}
+		else if(*p == '\0')
+			return false;
+	}
+
+	if( (gap < 0) ? (count != 8) : (count > 7) )
+		return false;
+
+	memset(ip, 0, 16);
+	for(int i=0; i<count; i++)
+	{
+		int slot = ( (gap >= 0) && (i >= gap) ) ? (i + 8 - count) : i;
+		ip[slot*2] = groups[i] >> 8;
+		ip[slot*2 + 1] = groups[i] & 0xff;
+	}
+	return true;
+}
+
+/**
+	@brief Sets a field of a rule, comparing only the first "bits" bits
+ */
+static void SetFilterField(FilterRule& rule, filterfield_t field, const uint8_t* value, int bits)
+{
+	auto& f = g_filterFields[field];
+	for(int i=0; i<f.len; i++)
+	{
+		int n = bits - i*8;
+		rule.value[f.offset + i] = value[i];
+		if(n >= 8)
+			rule.mask[f.offset + i] = 0xff;
+		else if(n <= 0)
+			rule.mask[f.offset + i] = 0;
+		else
+			rule.mask[f.offset + i] = 0xff << (8 - n);
+	}
+}
+
+static void ClearFilterField(FilterRule& rule, filterfield_t field)
+{
+	auto& f = g_filterFields[field];
+	memset(rule.value + f.offset, 0, f.len);
+	memset(rule.mask + f.offset, 0, f.len);
+}
+
+static bool IsFilterFieldSet(const FilterRule& rule, filterfield_t field)
+{
+	auto& f = g_filterFields[field];
+	for(int i=0; i<f.len; i++)
+	{
+		if(rule.mask[f.offset + i])
+			return true;
+	}
+	return false;
+}
+
+void TapCLISessionContext::OnFilterCommand()
+{
+	if(m_command[1].m_commandID == CMD_DEFAULT)
+	{
+		g_monitorConfig.filterDefault = FilterActionFromCommand(m_command[2].m_commandID);
+		MonitorConfigApply();
+		return;
+	}
+
+	int rule = ParseFilterRule(m_command[2].m_text);
+	if(rule < 0)
+	{
+		m_stream->Printf("Invalid rule number (must be 0-%d)\n", FILTER_RULES - 1);
+		return;
+	}
+
+	switch(m_command[3].m_commandID)
+	{
+		case CMD_ACTION:
+			g_filterRules[rule].action = FilterActionFromCommand(m_command[4].m_commandID);
+			break;
+
+		case CMD_MATCH:
+			OnFilterMatch(g_filterRules[rule]);
+			break;
+
+		default:
+			return;
+	}
+
+	FilterRuleApply(rule);
+}
+
+/**
+	@brief Handles "filter rule <n> match <field> <value> [<prefix-len>]"
+ */
+void TapCLISessionContext::OnFilterMatch(FilterRule& rule)
+{
+	auto field = FilterFieldFromCommand(m_command[4].m_commandID);
+	const char* text = m_command[5].m_text;
+
+	//Prefix length is only meaningful for addresses
+	bool hasPrefix = (m_command[6].m_commandID == FREEFORM_TOKEN);
+	int prefix = hasPrefix ? strtol(m_command[6].m_text, nullptr, 10) : -1;
+
+	uint8_t value[16];
+	switch(field)
+	{
+		case FIELD_DST_MAC:
+		case FIELD_SRC_MAC:
+			if(!ParseMac(text, value))
+			{
+				m_stream->Printf("Invalid MAC address\n");
+				return;
+			}
+			if(!hasPrefix)
+				prefix = 48;
+			if( (prefix < 0) || (prefix > 48) )
+			{
+				m_stream->Printf("Invalid prefix length (must be 0-48)\n");
+				return;
+			}
+			SetFilterField(rule, field, value, prefix);
+			break;
+
+		//Also pin the IP version, so an IPv4 rule can't match IPv6 traffic and vice versa
+		case FIELD_DST_IP:
+		case FIELD_SRC_IP:
+			{
+				uint8_t version;
+				int maxPrefix;
+				if(strchr(text, ':'))
+				{
+					version = 6;
+					maxPrefix = 128;
+					if(!ParseIPv6(text, value))
+					{
+						m_stream->Printf("Invalid IPv6 address\n");
+						return;
+					}
+				}
+				else
+				{
+					version = 4;
+					maxPrefix = 32;
+					if(!ParseIPv4(text, value))
+					{
+						m_stream->Printf("Invalid IPv4 address\n");
+						return;
+					}
+				}
+
+				if(!hasPrefix)
+					prefix = maxPrefix;
+				if( (prefix < 0) || (prefix > maxPrefix) )
+				{
+					m_stream->Printf("Invalid prefix length (must be 0-%d)\n", maxPrefix);
+					return;
+				}
+
+				SetFilterField(rule, field, value, prefix + 128 - maxPrefix);
+				SetFilterField(rule, FIELD_IP_VERSION, &version, 8);
+			}
+			break;
+
+		case FIELD_ETHERTYPE:
+			{
+				char* end;
+				auto ethertype = strtol(text, &end, 16);
+				if( (end == text) || (*end != '\0') || (ethertype < 0) || (ethertype > 0xffff) )
+				{
+					m_stream->Printf("Invalid EtherType\n");
+					return;
+				}
+				value[0] = ethertype >> 8;
+				value[1] = ethertype & 0xff;
+				SetFilterField(rule, field, value, 16);
+			}
+			break;
+
+		//Tagged flag plus VID, PCP/DEI are ignored
+		case FIELD_VLAN:
+			{
+				auto& f = g_filterFields[field];
+				if(!strcmp(text, "untagged"))
+				{
+					rule.value[f.offset] = 0;
+					rule.value[f.offset + 1] = 0;
+					rule.mask[f.offset] = 0x80;
+					rule.mask[f.offset + 1] = 0;
+				}
+				else
+				{
+					char* end;
+					auto vid = strtol(text, &end, 10);
+					if( (end == text) || (*end != '\0') || (vid < 0) || (vid > 4095) )
+					{
+						m_stream->Printf("Invalid VLAN ID (must be 0-4095, or \"untagged\")\n");
+						return;
+					}
+					rule.value[f.offset] = 0x80 | (vid >> 8);
+					rule.value[f.offset + 1] = vid & 0xff;
+					rule.mask[f.offset] = 0x8f;
+					rule.mask[f.offset + 1] = 0xff;
+				}
+			}
+			break;
+
+		case FIELD_PROTOCOL:
+		case FIELD_DST_PORT:
+		case FIELD_SRC_PORT:
+			{
+				int maxValue = (field == FIELD_PROTOCOL) ? 0xff : 0xffff;
+				char* end;
+				auto number = strtol(text, &end, 10);
+				if( (end == text) || (*end != '\0') || (number < 0) || (number > maxValue) )
+				{
+					m_stream->Printf("Invalid value (must be 0-%d)\n", maxValue);
+					return;
+				}
+				value[0] = number >> 8;
+				value[1] = number & 0xff;
+				if(field == FIELD_PROTOCOL)
+					SetFilterField(rule, field, value + 1, 8);
+				else
+					SetFilterField(rule, field, value, 16);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // "interface"
 
@@ -440,17 +1228,96 @@ void TapCLISessionContext::OnNoCommand()
 			OnNoAutonegotiation();
 			break;
 
+		case CMD_FILTER:
+			OnNoFilter();
+			break;
+
+		case CMD_MONITOR:
+			OnNoMonitor();
+			break;
+
 		case CMD_SPEED:
 			OnNoSpeed();
 			break;
 
-		case CMD_TESTPATTERN:
-			OnNoTestPattern();
+		case CMD_TESTPATTERN:
+			OnNoTestPattern();
+			break;
+
+		default:
+			break;
+	}
+}
+
+void TapCLISessionContext::OnNoFilter()
+{
+	if(m_command[2].m_commandID == CMD_DEFAULT)
+	{
+		g_monitorConfig.filterDefault = FILTER_OFF;
+		MonitorConfigApply();
+		return;
+	}
+
+	int rule = ParseFilterRule(m_command[3].m_text);
+	if(rule < 0)
+	{
+		m_stream->Printf("Invalid rule number (must be 0-%d)\n", FILTER_RULES - 1);
+		return;
+	}
+
+	auto& r = g_filterRules[rule];
+	if(m_command[4].m_commandID == CMD_MATCH)
+	{
+		ClearFilterField(r, FilterFieldFromCommand(m_command[5].m_commandID));
+
+		//IP version only means something as part of an address match
+		if(!IsFilterFieldSet(r, FIELD_SRC_IP) && !IsFilterFieldSet(r, FIELD_DST_IP))
+			ClearFilterField(r, FIELD_IP_VERSION);
+	}
+	else
+		memset(&r, 0, sizeof(r));
+
+	FilterRuleApply(rule);
+}
+
+void TapCLISessionContext::OnNoMonitor()
+{
+	switch(m_command[2].m_commandID)
+	{
+		case CMD_AGGREGATE:
+			g_monitorConfig.aggregate = false;
+			break;
+
+		case CMD_TAG:
+			g_monitorConfig.tagMode = MON_TAG_NONE;
+			break;
+
+		case CMD_TIMESTAMP:
+			g_monitorConfig.timestamp = false;
+			break;
+
+		case CMD_SNAPLEN:
+			{
+				int i = (m_command[3].m_commandID == CMD_MONB) ? 1 : 0;
+				g_monitorConfig.snaplen[i] = 0;
+				g_monitorConfig.snapHeader[i] = false;
+				g_monitorConfig.snapTrailer[i] = false;
+			}
+			break;
+
+		case CMD_SAMPLE:
+			{
+				int i = (m_command[3].m_commandID == CMD_MONB) ? 1 : 0;
+				g_monitorConfig.sampleMode[i] = SAMPLE_OFF;
+				g_monitorConfig.sampleRate[i] = 1;
+			}
 			break;
 
 		default:
-			break;
+			return;
 	}
+
+	MonitorConfigApply();
 }
 
 void TapCLISessionContext::OnNoSpeed()
@@ -484,6 +1351,8 @@ void TapCLISessionContext::OnNoSpeed()
 void TapCLISessionContext::OnReload()
 {
 	g_log("Reload requested\n");
+	g_log.Flush();
+	g_cliUART->BlockingFlush();
 	SCB.AIRCR = 0x05fa0004;
 	while(1)
 	{}
@@ -519,7 +1388,11 @@ void TapCLISessionContext::OnSetMmdRegister()
 	int mmd = strtol(m_command[2].m_text, nullptr, 16);
 	int regid = strtol(m_command[4].m_text, nullptr, 16);
 	auto value = strtol(m_command[5].m_text, nullptr, 16);
-	PhyRegisterIndirectWrite(m_activeInterface, mmd, regid, value);
+	if(!PhyRegisterIndirectWrite(m_activeInterface, mmd, regid, value))
+	{
+		m_stream->Printf("MDIO timeout writing PHY registers\n");
+		return;
+	}
 	m_stream->Printf("Set MMD %02x register 0x%04x to 0x%04x\n", mmd, regid, value);
 }
 
@@ -534,6 +1407,18 @@ void TapCLISessionContext::OnShowCommand()
 			OnShowDetail();
 			break;
 
+		case CMD_CLOCK:
+			OnShowClock();
+			break;
+
+		case CMD_DATAPATH:
+			OnShowDatapath();
+			break;
+
+		case CMD_FILTER:
+			OnShowFilter();
+			break;
+
 		case CMD_HARDWARE:
 			OnShowHardware();
 			break;
@@ -541,6 +1426,14 @@ void TapCLISessionContext::OnShowCommand()
 		case CMD_INTERFACE:
 			switch(m_command[2].m_commandID)
 			{
+				case CMD_COUNTERS:
+					OnShowInterfaceCounters();
+					break;
+
+				case CMD_HISTOGRAM:
+					OnShowInterfaceHistogram();
+					break;
+
 				case CMD_STATUS:
 					OnShowInterfaceStatus();
 					break;
@@ -550,10 +1443,26 @@ void TapCLISessionContext::OnShowCommand()
 			}
 			break;
 
+		case CMD_LOGGING:
+			OnShowLogging();
+			break;
+
+		case CMD_MDIO:
+			OnShowMdio();
+			break;
+
 		case CMD_MMD:
 			OnShowMmdRegister();
 			break;
 
+		case CMD_MONITOR:
+			OnShowMonitor();
+			break;
+
+		case CMD_PROFILE:
+			OnShowProfile();
+			break;
+
 		case CMD_REGISTER:
 			OnShowRegister();
 			break;
@@ -562,6 +1471,10 @@ void TapCLISessionContext::OnShowCommand()
 			OnShowSpeed();
 			break;
 
+		case CMD_TASKS:
+			OnShowTasks();
+			break;
+
 		case CMD_VERSION:
 			OnShowVersion();
 			break;
@@ -574,8 +1487,32 @@ void TapCLISessionContext::OnShowCommand()
 
 void TapCLISessionContext::OnShowDetail()
 {
-	auto base = PhyRegisterRead(m_activeInterface, PHY_REG_BASIC_CONTROL);
-	auto status = PhyRegisterRead(m_activeInterface, PHY_REG_BASIC_STATUS);
+	//Fetch every register we're going to display in one batch
+	uint8_t p = m_activeInterface;
+	PhyTransaction regs[13] =
+	{
+		{ p, false, PHY_REG_BASIC_CONTROL,			0 },
+		{ p, false, PHY_REG_BASIC_STATUS,			0 },
+		{ p, false, PHY_REG_AN_ADVERT,				0 },
+		{ p, false, PHY_REG_AN_PARTNER,				0 },
+		{ p, false, PHY_REG_AN_EXPANSION,			0 },
+		{ p, false, PHY_REG_AN_PARTNER_NEXT_PAGE,	0 },
+		{ p, false, PHY_REG_GIG_CONTROL,			0 },
+		{ p, false, PHY_REG_GIG_STATUS,				0 },
+		{ p, false, PHY_REG_REMOTE_LOOPBACK,		0 },
+		{ p, false, PHY_REG_DIGITAL_PCS_PMA,		0 },
+		{ p, false, PHY_REG_RX_ER,					0 },
+		{ p, false, PHY_REG_MDIX,					0 },
+		{ p, false, PHY_REG_CTRL,					0 }
+	};
+	if(!PhyBatchExecute(regs, 13))
+	{
+		m_stream->Printf("MDIO timeout reading PHY registers\n");
+		return;
+	}
+
+	auto base = regs[0].value;
+	auto status = regs[1].value;
 	bool aneg = (base & 0x1000) == 0x1000;
 
 	//RGMII in-band status
@@ -661,7 +1598,7 @@ void TapCLISessionContext::OnShowDetail()
 		m_stream->Printf("    No jabber detected\n");
 
 	//Autonegotiation advertisement
-	auto ad = PhyRegisterRead(m_activeInterface, PHY_REG_AN_ADVERT);
+	auto ad = regs[2].value;
 	m_stream->Printf("Autonegotiation Advertisement = 0x%04x\n", ad);
 	if(ad & 0x8000)
 		m_stream->Printf("    Next page\n");
@@ -712,7 +1649,7 @@ void TapCLISessionContext::OnShowDetail()
 		m_stream->Printf("    Selector: 0x%02x (invalid)\n", sel);
 
 	//Autonegotiation advertisement
-	ad = PhyRegisterRead(m_activeInterface, PHY_REG_AN_PARTNER);
+	ad = regs[3].value;
 	m_stream->Printf("Autonegotiation Link Partner Ability = 0x%04x\n", ad);
 	if(ad & 0x8000)
 		m_stream->Printf("    Next page\n");
@@ -774,7 +1711,7 @@ void TapCLISessionContext::OnShowDetail()
 	More();
 
 	//AN expansion
-	auto exp = PhyRegisterRead(m_activeInterface, PHY_REG_AN_EXPANSION);
+	auto exp = regs[4].value;
 	m_stream->Printf("Autonegotiation Expansion = 0x%04x\n", exp);
 	if(exp & 0x10)
 		m_stream->Printf("    Parallel detection: fault\n");
@@ -792,7 +1729,7 @@ void TapCLISessionContext::OnShowDetail()
 	//Don't dump AN_NEXT_PAGE as that's outbound only
 
 	//Link partner next page
-	auto pnp = PhyRegisterRead(m_activeInterface, PHY_REG_AN_PARTNER_NEXT_PAGE);
+	auto pnp = regs[5].value;
 	m_stream->Printf("Link Partner Next Page = 0x%04x\n", pnp);
 	if(pnp & 0x8000)
 		m_stream->Printf("    Additional pages to follow\n");
@@ -814,7 +1751,7 @@ void TapCLISessionContext::OnShowDetail()
 	m_stream->Printf("    Message = 0x%03x\n", pnp & 0x3ff);
 
 	//1000base-T Control
-	auto gig = PhyRegisterRead(m_activeInterface, PHY_REG_GIG_CONTROL);
+	auto gig = regs[6].value;
 	m_stream->Printf("1000Base-T Control = 0x%04x\n", gig);
 	int test = (gig >> 13) & 7;
 	switch(test)
@@ -866,7 +1803,7 @@ void TapCLISessionContext::OnShowDetail()
 		m_stream->Printf("    Do not advertise 1000baseT half duplex\n");
 
 	//1000base-T Status
-	auto gstat = PhyRegisterRead(m_activeInterface, PHY_REG_GIG_STATUS);
+	auto gstat = regs[7].value;
 	m_stream->Printf("1000Base-T Status = 0x%04x\n", gstat);
 	if(gstat & 0x8000)
 		m_stream->Printf("    Master-slave configuration fault\n");
@@ -905,7 +1842,7 @@ void TapCLISessionContext::OnShowDetail()
 	//no register at 0x10
 
 	//Remote Loopback
-	auto rloop = PhyRegisterRead(m_activeInterface, PHY_REG_REMOTE_LOOPBACK);
+	auto rloop = regs[8].value;
 	m_stream->Printf("Remote Loopback = 0x%04x\n", rloop);
 	if(rloop & 0x100)
 		m_stream->Printf("    Remote loopback enabled\n");
@@ -914,7 +1851,7 @@ void TapCLISessionContext::OnShowDetail()
 
 	//ignore linkmd, we have separate commands for that
 
-	auto pcspma = PhyRegisterRead(m_activeInterface, PHY_REG_DIGITAL_PCS_PMA);
+	auto pcspma = regs[9].value;
 	m_stream->Printf("Digital PCS / PMA Status = 0x%04x\n", pcspma);
 	if(pcspma & 0x4)
 		m_stream->Printf("    1000baseT link OK\n");
@@ -928,14 +1865,14 @@ void TapCLISessionContext::OnShowDetail()
 
 	//no register at 0x14
 
-	auto rxer = PhyRegisterRead(m_activeInterface, PHY_REG_RX_ER);
+	auto rxer = regs[10].value;
 	m_stream->Printf("RX Error Count = %d\n", rxer);
 
 	//No registers at 0x16 - 0x1a
 
 	//Register 0x1B is interrupt enables, ignore: interrupt pin isn't even connected
 
-	auto mdix = PhyRegisterRead(m_activeInterface, PHY_REG_MDIX);
+	auto mdix = regs[11].value;
 	m_stream->Printf("Auto MDI-X Control = 0x%04x\n", mdix);
 	if(mdix & 0x40)
 	{
@@ -952,7 +1889,7 @@ void TapCLISessionContext::OnShowDetail()
 	More();
 
 	//PHY Control
-	auto ctrl = PhyRegisterRead(m_activeInterface, PHY_REG_CTRL);
+	auto ctrl = regs[12].value;
 	m_stream->Printf("PHY Control = 0x%04x\n", ctrl);
 	if(ctrl & 0x200)
 		m_stream->Printf("    Jabber counter enabled\n");
@@ -1003,6 +1940,244 @@ void TapCLISessionContext::More()
 	g_cliUART->BlockingRead();
 }
 
+/**
+	@brief Formats a 64-bit count in decimal, since Printf only handles 32 bits
+ */
+static void FormatCount(char* buf, uint64_t value)
+{
+	char tmp[21];
+	int len = 0;
+	do
+	{
+		tmp[len++] = '0' + (value % 10);
+		value /= 10;
+	} while(value);
+
+	for(int i=0; i<len; i++)
+		buf[i] = tmp[len - 1 - i];
+	buf[len] = '\0';
+}
+
+void TapCLISessionContext::OnShowInterfaceCounters()
+{
+	RmonCounters counters[RMON_PORTS];
+	if(!RmonSnapshot(counters))
+		m_stream->Printf("Warning: snapshot incomplete (no RX clock?), some values may be stale\n");
+
+	m_stream->Printf("Counter               porta (A->B)          portb (B->A)\n");
+	for(int i=0; i<RMON_COUNT; i++)
+	{
+		char a[21];
+		char b[21];
+		FormatCount(a, counters[0].values[i]);
+		FormatCount(b, counters[1].values[i]);
+		m_stream->Printf("%-12s  %20s  %20s\n", g_rmonNames[i], a, b);
+	}
+}
+
+void TapCLISessionContext::OnShowInterfaceHistogram()
+{
+	RmonHistogram histograms[RMON_PORTS];
+	if(!RmonHistogramSnapshot(histograms))
+		m_stream->Printf("Warning: snapshot incomplete (no RX clock?), some values may be stale\n");
+
+	m_stream->Printf("Size (bytes)          porta (A->B)          portb (B->A)\n");
+	for(int i=0; i<RMON_BIN_COUNT; i++)
+	{
+		char a[21];
+		char b[21];
+		FormatCount(a, histograms[0].bins[i]);
+		FormatCount(b, histograms[1].bins[i]);
+		m_stream->Printf("%-13s %20s  %20s\n", g_rmonBinNames[i], a, b);
+	}
+}
+
+void TapCLISessionContext::OnShowClock()
+{
+	uint64_t ns = TimestampRead();
+
+	char seconds[21];
+	FormatCount(seconds, ns / 1000000000ULL);
+
+	char frac[10];
+	uint32_t rem = ns % 1000000000ULL;
+	for(int i=8; i>=0; i--)
+	{
+		frac[i] = '0' + (rem % 10);
+		rem /= 10;
+	}
+	frac[9] = '\0';
+
+	m_stream->Printf("Timestamp counter: %s.%s s\n", seconds, frac);
+	m_stream->Printf("Arrival timestamps are %s\n", g_monitorConfig.timestamp ? "enabled" : "disabled");
+}
+
+/**
+	@brief Number of leading one bits in a field's mask
+ */
+static int FilterPrefixLength(const FilterRule& rule, const FilterField& f)
+{
+	int bits = 0;
+	for(int i=0; i<f.len; i++)
+	{
+		uint8_t m = rule.mask[f.offset + i];
+		for(int j=7; (j >= 0) && (m & (1 << j)); j--)
+			bits ++;
+		if(m != 0xff)
+			break;
+	}
+	return bits;
+}
+
+/**
+	@brief Prints one field of a rule the way it would be typed in
+ */
+static void PrintFilterField(CLIOutputStream* stream, const FilterRule& rule, filterfield_t field)
+{
+	auto& f = g_filterFields[field];
+	const uint8_t* v = rule.value + f.offset;
+	int prefix = FilterPrefixLength(rule, f);
+	stream->Printf(" %s ", f.name);
+
+	switch(field)
+	{
+		case FIELD_DST_MAC:
+		case FIELD_SRC_MAC:
+			stream->Printf("%02x:%02x:%02x:%02x:%02x:%02x", v[0], v[1], v[2], v[3], v[4], v[5]);
+			if(prefix < 48)
+				stream->Printf(" %d", prefix);
+			break;
+
+		case FIELD_DST_IP:
+		case FIELD_SRC_IP:
+			{
+				static const uint8_t mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+				if( (prefix >= 96) && !memcmp(v, mapped, sizeof(mapped)) )
+				{
+					stream->Printf("%d.%d.%d.%d", v[12], v[13], v[14], v[15]);
+					if(prefix < 128)
+						stream->Printf(" %d", prefix - 96);
+				}
+				else
+				{
+					//Compress the longest run of zero groups
+					int bestStart = -1;
+					int bestLen = 1;
+					for(int i=0; i<8; )
+					{
+						int len = 0;
+						while( (i + len < 8) && (v[(i+len)*2] == 0) && (v[(i+len)*2 + 1] == 0) )
+							len ++;
+						if(len > bestLen)
+						{
+							bestStart = i;
+							bestLen = len;
+						}
+						i += len ? len : 1;
+					}
+
+					for(int i=0; i<8; i++)
+					{
+						if(i == bestStart)
+						{
+							stream->Printf("::");
+							i += bestLen - 1;
+							continue;
+						}
+						if( (i > 0) && (i != bestStart + bestLen) )
+							stream->Printf(":");
+						stream->Printf("%x", (v[i*2] << 8) | v[i*2 + 1]);
+					}
+					if(prefix < 128)
+						stream->Printf(" %d", prefix);
+				}
+			}
+			break;
+
+		case FIELD_ETHERTYPE:
+			stream->Printf("%04x", (v[0] << 8) | v[1]);
+			break;
+
+		case FIELD_VLAN:
+			if(rule.mask[f.offset] & 0x0f)
+				stream->Printf("%d", ((v[0] & 0x0f) << 8) | v[1]);
+			else
+				stream->Printf("untagged");
+			break;
+
+		case FIELD_PROTOCOL:
+			stream->Printf("%d", v[0]);
+			break;
+
+		default:
+			stream->Printf("%d", (v[0] << 8) | v[1]);
+			break;
+	}
+}
+
+void TapCLISessionContext::OnShowFilter()
+{
+	uint32_t hits[2][FILTER_RULES];
+	if(!FilterHitsSnapshot(hits))
+		m_stream->Printf("Warning: snapshot incomplete (no RX clock?), some values may be stale\n");
+
+	m_stream->Printf("Rule  Action      porta hits  portb hits  Match\n");
+	for(int i=0; i<FILTER_RULES; i++)
+	{
+		auto& rule = g_filterRules[i];
+
+		bool any = false;
+		for(int j=0; j<FIELD_COUNT; j++)
+			any |= IsFilterFieldSet(rule, static_cast<filterfield_t>(j));
+		if( (rule.action == FILTER_OFF) && !any)
+			continue;
+
+		char a[21];
+		char b[21];
+		FormatCount(a, hits[0][i]);
+		FormatCount(b, hits[1][i]);
+		m_stream->Printf("%4d  %-8s  %10s  %10s ", i, g_filterActionNames[rule.action], a, b);
+
+		//IP version is implied by the address
+		for(int j=0; j<FIELD_COUNT; j++)
+		{
+			auto field = static_cast<filterfield_t>(j);
+			if( (field != FIELD_IP_VERSION) && IsFilterFieldSet(rule, field) )
+				PrintFilterField(m_stream, rule, field);
+		}
+		if(!any)
+			m_stream->Printf(" any");
+		m_stream->Printf("\n");
+	}
+
+	auto def = g_monitorConfig.filterDefault;
+	m_stream->Printf("Frames no rule matches: %s\n", g_filterActionNames[(def == FILTER_OFF) ? FILTER_MIRROR : def]);
+}
+
+void TapCLISessionContext::OnShowDatapath()
+{
+	PathStats stats[PATH_COUNT];
+	if(!PathStatsSnapshot(stats))
+		m_stream->Printf("Warning: snapshot incomplete (no RX clock?), some values may be stale\n");
+
+	m_stream->Printf("Path                  Dropped frames         Dropped bytes    FIFO high water\n");
+	for(int i=0; i<PATH_COUNT; i++)
+	{
+		char frames[21];
+		char bytes[21];
+		FormatCount(frames, stats[i].dropFrames);
+		FormatCount(bytes, stats[i].dropBytes);
+		//Both monitor paths feed mona when aggregated
+		const char* name = g_pathNames[i];
+		if( (i == PATH_B_TO_MON) && g_monitorConfig.aggregate)
+			name = "portb -> mona";
+
+		m_stream->Printf("%-16s  %18s  %20s  %6d / %6d\n",
+			name, frames, bytes, stats[i].highWater, stats[i].fifoSize);
+	}
+	m_stream->Printf("Drops between porta and portb are estimated from FIFO occupancy, not reported by the FIFO\n");
+}
+
 void TapCLISessionContext::OnShowInterfaceStatus()
 {
 	m_stream->Printf("----------------------------------------------------------------------------------\n");
@@ -1059,17 +2234,62 @@ void TapCLISessionContext::OnShowSpeed()
 
 void TapCLISessionContext::OnShowMmdRegister()
 {
+	if(m_command[3].m_commandID == CMD_RANGE)
+	{
+		OnShowMmdRange();
+		return;
+	}
+
 	int mmd = strtol(m_command[2].m_text, nullptr, 16);
 	int regid = strtol(m_command[4].m_text, nullptr, 16);
-	auto value = PhyRegisterIndirectRead(m_activeInterface, mmd, regid);
+	uint16_t value;
+	if(!PhyRegisterIndirectRead(m_activeInterface, mmd, regid, value))
+	{
+		m_stream->Printf("MDIO timeout reading PHY registers\n");
+		return;
+	}
 
 	m_stream->Printf("MMD %02x register 0x%04x = 0x%04x\n", mmd, regid, value);
 }
 
+void TapCLISessionContext::OnShowMmdRange()
+{
+	int mmd = strtol(m_command[2].m_text, nullptr, 16);
+	int start = strtol(m_command[4].m_text, nullptr, 16);
+	int count = strtol(m_command[5].m_text, nullptr, 10);
+	if( (count <= 0) || (count > 256) )
+	{
+		m_stream->Printf("Count must be between 1 and 256\n");
+		return;
+	}
+
+	uint16_t values[256];
+	if(!PhyRegisterIndirectReadRange(m_activeInterface, mmd, start, count, values))
+	{
+		m_stream->Printf("MDIO timeout reading PHY registers\n");
+		return;
+	}
+
+	//Eight registers per line
+	for(int i=0; i<count; i++)
+	{
+		if( (i % 8) == 0)
+			m_stream->Printf("MMD %02x 0x%04x:", mmd, (start + i) & 0xffff);
+		m_stream->Printf(" %04x", values[i]);
+		if( ( (i % 8) == 7) || (i == count-1) )
+			m_stream->Printf("\n");
+	}
+}
+
 void TapCLISessionContext::OnShowRegister()
 {
 	int regid = strtol(m_command[2].m_text, nullptr, 16);
-	auto value = PhyRegisterRead(m_activeInterface, regid);
+	uint16_t value;
+	if(!PhyRegisterRead(m_activeInterface, regid, value))
+	{
+		m_stream->Printf("MDIO timeout reading PHY registers\n");
+		return;
+	}
 
 	m_stream->Printf("Register 0x%02x = 0x%04x\n", regid, value);
 }
@@ -1116,6 +2336,196 @@ void TapCLISessionContext::OnShowVolatility()
 	m_stream->Printf("\n");
 }
 
+void TapCLISessionContext::OnShowMdio()
+{
+	uint8_t busy = PhyPollStatus();
+
+	m_stream->Printf("Interface   State  Timeouts  Cache hits  Cache misses\n");
+	for(int port = 0; port < 4; port ++)
+	{
+		m_stream->Printf("%-10s  %-5s  %8d  %10d  %12d\n",
+			g_portDescriptions[port],
+			(busy & (1 << port)) ? "busy" : "idle",
+			g_mdioTimeouts[port],
+			g_phyCacheHits[port],
+			g_phyCacheMisses[port]);
+	}
+	m_stream->Printf("Command queue batch timeouts: %d\n", g_mdioBatchTimeouts);
+}
+
+void TapCLISessionContext::OnShowMonitor()
+{
+	if(g_monitorConfig.aggregate)
+		m_stream->Printf("Mode:           aggregated (porta and portb -> mona, monb idle)\n");
+	else
+		m_stream->Printf("Mode:           separate (porta -> mona, portb -> monb)\n");
+
+	switch(g_monitorConfig.tagMode)
+	{
+		case MON_TAG_VLAN:
+			m_stream->Printf("Direction tag:  802.1Q, VID %d from porta, %d from portb\n",
+				g_monitorConfig.vlanId[0], g_monitorConfig.vlanId[1]);
+			break;
+
+		case MON_TAG_TRAILER:
+			m_stream->Printf("Direction tag:  trailer byte, 0 from porta, 1 from portb\n");
+			break;
+
+		default:
+			m_stream->Printf("Direction tag:  none\n");
+			break;
+	}
+
+	m_stream->Printf("Timestamps:     %s\n", g_monitorConfig.timestamp ? "appended" : "off");
+
+	static const char* names[2] = { "porta", "portb" };
+	for(int i=0; i<2; i++)
+	{
+		m_stream->Printf("Snap length:    %s: ", names[i]);
+		if(g_monitorConfig.snapHeader[i])
+		{
+			m_stream->Printf("end of L4 header");
+			if(g_monitorConfig.snaplen[i])
+				m_stream->Printf(" or %d bytes", g_monitorConfig.snaplen[i]);
+		}
+		else if(g_monitorConfig.snaplen[i])
+			m_stream->Printf("%d bytes", g_monitorConfig.snaplen[i]);
+		else
+			m_stream->Printf("whole frame");
+		if(g_monitorConfig.snapTrailer[i])
+			m_stream->Printf(", original length appended");
+		m_stream->Printf("\n");
+	}
+
+	SampleStats stats[2];
+	bool ok = SampleStatsSnapshot(stats);
+	for(int i=0; i<2; i++)
+	{
+		m_stream->Printf("Sampling:       %s: ", names[i]);
+		auto rate = g_monitorConfig.sampleRate[i];
+		switch(g_monitorConfig.sampleMode[i])
+		{
+			case SAMPLE_COUNT:
+				m_stream->Printf("1 in every %d frames", rate);
+				break;
+
+			case SAMPLE_RANDOM:
+				m_stream->Printf("1 in %d frames at random", rate);
+				break;
+
+			case SAMPLE_FLOW:
+				m_stream->Printf("1 in %d flows", rate);
+				break;
+
+			default:
+				m_stream->Printf("off");
+				break;
+		}
+
+		char kept[21];
+		char skipped[21];
+		FormatCount(kept, stats[i].kept);
+		FormatCount(skipped, stats[i].skipped);
+		m_stream->Printf(", %s kept, %s skipped\n", kept, skipped);
+	}
+	if(!ok)
+		m_stream->Printf("Warning: snapshot incomplete (no RX clock?), some values may be stale\n");
+}
+
+/**
+	@brief Prints a time in 100us timer ticks as milliseconds
+ */
+static void PrintTicks(CLIOutputStream* stream, uint32_t ticks)
+{
+	stream->Printf("%5d.%d ms", ticks / 10, ticks % 10);
+}
+
+void TapCLISessionContext::OnShowTasks()
+{
+	int count;
+	auto tasks = SchedulerGetTasks(count);
+
+	m_stream->Printf("Task          Period       Runs   Longest run\n");
+	for(int i=0; i<count; i++)
+	{
+		m_stream->Printf("%-12s  ", tasks[i].name);
+		if(tasks[i].period)
+			PrintTicks(m_stream, tasks[i].period);
+		else
+			m_stream->Printf("     event");
+		m_stream->Printf("  %9d  ", tasks[i].runs);
+		PrintTicks(m_stream, tasks[i].maxTime);
+		m_stream->Printf("\n");
+	}
+
+	auto& stats = g_schedulerStats;
+	m_stream->Printf("Main loop wakeups: %d\n", stats.loops);
+	m_stream->Printf("Worst case loop latency: ");
+	PrintTicks(m_stream, stats.maxLoopTime);
+	m_stream->Printf("\n");
+	m_stream->Printf("FPGA IRQ latency: ");
+	PrintTicks(m_stream, g_fpgaIrqLatencyLast);
+	m_stream->Printf(" last, ");
+	PrintTicks(m_stream, g_fpgaIrqLatencyMax);
+	m_stream->Printf(" worst, %d events dropped\n", g_fpgaEvents.GetOverflowCount());
+	m_stream->Printf("Console TX buffer: %d of %d bytes in use, high water mark %d, %d stalls\n",
+		g_cliUART->GetBufferedBytes(),
+		UART_TX_BUFFER_SIZE - 1,
+		g_cliUART->m_highWaterMark,
+		g_cliUART->m_stalls);
+	uint32_t total = stats.busyTime + stats.idleTime;
+	if(total)
+		m_stream->Printf("CPU load: %d%%\n", static_cast<int>( (100ULL * stats.busyTime) / total));
+}
+
+void TapCLISessionContext::OnShowLogging()
+{
+	m_stream->Printf("%d messages logged, %d rate limited, %d lost before printing\n",
+		g_log.m_logged, g_log.m_suppressed, g_log.m_dropped);
+	g_log.Replay(m_stream);
+}
+
+void TapCLISessionContext::OnShowProfile()
+{
+	//Convert cycles to microseconds at the current CPU clock
+	uint32_t cyclesPerUs = g_clockProfile->sysclkHz / 1000000;
+
+	m_stream->Printf("Cycle counts at %d MHz\n", cyclesPerUs);
+	m_stream->Printf("Probe            Count        Min        Avg        Max    Total (us)\n");
+	for(auto& probe : g_profileProbes)
+	{
+		if(probe.count == 0)
+		{
+			m_stream->Printf("%-12s  %8d\n", probe.name, 0);
+			continue;
+		}
+
+		m_stream->Printf("%-12s  %8d  %9d  %9d  %9d  %12d\n",
+			probe.name,
+			probe.count,
+			probe.minCycles,
+			static_cast<uint32_t>(probe.totalCycles / probe.count),
+			probe.maxCycles,
+			static_cast<uint32_t>(probe.totalCycles / cyclesPerUs));
+	}
+
+	//Histograms: only print the bins that were hit, labeled by the lower bound (2^n cycles)
+	m_stream->Printf("\nHistogram (count per power of two cycles)\n");
+	for(auto& probe : g_profileProbes)
+	{
+		if(probe.count == 0)
+			continue;
+
+		m_stream->Printf("%-12s ", probe.name);
+		for(int i=0; i<PROFILE_HIST_BINS; i++)
+		{
+			if(probe.histogram[i])
+				m_stream->Printf(" 2^%d:%d", i, probe.histogram[i]);
+		}
+		m_stream->Printf("\n");
+	}
+}
+
 void TapCLISessionContext::OnShowHardware()
 {
 	//Print main MCU information
@@ -1210,6 +2620,25 @@ void TapCLISessionContext::OnShowHardware()
 			'\0'
 		};
 		m_stream->Printf("    Lot %s, wafer %d, die (%d, %d)\n", waferLot, waferNum, waferX, waferY);
+
+		auto& clk = *g_clockProfile;
+		m_stream->Printf("    Clock profile: %s (%s)\n",
+			clk.name, g_clockProfileFromButton ? "selected by button at boot" : "default");
+		if(clk.usePLL)
+		{
+			m_stream->Printf("        PLL1: HSI 64 MHz / %d * %d / %d = %d MHz\n",
+				clk.pllPrediv, clk.pllMult, clk.pllDivP, clk.sysclkHz / 1000000);
+		}
+		else
+			m_stream->Printf("        HSI: %d MHz, PLL off\n", clk.sysclkHz / 1000000);
+		m_stream->Printf("        SYSCLK:         %3d MHz\n", clk.sysclkHz / 1000000);
+		m_stream->Printf("        AHB:            %3d MHz\n", clk.GetAHBClock() / 1000000);
+		m_stream->Printf("        APB1-4:         %3d.%03d MHz\n",
+			clk.GetAPBClock() / 1000000, (clk.GetAPBClock() / 1000) % 1000);
+		m_stream->Printf("        APB timers:     %3d MHz\n", clk.GetTimerClock() / 1000000);
+		m_stream->Printf("        QSPI SCK:       %3d.%03d MHz (AHB / %d)\n",
+			clk.GetQSPIClock() / 1000000, (clk.GetQSPIClock() / 1000) % 1000, clk.GetQSPIPrescale());
+		m_stream->Printf("        UART divisor:   %d\n", clk.GetUARTDivisor(115200));
 	}
 	else
 		g_log(Logger::WARNING, "Unknown device (0x%06x)\n", device);
@@ -1234,17 +2663,25 @@ void TapCLISessionContext::OnShowHardware()
 	m_stream->Printf("FPGA serial: %02x%02x%02x%02x%02x%02x%02x%02x\n", buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7]);
 
 	//Identify each PHY
+	uint16_t id1[4];
+	uint16_t id2[4];
+	PhyRegisterReadAll(PHY_REG_ID1, id1);
+	PhyRegisterReadAll(PHY_REG_ID2, id2);
 	for(int port = 0; port < 4; port ++)
 	{
 		m_stream->Printf("Ethernet interface %d (%s):\n", port, g_portDescriptions[port]);
 
-		//Identify the PHY and make sure it's what we expect
-		auto id1 = PhyRegisterRead(port, PHY_REG_ID1);
-		auto id2 = PhyRegisterRead(port, PHY_REG_ID2);
-		if( (id1 != 0x0022) || ( (id2 >> 4) != 0x162) )
-			m_stream->Printf("    Unexpected PHY identifier (ID1=%04x, ID2=%04x)\n", id1, id2);
+		//Make sure the PHY is what we expect
+		if( (id1[port] != 0x0022) || ( (id2[port] >> 4) != 0x162) )
+			m_stream->Printf("    Unexpected PHY identifier (ID1=%04x, ID2=%04x)\n", id1[port], id2[port]);
 		else
-			m_stream->Printf("    KSZ9031RNX rev %d\n", id2 & 0xf);
+			m_stream->Printf("    KSZ9031RNX rev %d\n", id2[port] & 0xf);
+
+		auto rate = PhyGetMdcRate(port);
+		m_stream->Printf("    MDIO: %d.%03d MHz, preamble %s\n",
+			rate / 1000000,
+			(rate / 1000) % 1000,
+			g_mdioConfig[port].preambleSuppress ? "suppressed" : "enabled");
 	}
 }
 
@@ -1310,99 +2747,38 @@ void TapCLISessionContext::OnSpeed()
 
 void TapCLISessionContext::OnTest()
 {
-	//Figure out what interface we're testing
-	int iface = 0;
+	//Figure out what interface(s) we're testing
+	uint8_t portmask = 0;
 	switch(m_command[1].m_commandID)
 	{
+		case CMD_ALL:
+			portmask = 0xf;
+			break;
+
 		case CMD_PORTA:
-			iface = 0;
+			portmask = 0x1;
 			break;
 
 		case CMD_PORTB:
-			iface = 1;
+			portmask = 0x2;
 			break;
 
 		case CMD_MONA:
-			iface = 2;
+			portmask = 0x4;
 			break;
 
 		case CMD_MONB:
-			iface = 3;
+			portmask = 0x8;
 			break;
 
 		default:
-			break;
-	}
-
-	m_stream->Printf("Running TDR cable test on interface %s\n", g_portDescriptions[iface]);
-
-	//Save the old values for a few registers and configure for testing
-	//Need to have speed forced to 1000baseT, no negotiation, slave mode, no auto mdix
-	//Reference: https://microchipsupport.force.com/s/article/How-to-test-the-4-differential-pairs-between-KSZ9031-Gigabit-Ethernet-PHY-and-RJ-45-connector-for-opens-and-shorts
-	auto oldBase = PhyRegisterRead(iface, PHY_REG_BASIC_CONTROL);
-	auto oldMdix = PhyRegisterRead(iface, PHY_REG_MDIX);
-	auto oldCtrl = PhyRegisterRead(iface, PHY_REG_GIG_CONTROL);
-	PhyRegisterWrite(iface, PHY_REG_BASIC_CONTROL, 0x0140);
-	PhyRegisterWrite(iface, PHY_REG_MDIX, 0x0040);
-	PhyRegisterWrite(iface, PHY_REG_GIG_CONTROL, 0x1000);
-
-	m_stream->Printf("Uncertainty: +/- 4ns or 0.85m\n");
-	m_stream->Printf("Local pair     Status      Length (ns)        Length (m)\n");
-	for(int pair = 0; pair < 4; pair ++)
-	{
-		//Run ten tests and average.
-		//Report fault if any of them are failures
-		int faulttype = 0;
-		int faultdist = 0;
-		int navg = 10;
-		for(int j=0; j<navg; j ++)
-		{
-			//Request a test of this pair
-			PhyRegisterWrite(iface, PHY_REG_LINKMD, 0x8000 | (pair << 12) );
-
-			//Poll until test completes. Time out if no reply after 50 ms
-			uint16_t result = 0;
-			for(int i=0; i<50; i++)
-			{
-				result = PhyRegisterRead(iface, PHY_REG_LINKMD);
-				g_logTimer->Sleep(10);
-
-				if( (result & 0x8000) == 0)
-					break;
-			}
-
-			int faultcode = (result >> 8) & 3;
-			int rawDistance = (result & 0xff) - 13;
-			if(rawDistance < 0)
-				rawDistance = 0;
-
-			faultdist += rawDistance;
-
-			if(faultcode != 0)
-				faulttype = faultcode;
-		}
-
-		if(faulttype == 0)
-			m_stream->Printf("%c              Normal              N/A               N/A\n", 'A' + pair);
-		else
-		{
-			int oneWayNs = (faultdist * 4 / navg);
-			int cableCm = 21 * oneWayNs;
-
-			m_stream->Printf("%c              %-5s               %3d            %3d.%02d\n",
-				'A' + pair,
-				(faulttype == 1) ? "Open" : "Short",
-				oneWayNs,
-				cableCm / 100,
-				cableCm % 100
-				);
-		}
+			return;
 	}
 
-	//Restore original mode register values
-	PhyRegisterWrite(iface, PHY_REG_BASIC_CONTROL, oldBase);
-	PhyRegisterWrite(iface, PHY_REG_MDIX, oldMdix);
-	PhyRegisterWrite(iface, PHY_REG_GIG_CONTROL, oldCtrl);
+	//The test takes a while, so run it in the background and keep the rest of the system responsive.
+	//Every port has its own MDIO bus, so they all run in parallel. The prompt is printed once it finishes.
+	m_cableTest.Start(m_stream, portmask);
+	StartBackgroundJob(&m_cableTest);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1487,6 +2863,114 @@ void TapCLISessionContext::OnNoTestPattern()
 	RestartNegotiation(m_activeInterface);
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// "monitor"
+
+void TapCLISessionContext::OnMonitorCommand()
+{
+	switch(m_command[1].m_commandID)
+	{
+		case CMD_AGGREGATE:
+			g_monitorConfig.aggregate = true;
+			break;
+
+		case CMD_TIMESTAMP:
+			g_monitorConfig.timestamp = true;
+			break;
+
+		case CMD_TAG:
+			if(m_command[2].m_commandID == CMD_TRAILER)
+				g_monitorConfig.tagMode = MON_TAG_TRAILER;
+			else
+			{
+				//VID 0 means "no VLAN" and 4095 is reserved
+				int vids[2] =
+				{
+					static_cast<int>(strtol(m_command[3].m_text, nullptr, 10)),
+					static_cast<int>(strtol(m_command[4].m_text, nullptr, 10))
+				};
+				for(int i=0; i<2; i++)
+				{
+					if( (vids[i] < 1) || (vids[i] > 4094) )
+					{
+						m_stream->Printf("Invalid VLAN ID (must be 1-4094)\n");
+						return;
+					}
+				}
+
+				g_monitorConfig.tagMode = MON_TAG_VLAN;
+				g_monitorConfig.vlanId[0] = vids[0];
+				g_monitorConfig.vlanId[1] = vids[1];
+			}
+			break;
+
+		case CMD_SNAPLEN:
+			{
+				int i = (m_command[2].m_commandID == CMD_MONB) ? 1 : 0;
+
+				//The FPGA won't cut below 60 bytes anyway, so the MAC never pads after the trailer
+				auto len = strtol(m_command[3].m_text, nullptr, 10);
+				if( (len < 0) || (len > 0xffff) || ( (len > 0) && (len < 60) ) )
+				{
+					m_stream->Printf("Invalid snap length (must be 0 or 60-65535)\n");
+					return;
+				}
+
+				bool header = false;
+				bool trailer = false;
+				for(int j=4; j<6; j++)
+				{
+					if(m_command[j].m_commandID == CMD_HEADER)
+						header = true;
+					else if(m_command[j].m_commandID == CMD_TRAILER)
+						trailer = true;
+				}
+
+				g_monitorConfig.snaplen[i] = len;
+				g_monitorConfig.snapHeader[i] = header;
+				g_monitorConfig.snapTrailer[i] = trailer;
+			}
+			break;
+
+		case CMD_SAMPLE:
+			{
+				int i = (m_command[2].m_commandID == CMD_MONB) ? 1 : 0;
+
+				auto rate = strtol(m_command[4].m_text, nullptr, 10);
+				if( (rate < 1) || (rate > SAMPLE_RATE_MAX) )
+				{
+					m_stream->Printf("Invalid sample rate (must be 1-%d)\n", SAMPLE_RATE_MAX);
+					return;
+				}
+
+				switch(m_command[3].m_commandID)
+				{
+					case CMD_COUNT:
+						g_monitorConfig.sampleMode[i] = SAMPLE_COUNT;
+						break;
+
+					case CMD_FLOW:
+						g_monitorConfig.sampleMode[i] = SAMPLE_FLOW;
+						break;
+
+					case CMD_RANDOM:
+						g_monitorConfig.sampleMode[i] = SAMPLE_RANDOM;
+						break;
+
+					default:
+						return;
+				}
+				g_monitorConfig.sampleRate[i] = rate;
+			}
+			break;
+
+		default:
+			return;
+	}
+
+	MonitorConfigApply();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // "mode"
 
@@ -36,6 +36,8 @@
 
 #include <embedded-cli/CLIOutputStream.h>
 #include <embedded-cli/CLISessionContext.h>
+#include "CableTestJob.h"
+#include "FilterRules.h"
 
 class TapCLISessionContext : public CLISessionContext
 {
@@ -57,22 +59,40 @@ protected:
 	virtual void OnExecute();
 
 	void OnAutonegotiation();
+	void OnClearCommand();
+	void OnClockCommand();
+	void OnFilterCommand();
+	void OnFilterMatch(FilterRule& rule);
 	void OnInterfaceCommand();
 	void OnModeCommand();
 	void OnMdiCommand();
+	void OnMonitorCommand();
 	void OnNoCommand();
 	void OnNoAutonegotiation();
+	void OnNoFilter();
+	void OnNoMonitor();
 	void OnNoSpeed();
 	void OnNoTestPattern();
+	void OnShowClock();
 	void OnShowCommand();
+	void OnShowDatapath();
+	void OnShowFilter();
+	void OnShowInterfaceCounters();
+	void OnShowInterfaceHistogram();
 	void OnShowInterfaceStatus();
+	void OnShowLogging();
 	void OnSetCommand();
 	void OnSetMmdRegister();
 	void OnSetRegister();
 	void OnShowDetail();
+	void OnShowMdio();
+	void OnShowMmdRange();
 	void OnShowMmdRegister();
+	void OnShowMonitor();
 	void OnShowRegister();
 	void OnShowSpeed();
+	void OnShowProfile();
+	void OnShowTasks();
 	void OnShowHardware();
 	void OnShowVersion();
 	void OnShowVolatility();
@@ -90,6 +110,8 @@ protected:
 	int m_activeInterface;
 
 	int m_testModeSavedRegisters[3];
+
+	CableTestJob m_cableTest;
 };
 
 #endif
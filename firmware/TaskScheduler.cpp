@@ -0,0 +1,157 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "ethernet-tap.h"
+#include "TaskScheduler.h"
+
+static Task* g_tasks = nullptr;
+static int g_taskCount = 0;
+
+SchedulerStats g_schedulerStats;
+
+///@brief Timestamp of the most recent wakeup from WFI
+static uint32_t g_wakeTime = 0;
+
+/**
+	@brief Sets up the task table. Periodic tasks all run once right away.
+ */
+void SchedulerInit(Task* tasks, int count)
+{
+	g_tasks = tasks;
+	g_taskCount = count;
+
+	uint32_t now = g_logTimer->GetCount();
+	for(int i=0; i<count; i++)
+	{
+		tasks[i].next = now;
+		tasks[i].pending = (tasks[i].period != 0);
+		tasks[i].runs = 0;
+		tasks[i].maxTime = 0;
+	}
+
+	SchedulerClearStats();
+	g_wakeTime = now;
+}
+
+/**
+	@brief Requests that a task run on the next pass through the scheduler.
+
+	Safe to call from interrupt context.
+ */
+void ITCM_CODE SchedulerWake(Task& task)
+{
+	task.pending = true;
+}
+
+/**
+	@brief Runs every task that is due or has been woken
+ */
+void ITCM_CODE SchedulerRun()
+{
+	for(int i=0; i<g_taskCount; i++)
+	{
+		auto& task = g_tasks[i];
+		uint32_t now = g_logTimer->GetCount();
+
+		//Periodic task whose deadline has passed? Schedule the next run relative to the old deadline so we don't
+		//drift, but don't try to catch up on runs we missed entirely
+		if(task.period && (static_cast<int32_t>(now - task.next) >= 0) )
+		{
+			task.pending = true;
+			task.next += task.period;
+			if(static_cast<int32_t>(now - task.next) >= 0)
+				task.next = now + task.period;
+		}
+
+		if(!task.pending)
+			continue;
+
+		//Clear the flag before running, so a wakeup from an ISR while the task is running isn't lost
+		task.pending = false;
+		task.run();
+
+		uint32_t dt = g_logTimer->GetCount() - now;
+		task.runs ++;
+		if(dt > task.maxTime)
+			task.maxTime = dt;
+	}
+}
+
+/**
+	@brief Puts the CPU to sleep until the next interrupt, unless there is work to do already.
+
+	SysTick fires every millisecond so periodic tasks still get to run on time.
+ */
+void ITCM_CODE SchedulerSleep()
+{
+	uint32_t start = g_logTimer->GetCount();
+	uint32_t busy = start - g_wakeTime;
+	g_schedulerStats.lastLoopTime = busy;
+	g_schedulerStats.busyTime += busy;
+	if(busy > g_schedulerStats.maxLoopTime)
+		g_schedulerStats.maxLoopTime = busy;
+
+	//Mask interrupts while checking so a wakeup between the check and the WFI isn't missed.
+	//WFI still returns on a pending interrupt with PRIMASK set, and the ISR runs as soon as we unmask.
+	MaskInterrupts();
+	bool idle = !g_cliUART->HasInput();
+	for(int i=0; i<g_taskCount; i++)
+	{
+		if(g_tasks[i].pending)
+			idle = false;
+	}
+	if(idle)
+		WaitForInterrupt();
+	UnmaskInterrupts();
+
+	g_wakeTime = g_logTimer->GetCount();
+	g_schedulerStats.idleTime += g_wakeTime - start;
+	g_schedulerStats.loops ++;
+}
+
+Task* SchedulerGetTasks(int& count)
+{
+	count = g_taskCount;
+	return g_tasks;
+}
+
+void SchedulerClearStats()
+{
+	g_schedulerStats.loops = 0;
+	g_schedulerStats.maxLoopTime = 0;
+	g_schedulerStats.lastLoopTime = 0;
+	g_schedulerStats.idleTime = 0;
+	g_schedulerStats.busyTime = 0;
+
+	for(int i=0; i<g_taskCount; i++)
+	{
+		g_tasks[i].runs = 0;
+		g_tasks[i].maxTime = 0;
+	}
+}
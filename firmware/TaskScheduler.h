@@ -0,0 +1,82 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of the cooperative task scheduler
+ */
+#ifndef TaskScheduler_h
+#define TaskScheduler_h
+
+/**
+	@brief A unit of work run from the main loop
+
+	A task is run when its period (in g_logTimer ticks) has elapsed, or as soon as possible after SchedulerWake() is
+	called on it. Event driven tasks have a period of zero and only run when woken.
+
+	Tasks must not block: each call should do a small amount of work and return.
+ */
+struct Task
+{
+	const char*		name;
+	void			(*run)();
+	uint32_t		period;
+
+	//Internal state, initialized by SchedulerInit()
+	uint32_t		next;
+	volatile bool	pending;
+
+	//Statistics (in g_logTimer ticks)
+	uint32_t		runs;
+	uint32_t		maxTime;
+};
+
+void SchedulerInit(Task* tasks, int count);
+void SchedulerWake(Task& task);
+void SchedulerRun();
+void SchedulerSleep();
+
+/**
+	@brief Scheduler-wide statistics
+ */
+struct SchedulerStats
+{
+	uint32_t		loops;			//number of times the CPU woke up
+	uint32_t		maxLoopTime;	//longest time between waking up and going back to sleep
+	uint32_t		lastLoopTime;
+	uint32_t		idleTime;		//total time spent asleep
+	uint32_t		busyTime;		//total time spent awake
+};
+
+extern SchedulerStats g_schedulerStats;
+
+Task* SchedulerGetTasks(int& count);
+void SchedulerClearStats();
+
+#endif
@@ -47,12 +47,23 @@
 #include <util/FIFO.h>
 #include <cli/UARTOutputStream.h>
 
+#include "TCM.h"
 #include "TapCLISessionContext.h"
+#include "TaskScheduler.h"
+#include "SPSCQueue.h"
+#include "BufferedUART.h"
+#include "Profiler.h"
+#include "ProfiledOctoSPI.h"
+#include "RingLogger.h"
+#include "RmonCounters.h"
+#include "PathStats.h"
+#include "MonitorConfig.h"
+#include "FilterRules.h"
 
-extern UART* g_cliUART;
-extern Logger g_log;
+extern BufferedUART* g_cliUART;
+extern RingLogger g_log;
 extern UARTOutputStream g_uartStream;
-extern OctoSPI* g_qspi;
+extern ProfiledOctoSPI* g_qspi;
 
 extern TapCLISessionContext g_uartCliContext;
 
@@ -63,6 +74,62 @@ extern uint16_t g_linkState;
 
 extern Timer* g_logTimer;
 
+/**
+	@brief A complete clock tree configuration, and the peripheral settings derived from it
+ */
+struct ClockProfile
+{
+	const char*	name;
+
+	bool		usePLL;			//false to run directly from the 64 MHz HSI
+	uint8_t		pllPrediv;		//PLL1 settings, ignored if not using the PLL
+	uint16_t	pllMult;
+	uint8_t		pllDivP;
+
+	uint32_t	sysclkHz;
+	uint8_t		ahbDiv;
+	uint8_t		apbDiv;			//same for all four APB buses
+
+	uint32_t	qspiMaxHz;
+
+	uint32_t GetAHBClock() const
+	{ return sysclkHz / ahbDiv; }
+
+	uint32_t GetAPBClock() const
+	{ return GetAHBClock() / apbDiv; }
+
+	///@brief Timer kernel clock is twice PCLK if the APB prescaler is used
+	uint32_t GetTimerClock() const
+	{ return (apbDiv == 1) ? GetAPBClock() : GetAPBClock() * 2; }
+
+	uint32_t GetUARTDivisor(uint32_t baud) const
+	{ return (GetAPBClock() + baud/2) / baud; }
+
+	///@brief QSPI kernel clock is HCLK3, round the divider up to stay under the limit
+	uint8_t GetQSPIPrescale() const
+	{ return (GetAHBClock() + qspiMaxHz - 1) / qspiMaxHz; }
+
+	uint32_t GetQSPIClock() const
+	{ return GetAHBClock() / GetQSPIPrescale(); }
+};
+
+enum clockprofile_t
+{
+	CLOCK_PROFILE_LOWPOWER,
+	CLOCK_PROFILE_PERFORMANCE,
+
+	CLOCK_PROFILE_COUNT
+};
+
+//Profile to use at boot if no button is held (see SelectClockProfile()), can be overridden from the Makefile
+#ifndef CLOCK_PROFILE
+#define CLOCK_PROFILE CLOCK_PROFILE_PERFORMANCE
+#endif
+
+extern const ClockProfile g_clockProfiles[CLOCK_PROFILE_COUNT];
+extern const ClockProfile* g_clockProfile;
+extern bool g_clockProfileFromButton;
+
 //Register IDs for the FPGA
 enum regids
 {
@@ -74,30 +141,59 @@ enum regids
 	REG_FPGA_SERIAL		= 0x0001,
 	REG_LINK_STATE		= 0x0002,
 	REG_TRIG_MUX		= 0x0003,
+	REG_MDIO_BATCH		= 0x0004,
+	REG_MDIO_BATCH_STAT	= 0x0005,
+	REG_MDIO_BATCH_RD	= 0x0006,
+	REG_MDIO_RD_ALL		= 0x0007,
+	REG_MDIO_WR_ALL		= 0x0008,
+	REG_MDIO_RDATA_ALL	= 0x0009,
+	REG_MDIO_STATUS		= 0x000a,
+	REG_IRQ_STATUS		= 0x000b,
+	REG_IRQ_ENABLE		= 0x000c,
+	REG_MDIO_SHADOW		= 0x000d,
+	REG_MDIO_SHADOW_CHANGED	= 0x000e,
+	REG_MDIO_POLL_CFG	= 0x000f,
+	REG_STATS_SNAPSHOT	= 0x0010,
+	REG_STATS_CLEAR		= 0x0011,
+	REG_RMON_COUNTERS	= 0x0012,
+	REG_PATH_STATS		= 0x0013,
+	REG_MONITOR_CFG		= 0x0014,
+	REG_MONITOR_SNAPLEN	= 0x0015,
+	REG_TIMESTAMP_SET	= 0x0016,
+	REG_TIMESTAMP		= 0x0017,
+	REG_FILTER_RULE		= 0x0018,
+	REG_FILTER_HITS		= 0x0019,
+	REG_MONITOR_SAMPLE	= 0x001a,
+	REG_SAMPLE_STATS	= 0x001b,
+	REG_RMON_HISTOGRAM	= 0x001c,
 
 	//Port 0 (device A)
 	REG_ETH0_RST		= 0x1000,
 	REG_ETH0_MDIO_RADDR	= 0x1001,
 	REG_ETH0_MDIO_RDATA	= 0x1002,
 	REG_ETH0_MDIO_WR	= 0x1003,
+	REG_ETH0_MDIO_CFG	= 0x1004,
 
 	//Port 1 (device B)
 	REG_ETH1_RST		= 0x2000,
 	REG_ETH1_MDIO_RADDR	= 0x2001,
 	REG_ETH1_MDIO_RDATA	= 0x2002,
 	REG_ETH1_MDIO_WR	= 0x2003,
+	REG_ETH1_MDIO_CFG	= 0x2004,
 
 	//Port 2 (mon A)
 	REG_ETH2_RST		= 0x3000,
 	REG_ETH2_MDIO_RADDR	= 0x3001,
 	REG_ETH2_MDIO_RDATA	= 0x3002,
 	REG_ETH2_MDIO_WR	= 0x3003,
+	REG_ETH2_MDIO_CFG	= 0x3004,
 
 	//Port 3 (mon B)
 	REG_ETH3_RST		= 0x4000,
 	REG_ETH3_MDIO_RADDR	= 0x4001,
 	REG_ETH3_MDIO_RDATA	= 0x4002,
-	REG_ETH3_MDIO_WR	= 0x4003
+	REG_ETH3_MDIO_WR	= 0x4003,
+	REG_ETH3_MDIO_CFG	= 0x4004
 };
 
 enum phyregs
@@ -130,14 +226,145 @@ enum phyregs
 	//indirect mmd1
 };
 
+/**
+	@brief A single operation within a batch of PHY register accesses
+ */
+struct PhyTransaction
+{
+	uint8_t		port;
+	bool		write;
+	uint8_t		regid;
+	uint16_t	value;		//data to write, or data read back once the batch completes
+};
+
+//Number of commands the FPGA can queue at once (larger batches are split)
+#define PHY_BATCH_MAX 32
+
+//Number of read results the FPGA can store for one batch
+#define PHY_BATCH_RESULTS_MAX 256
+
+//Longest MMD read burst in a single command
+#define PHY_MMD_BURST_MAX 255
+
+//Opcodes in byte 0 of a REG_MDIO_BATCH command
+#define PHY_QUEUE_OP_READ		0x00
+#define PHY_QUEUE_OP_WRITE		0x40
+#define PHY_QUEUE_OP_MMD_SETUP	0x80
+#define PHY_QUEUE_OP_MMD_READ	0xc0
+
+//MMD access modes (MMD_CTRL bits 15:14)
+#define PHY_MMD_MODE_DATA			1
+#define PHY_MMD_MODE_DATA_INC_RW	2
+#define PHY_MMD_MODE_DATA_INC_W		3
+
+//Bits in REG_IRQ_STATUS / REG_IRQ_ENABLE
+#define IRQ_LINK_STATE	0x01
+#define IRQ_MDIO_DONE	0x02
+#define IRQ_PHY_SHADOW	0x04
+
+//Number of registers the FPGA can poll in the background on each PHY
+#define PHY_POLL_MAX 8
+
+//Slots in the shadow RAM, as configured by InitPHYs()
+enum phypollslot_t
+{
+	PHY_POLL_AN_ADVERT,
+	PHY_POLL_GIG_CONTROL,
+	PHY_POLL_CTRL,
+	PHY_POLL_BASIC_CONTROL,
+
+	PHY_POLL_COUNT
+};
+
+extern uint32_t g_mdioTimeouts[4];
+extern uint32_t g_mdioBatchTimeouts;
+
+uint8_t PhyPollStatus();
+bool PhyWaitDone(uint8_t portmask);
+
+//Number of asynchronous requests that can be queued per port
+#define PHY_ASYNC_DEPTH 8
+
+//ok is false if the transaction timed out (a read then returns 0xffff)
+typedef void (*PhyCallback)(void* param, bool ok, uint16_t value);
+
+bool PhyAsyncRead(int port, uint8_t regid, PhyCallback callback, void* param);
+bool PhyAsyncWrite(int port, uint8_t regid, uint16_t value, PhyCallback callback, void* param);
+bool PhyAsyncIdle(int port);
+void PhyAsyncPoll();
+
+/**
+	@brief MDC rate and preamble setting for one MDIO bus
+ */
+struct MdioBusConfig
+{
+	uint8_t		clkdiv;				//MDC half period in 8ns FPGA clock cycles, minus one
+	bool		preambleSuppress;	//send one idle bit instead of a 32-bit preamble
+};
+
+//FPGA default: 125 MHz / 62 = ~2 MHz with full preamble
+#define MDIO_CLKDIV_DEFAULT 30
+
+//Fastest MDC allowed by IEEE 802.3 clause 22 and the KSZ9031 datasheet: 125 MHz / 50 = 2.5 MHz
+#define MDIO_CLKDIV_MIN 24
+
+extern MdioBusConfig g_mdioConfig[4];
+
+void PhySetBusConfig(int port, const MdioBusConfig& config);
+uint32_t PhyGetMdcRate(int port);
+
+extern uint32_t g_phyCacheHits[4];
+extern uint32_t g_phyCacheMisses[4];
+
+void PhyCacheInvalidate(int port);
+void PhyCacheInvalidateVolatile(int port);
+
+bool PhyRegisterRead(int port, uint8_t regid, uint16_t& value);
 uint16_t PhyRegisterRead(int port, uint8_t regid);
 void PhyRegisterWrite(int port, uint8_t regid, uint16_t regval);
+bool PhyBatchExecute(PhyTransaction* txns, int count);
+
+void PhyRegisterReadAll(uint8_t regid, uint16_t regvals[4]);
+void PhyRegisterWriteAll(uint8_t regid, uint16_t regval);
+
+void PhyPollerConfigure(uint8_t portmask, const uint8_t* regids, int count);
+uint8_t PhyShadowChanged();
+void PhyShadowRead(uint16_t regvals[4][PHY_POLL_MAX]);
 
-uint16_t PhyRegisterIndirectRead(int port, uint8_t mmd, uint16_t regid);
-void PhyRegisterIndirectWrite(int port, uint8_t mmd, uint16_t regid, uint16_t regval);
+bool PhyRegisterIndirectRead(int port, uint8_t mmd, uint16_t regid, uint16_t& value);
+bool PhyRegisterIndirectReadRange(int port, uint8_t mmd, uint16_t start, int count, uint16_t* values);
+bool PhyRegisterIndirectWrite(int port, uint8_t mmd, uint16_t regid, uint16_t regval);
 
 void RestartNegotiation(int nport);
 
 void PollIO();
 
+//Tasks run by the main loop
+enum taskid_t
+{
+	TASK_FPGA_IRQ,
+	TASK_LEDS,
+	TASK_BUTTONS,
+	TASK_BACKGROUND,
+	TASK_LOG,
+
+	TASK_COUNT
+};
+
+extern Task g_taskTable[TASK_COUNT];
+
+/**
+	@brief A rising edge on the FPGA IRQ line
+ */
+struct FPGAEvent
+{
+	uint32_t	timestamp;		//g_logTimer count when the edge was seen
+};
+
+#define FPGA_EVENT_DEPTH 16
+
+extern SPSCQueue<FPGAEvent, FPGA_EVENT_DEPTH> g_fpgaEvents;
+extern uint32_t g_fpgaIrqLatencyLast;
+extern uint32_t g_fpgaIrqLatencyMax;
+
 #endif
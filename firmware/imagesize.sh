@@ -3,8 +3,8 @@
 LINE=`ls -lh firmware.bin | cut -d ' ' -f 5`
 echo "Flash memory usage: $LINE";
 
-STACKSTART=$(arm-none-eabi-objdump -t firmware.elf  | grep __stack | cut -d ' ' -f 1);
-STACKEND=$(arm-none-eabi-objdump -t firmware.elf  | grep __end | cut -d ' ' -f 1);
+STACKSTART=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __dtcm_stack | cut -d ' ' -f 1);
+STACKEND=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __dtcm_stack_end | cut -d ' ' -f 1);
 DSTACKSTART=$(echo "obase=10;ibase=16;${STACKSTART^^}" | bc);
 DSTACKEND=$(echo "obase=10;ibase=16;${STACKEND^^}" | bc);
 STACKSIZE=$(expr $DSTACKSTART - $DSTACKEND);
@@ -38,3 +38,27 @@ DHEAPEND=$(echo "obase=10;ibase=16;${HEAPEND^^}" | bc);
 HEAPSIZE=$(expr $DHEAPEND - $DHEAPSTART);
 HEAPKB=$(expr $HEAPSIZE / 1024);
 echo "Unused:             $HEAPSIZE bytes";
+
+ITCMSTART=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __itcm_start | cut -d ' ' -f 1);
+ITCMEND=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __itcm_end | cut -d ' ' -f 1);
+DITCMSTART=$(echo "obase=10;ibase=16;${ITCMSTART^^}" | bc);
+DITCMEND=$(echo "obase=10;ibase=16;${ITCMEND^^}" | bc);
+ITCMSIZE=$(expr $DITCMEND - $DITCMSTART);
+echo "ITCM code:          $ITCMSIZE of 65536 bytes";
+
+DTCMSTART=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __dtcm_start | cut -d ' ' -f 1);
+DTCMDATAEND=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __dtcm_data_end | cut -d ' ' -f 1);
+DTCMBSSSTART=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __dtcm_bss_start | cut -d ' ' -f 1);
+DTCMBSSEND=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __dtcm_bss_end | cut -d ' ' -f 1);
+DTCMEND=$(arm-none-eabi-objdump -t firmware.elf  | grep -w __dtcm_end | cut -d ' ' -f 1);
+DDTCMSTART=$(echo "obase=10;ibase=16;${DTCMSTART^^}" | bc);
+DDTCMDATAEND=$(echo "obase=10;ibase=16;${DTCMDATAEND^^}" | bc);
+DDTCMBSSSTART=$(echo "obase=10;ibase=16;${DTCMBSSSTART^^}" | bc);
+DDTCMBSSEND=$(echo "obase=10;ibase=16;${DTCMBSSEND^^}" | bc);
+DDTCMEND=$(echo "obase=10;ibase=16;${DTCMEND^^}" | bc);
+DTCMDATASIZE=$(expr $DDTCMDATAEND - $DDTCMSTART);
+DTCMBSSSIZE=$(expr $DDTCMBSSEND - $DDTCMBSSSTART);
+DTCMSIZE=$(expr $DDTCMEND - $DDTCMSTART);
+echo "DTCM data:          $DTCMDATASIZE bytes";
+echo "DTCM BSS:           $DTCMBSSSIZE bytes";
+echo "DTCM total:         $DTCMSIZE of 131072 bytes (including stack)";
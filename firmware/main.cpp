@@ -30,17 +30,25 @@
 #include "ethernet-tap.h"
 
 //UART console
-UART* g_cliUART = nullptr;
-Logger g_log;
+BufferedUART* g_cliUART = nullptr;
+RingLogger g_log;
 UARTOutputStream g_uartStream;
 TapCLISessionContext g_uartCliContext;
 Timer* g_logTimer = nullptr;
 
 GPIOPin* g_irq = nullptr;
 
+//Edges on the FPGA IRQ line, pushed by the EXTI ISR
+DTCM_BSS SPSCQueue<FPGAEvent, FPGA_EVENT_DEPTH> g_fpgaEvents;
+
+//Time from the FPGA IRQ edge to finishing the link state update, in 100us ticks
+uint32_t g_fpgaIrqLatencyLast = 0;
+uint32_t g_fpgaIrqLatencyMax = 0;
+
 //QSPI interface to FPGA
-OctoSPI* g_qspi;
+ProfiledOctoSPI* g_qspi;
 
+void SelectClockProfile();
 void InitClocks();
 void InitUART();
 void InitLog();
@@ -48,13 +56,31 @@ void DetectHardware();
 void InitQSPI();
 void InitFPGA();
 void InitPHYs();
+void PhyAsyncFinish(uint8_t portmask);
+void ProbeMdioSpeed();
 void InitCLI();
+void InitSysTick();
+void InitFPGAInterrupt();
 
 void UpdateSpeedLEDs();
 void CheckButtons();
 
 void OnFPGAInterrupt();
 
+void RunBackgroundWork();
+void DrainLog();
+
+//Everything the main loop does other than the CLI
+DTCM_DATA Task g_taskTable[TASK_COUNT] =
+{
+	//name			function				period (ticks)
+	{"fpga-irq",	OnFPGAInterrupt,		0,		0, false, 0, 0},	//woken by EXTI12
+	{"leds",		UpdateSpeedLEDs,		500,	0, false, 0, 0},	//20 Hz
+	{"buttons",		CheckButtons,			100,	0, false, 0, 0},	//100 Hz
+	{"background",	RunBackgroundWork,		10,		0, false, 0, 0},	//1 kHz, plus whenever woken
+	{"log",			DrainLog,				10,		0, false, 0, 0}		//1 kHz, plus whenever a message is logged
+};
+
 uint16_t g_linkState = 0;
 
 const char* g_portDescriptions[4] =
@@ -84,16 +110,16 @@ const int g_linkSpeeds[4] =
 int main()
 {
 	//Initialize power (must be the very first thing done after reset)
+	//.data, .bss and the TCMs were already set up by Reset_Handler()
 	Power::ConfigureSMPSToLDOCascade(Power::VOLTAGE_1V8, RANGE_VOS0);
 
-	//Copy .data from flash to SRAM (for some reason the default newlib startup won't do this??)
-	memcpy(&__data_start, &__data_romstart, &__data_end - &__data_start + 1);
-
 	//Enable SYSCFG before changing any settings on it
 	RCCHelper::EnableSyscfg();
 
 	//Hardware setup
+	SelectClockProfile();
 	InitClocks();
+	InitProfiler();
 	InitUART();
 	InitLog();
 	DetectHardware();
@@ -113,9 +139,9 @@ int main()
 	led3 = 0;
 
 	//Set up the QSPI IRQ GPIO pin
-	//(not actually used as an interrupt for now, just polling)
 	GPIOPin irq(&GPIOE, 12, GPIOPin::MODE_INPUT, GPIOPin::SLEW_SLOW);
 	g_irq = &irq;
+	InitFPGAInterrupt();
 
 	//Enable interrupts only after all setup work is done
 	EnableInterrupts();
@@ -123,15 +149,36 @@ int main()
 	//Show the initial prompt
 	g_uartCliContext.PrintPrompt();
 
+	//Start the scheduler tick last, so the first wakeup doesn't happen mid-init
+	SchedulerInit(g_taskTable, TASK_COUNT);
+	InitSysTick();
+
+	//From here on, log messages are queued and printed by the log task
+	g_log.SetDeferred(true);
+
+	//The IRQ line might have gone high before the EXTI was set up, so check it once by hand
+	SchedulerWake(g_taskTable[TASK_FPGA_IRQ]);
+
 	//Main event loop
 	while(1)
 	{
-		//Wait for an interrupt
-		//asm("wfi");
+		//Sleep until an interrupt (UART input or the 1 kHz tick) unless there's already work to do
+		SchedulerSleep();
 
 		//Poll for UART input
 		if(g_cliUART->HasInput())
-			g_uartCliContext.OnKeystroke(g_cliUART->BlockingRead());
+		{
+			char c = g_cliUART->BlockingRead();
+
+			//While a background job owns the console, the only key we care about is ^C to cancel it
+			if(IsBackgroundJobRunning())
+			{
+				if(c == 0x03)
+					AbortBackgroundJob();
+			}
+			else
+				g_uartCliContext.OnKeystroke(c);
+		}
 
 		PollIO();
 	}
@@ -142,39 +189,148 @@ int main()
 /**
 	Process I/O other than the UART
  */
-void PollIO()
+void ITCM_CODE PollIO()
 {
-	//Poll for interrupts from the FPGA
-	if(*g_irq)
-		OnFPGAInterrupt();
+	ProfileScope ps(PROBE_POLL_IO);
+	SchedulerRun();
+}
+
+/**
+	@brief Makes progress on outstanding asynchronous PHY accesses and long-running commands
+ */
+void ITCM_CODE RunBackgroundWork()
+{
+	ProfileScope ps(PROBE_BACKGROUND);
+	PhyAsyncPoll();
+	if(RunBackgroundJob())
+		g_uartCliContext.PrintPrompt();
+
+	//MDIO transactions only take tens of microseconds, so keep going rather than waiting for the next tick
+	for(int i=0; i<4; i++)
+	{
+		if(!PhyAsyncIdle(i))
+		{
+			SchedulerWake(g_taskTable[TASK_BACKGROUND]);
+			break;
+		}
+	}
+}
+
+/**
+	@brief Prints queued log messages, as long as there's room in the console buffer for CLI output too
+ */
+void DrainLog()
+{
+	ProfileScope ps(PROBE_LOG);
+
+	g_log.FlushSuppressed();
+
+	//If the buffer is backed up, try again next tick
+	if(g_cliUART->GetBufferedBytes() > (UART_TX_BUFFER_SIZE / 2))
+		return;
 
-	//Run LEDs and buttons
-	UpdateSpeedLEDs();
-	CheckButtons();
+	if(g_log.Drain(4))
+		SchedulerWake(g_taskTable[TASK_LOG]);
+}
+
+/**
+	@brief The clock profiles we know how to set up. Which one is used is chosen at boot by SelectClockProfile().
+
+	The QSPI limit comes from the FPGA side: QSPIDeviceInterface oversamples SCK with its 125 MHz clock, so it can't
+	take more than about 32 MHz no matter how fast the MCU can drive it.
+ */
+const ClockProfile g_clockProfiles[CLOCK_PROFILE_COUNT] =
+{
+	//Everything on the 64 MHz HSI, no PLL. Plenty for a simple CLI
+	{ "lowpower",		false,	0,	0,		0,	64000000,	1,	1,	32000000 },
+
+	//HSI / 16 = 4 MHz at the PFD, * 125 = 500 MHz at the VCO, / 1 = 500 MHz sysclk.
+	//AHB at 250 MHz, APB at 62.5 MHz (the max for both is 275 / 137.5 MHz)
+	{ "performance",	true,	16,	125,	1,	500000000,	2,	4,	32000000 }
+};
+
+const ClockProfile* g_clockProfile = &g_clockProfiles[CLOCK_PROFILE];
+
+///@brief True if g_clockProfile was picked with a front panel button rather than being the default
+bool g_clockProfileFromButton = false;
+
+/**
+	@brief Picks the clock profile to boot with. Must run before InitClocks(), and before anything that reads
+	g_clockProfile.
+
+	Holding down one of the left port's buttons at power up picks a profile by position: autonegotiation for
+	g_clockProfiles[0] (lowpower), 10M for [1] (performance), and so on. With no button held, CLOCK_PROFILE is used.
+
+	We're still on the reset clock with no timer running, so the buttons are debounced by requiring them to read the
+	same a few thousand times in a row.
+ */
+void SelectClockProfile()
+{
+	GPIOPin left_aneg_sw(&GPIOF, 14, GPIOPin::MODE_INPUT, GPIOPin::SLEW_SLOW);
+	GPIOPin left_10m_sw(&GPIOH, 2, GPIOPin::MODE_INPUT, GPIOPin::SLEW_SLOW);
+	GPIOPin left_100m_sw(&GPIOC, 5, GPIOPin::MODE_INPUT, GPIOPin::SLEW_SLOW);
+	GPIOPin left_1000m_sw(&GPIOE, 3, GPIOPin::MODE_INPUT, GPIOPin::SLEW_SLOW);
+
+	uint8_t held = 0xf;
+	for(int i=0; i<5000; i++)
+	{
+		uint8_t sample =
+			(left_aneg_sw << 0) | (left_10m_sw << 1) | (left_100m_sw << 2) | (left_1000m_sw << 3);
+		held &= sample;
+	}
+
+	g_clockProfile = &g_clockProfiles[CLOCK_PROFILE];
+	g_clockProfileFromButton = false;
+	for(int i=0; (i < CLOCK_PROFILE_COUNT) && (i < 4); i++)
+	{
+		if(held & (1 << i))
+		{
+			g_clockProfile = &g_clockProfiles[i];
+			g_clockProfileFromButton = true;
+			break;
+		}
+	}
 }
 
 void InitClocks()
 {
+	auto& profile = *g_clockProfile;
+
 	//Configure the flash with wait states and prefetching before making any changes to the clock setup.
 	//A bit of extra latency is fine, the CPU being faster than flash is not.
-	Flash::SetConfiguration(64, RANGE_VOS0);
+	Flash::SetConfiguration(profile.GetAHBClock() / 1000000, RANGE_VOS0);
 
 	//Start the high speed internal clock
 	RCCHelper::EnableHighSpeedInternalClock(64);
 
-	//Don't use the PLL, it's overkill for a simple CLI.
-	//HSI is already selected as default out of reset, so no need to change clock source. Just poke dividers.
+	//Set up PLL1 if needed. Only the P output is used, Q and R are just set to something legal
+	if(profile.usePLL)
+	{
+		RCCHelper::InitializePLL(
+			1,						//PLL1
+			64,						//input is 64 MHz from the HSI
+			profile.pllPrediv,
+			profile.pllMult,
+			profile.pllDivP,
+			10,						//div Q (not used)
+			10,						//div R (not used)
+			RCCHelper::CLOCK_SOURCE_HSI
+		);
+	}
 
-	//Set up main system clock tree
-	//Super simple, everything runs on the same 64 MHz clock!
+	//Set up main system clock tree. All of the APB buses run at the same speed
 	RCCHelper::InitializeSystemClocks(
-		1,		//sysclk = 64 MHz
-		1,		//AHB
-		1,		//APB1
-		1,		//APB2
-		1,		//APB3
-		1		//APB4
+		1,						//sysclk
+		profile.ahbDiv,			//AHB
+		profile.apbDiv,			//APB1
+		profile.apbDiv,			//APB2
+		profile.apbDiv,			//APB3
+		profile.apbDiv			//APB4
 	);
+
+	//HSI is already selected as default out of reset, so only switch if we're using the PLL
+	if(profile.usePLL)
+		RCCHelper::SelectSystemClockFromPLL1();
 }
 
 void InitUART()
@@ -184,12 +340,11 @@ void InitUART()
 	GPIOPin uart_tx(&GPIOA, 12, GPIOPin::MODE_PERIPHERAL, GPIOPin::SLEW_SLOW, 6);
 	GPIOPin uart_rx(&GPIOA, 11, GPIOPin::MODE_PERIPHERAL, GPIOPin::SLEW_SLOW, 6);
 
-	//Default after reset is for UART4 to be clocked by PCLK1 (APB1 clock) which is 64 MHz
-	//So we need a divisor of 556
-	static UART uart(&UART4, 556);
+	//Default after reset is for UART4 to be clocked by PCLK1 (APB1 clock)
+	DTCM_BSS static BufferedUART uart(&UART4, g_clockProfile->GetUARTDivisor(115200));
 	g_cliUART = &uart;
 
-	//Enable the UART RX interrupt
+	//Enable the UART interrupt (RX data, plus TX empty while BufferedUART has output queued)
 	//TODO: Make an RCC method for this
 	volatile uint32_t* NVIC_ISER1 = (volatile uint32_t*)(0xe000e104);
 	*NVIC_ISER1 = 0x100000;
@@ -198,22 +353,62 @@ void InitUART()
 	uart.Printf("\x1b[2J\x1b[0;0H");
 }
 
+/**
+	@brief Starts SysTick at 1 kHz to wake the scheduler for periodic tasks
+ */
+void InitSysTick()
+{
+	//SysTick is clocked by the CPU clock
+	volatile uint32_t* SYST_CSR = (volatile uint32_t*)(0xe000e010);
+	volatile uint32_t* SYST_RVR = (volatile uint32_t*)(0xe000e014);
+	volatile uint32_t* SYST_CVR = (volatile uint32_t*)(0xe000e018);
+	*SYST_RVR = (g_clockProfile->sysclkHz / 1000) - 1;
+	*SYST_CVR = 0;
+	*SYST_CSR = 0x7;	//processor clock, interrupt enabled, counter enabled
+}
+
+/**
+	@brief Routes PE12 (FPGA IRQ) to EXTI12 and enables the EXTI15_10 interrupt on its rising edge
+ */
+void InitFPGAInterrupt()
+{
+	//EXTICR4 bits 3:0 select the port for line 12, port E is 4
+	SYSCFG.EXTICR[3] = (SYSCFG.EXTICR[3] & ~0xf) | 0x4;
+
+	//TODO: Make an EXTI driver for this
+	volatile uint32_t* EXTI_RTSR1 = (volatile uint32_t*)(0x58000000);
+	volatile uint32_t* EXTI_C1IMR1 = (volatile uint32_t*)(0x58000080);
+	volatile uint32_t* EXTI_C1PR1 = (volatile uint32_t*)(0x58000088);
+	*EXTI_RTSR1 |= (1 << 12);
+	*EXTI_C1PR1 = (1 << 12);
+	*EXTI_C1IMR1 |= (1 << 12);
+
+	//EXTI15_10 is irq40
+	volatile uint32_t* NVIC_ISER1 = (volatile uint32_t*)(0xe000e104);
+	*NVIC_ISER1 = 0x100;
+}
+
 void InitLog()
 {
-	//APB1 is 64 MHz
-	//Divide down to get 10 kHz ticks
-	static Timer logtim(&TIM2, Timer::FEATURE_GENERAL_PURPOSE, 6400);
+	//Divide down the APB1 timer clock to get 10 kHz ticks
+	static Timer logtim(&TIM2, Timer::FEATURE_GENERAL_PURPOSE, g_clockProfile->GetTimerClock() / 10000);
 	g_logTimer = &logtim;
 
 	g_log.Initialize(g_cliUART, &logtim);
 	g_log("UART logging ready\n");
 	g_log("Firmware compiled at %s on %s\n", __TIME__, __DATE__);
+	g_log("Clock profile \"%s\"%s: sysclk %d MHz, AHB %d MHz, APB %d MHz\n",
+		g_clockProfile->name,
+		g_clockProfileFromButton ? " (selected by button)" : "",
+		g_clockProfile->sysclkHz / 1000000,
+		g_clockProfile->GetAHBClock() / 1000000,
+		g_clockProfile->GetAPBClock() / 1000000);
 }
 
 void DetectHardware()
 {
 	g_log("Identifying hardware\n");
-	LogIndenter li(g_log);
+	RingLogIndenter li(g_log);
 
 	uint16_t rev = DBGMCU.IDCODE >> 16;
 	uint16_t device = DBGMCU.IDCODE & 0xfff;
@@ -347,13 +542,13 @@ void InitQSPI()
 	static GPIOPin qspi_dq3(&GPIOA, 1, GPIOPin::MODE_PERIPHERAL, GPIOPin::SLEW_VERYFAST, 9);
 
 	//Clock divider value
-	//Default is for AHB3 bus clock to be used as kernel clock (64 MHz for us)
-	//With 3.3V Vdd, we can go up to 140 MHz.
-	//Dividing by 2 gives 32 MHz and a transfer rate of 128 Mbps. Plenty for PHy configuration
-	uint8_t prescale = 2;
+	//Default is for AHB3 bus clock to be used as kernel clock.
+	//With 3.3V Vdd, we can go up to 140 MHz, but the FPGA limits us to much less (see g_clockProfiles)
+	uint8_t prescale = g_clockProfile->GetQSPIPrescale();
+	g_log("QSPI clock: %d kHz\n", g_clockProfile->GetQSPIClock() / 1000);
 
 	//Configure the OCTOSPI itself
-	static OctoSPI qspi(&OCTOSPI1, 0x02000000, prescale);
+	static ProfiledOctoSPI qspi(&OCTOSPI1, 0x02000000, prescale);
 	qspi.SetDoubleRateMode(false);
 	qspi.SetInstructionMode(OctoSPI::MODE_QUAD, 2);
 	qspi.SetAddressMode(OctoSPI::MODE_NONE);
@@ -370,7 +565,7 @@ void InitQSPI()
 void InitFPGA()
 {
 	g_log("Initializing FPGA\n");
-	LogIndenter li(g_log);
+	RingLogIndenter li(g_log);
 
 	//Wait 500ms to make sure the FPGA is booted
 	g_log("Waiting for boot\n");
@@ -396,64 +591,401 @@ void InitFPGA()
 	g_log("Serial: %02x%02x%02x%02x%02x%02x%02x%02x\n", buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7]);
 }
 
+/**
+	@brief Finds the fastest MDC rate and preamble setting that each PHY reads back correctly at
+
+	Candidates are tried fastest first. A setting is accepted for a port if several back to back reads of the PHY
+	identifier registers all come back with the expected values.
+
+	MDC never goes above the 2.5 MHz spec limit: a handful of ID register reads can't prove timing margin, so
+	overclocking would risk silently corrupting other registers. Most of the gain comes from preamble suppression,
+	which halves the length of each transaction.
+ */
+void ProbeMdioSpeed()
+{
+	g_log("Probing MDIO bus speed\n");
+	RingLogIndenter li(g_log);
+
+	static const MdioBusConfig candidates[] =
+	{
+		{ MDIO_CLKDIV_MIN,		true },		//2.5 MHz
+		{ MDIO_CLKDIV_MIN,		false },
+		{ MDIO_CLKDIV_DEFAULT,	true },		//2 MHz
+		{ MDIO_CLKDIV_DEFAULT,	false }
+	};
+	const int ncandidates = sizeof(candidates) / sizeof(candidates[0]);
+
+	uint8_t found = 0;
+	for(int i=0; (i < ncandidates) && (found != 0xf); i++)
+	{
+		//Try this setting on every port that hasn't settled yet
+		for(int port=0; port<4; port++)
+		{
+			if(!(found & (1 << port)))
+				PhySetBusConfig(port, candidates[i]);
+		}
+
+		uint8_t ok = 0xf;
+		for(int pass=0; pass<4; pass++)
+		{
+			uint16_t id1[4];
+			uint16_t id2[4];
+			PhyRegisterReadAll(PHY_REG_ID1, id1);
+			PhyRegisterReadAll(PHY_REG_ID2, id2);
+			for(int port=0; port<4; port++)
+			{
+				if( (id1[port] != 0x0022) || ( (id2[port] >> 4) != 0x162) )
+					ok &= ~(1 << port);
+			}
+		}
+
+		found |= ok;
+	}
+
+	//Anything that never worked goes back to the power-on setting
+	for(int port=0; port<4; port++)
+	{
+		if(!(found & (1 << port)))
+			PhySetBusConfig(port, { MDIO_CLKDIV_DEFAULT, false });
+
+		//Failed probes may have left garbage in the cache
+		PhyCacheInvalidate(port);
+
+		auto rate = PhyGetMdcRate(port);
+		g_log("Port %d (%s): MDC %d.%03d MHz, preamble %s\n",
+			port,
+			g_portDescriptions[port],
+			rate / 1000000,
+			(rate / 1000) % 1000,
+			g_mdioConfig[port].preambleSuppress ? "suppressed" : "enabled");
+	}
+}
+
 void InitPHYs()
 {
+	g_log("Initializing Ethernet PHYs\n");
+	RingLogIndenter li(g_log);
+
+	//Every PHY has its own MDIO bus, so bring them all up in parallel
+
+	//KSZ9031 datasheet does not mention a minimum reset pulse width
+	//Do 1 ms to be safe. Timer is 10 kHz so that's 10 ticks.
+	//We then need a min of 100us before poking any registers; do 1ms
 	for(int port = 0; port < 4; port ++)
+		g_qspi->BlockingWrite8(port*REG_ETH_OFFSET + REG_ETH0_RST, 0, 0);
+	g_logTimer->Sleep(10);
+	for(int port = 0; port < 4; port ++)
+	{
+		g_qspi->BlockingWrite8(port*REG_ETH_OFFSET + REG_ETH0_RST, 0, 1);
+		PhyCacheInvalidate(port);
+	}
+	g_logTimer->Sleep(10);
+
+	//Identify the PHYs and make sure they're what we expect
+	uint16_t id1[4];
+	uint16_t id2[4];
+	PhyRegisterReadAll(PHY_REG_ID1, id1);
+	PhyRegisterReadAll(PHY_REG_ID2, id2);
+	for(int port = 0; port < 4; port ++)
+	{
+		if( (id1[port] != 0x0022) || ( (id2[port] >> 4) != 0x162) )
+		{
+			g_log("Port %d (%s): unexpected PHY identifier (ID1=%04x, ID2=%04x)\n",
+				port, g_portDescriptions[port], id1[port], id2[port]);
+		}
+		else
+			g_log("Port %d (%s): detected KSZ9031RNX rev %d\n", port, g_portDescriptions[port], id2[port] & 0xf);
+	}
+
+	//Speed up register access as much as each PHY allows
+	ProbeMdioSpeed();
+
+	//Select 16ms AN FLP interval (default is 8 but this doesn't work with some PHYs)
+	g_log("Selecting 16ms AN burst interval\n");
+	PhyRegisterWriteAll(PHY_REG_MMD_CTRL, 0x0000);
+	PhyRegisterWriteAll(PHY_REG_MMD_DATA, PHY_REG_MMD0_FLP_LO);
+	PhyRegisterWriteAll(PHY_REG_MMD_CTRL, 0x4000);
+	PhyRegisterWriteAll(PHY_REG_MMD_DATA, 0x1a80);
+	PhyRegisterWriteAll(PHY_REG_MMD_CTRL, 0x0000);
+	PhyRegisterWriteAll(PHY_REG_MMD_DATA, PHY_REG_MMD0_FLP_HI);
+	PhyRegisterWriteAll(PHY_REG_MMD_CTRL, 0x4000);
+	PhyRegisterWriteAll(PHY_REG_MMD_DATA, 0x0006);
+
+	//Change AN advertisement to exclude half duplex modes
+	g_log("Advertising all speeds in full duplex only\n");
+	PhyRegisterWriteAll(PHY_REG_AN_ADVERT, 0x141);
+
+	//Have the FPGA keep the registers we need for the front panel LEDs up to date in the background
+	g_log("Starting background register polling\n");
+	static const uint8_t pollRegs[PHY_POLL_COUNT] =
 	{
-		g_log("Initializing Ethernet port %d (%s)\n", port, g_portDescriptions[port]);
-		LogIndenter li(g_log);
+		PHY_REG_AN_ADVERT,
+		PHY_REG_GIG_CONTROL,
+		PHY_REG_CTRL,
+		PHY_REG_BASIC_CONTROL
+	};
+	PhyPollerConfigure(0xf, pollRegs, PHY_POLL_COUNT);
+}
 
-		auto base = (port * REG_ETH_OFFSET);
+/**
+	@brief Current MDC rate and preamble setting of each MDIO bus
+ */
+MdioBusConfig g_mdioConfig[4] =
+{
+	{ MDIO_CLKDIV_DEFAULT, false },
+	{ MDIO_CLKDIV_DEFAULT, false },
+	{ MDIO_CLKDIV_DEFAULT, false },
+	{ MDIO_CLKDIV_DEFAULT, false }
+};
 
-		//KSZ9031 datasheet does not mention a minimum reset pulse width
-		//Do 1 ms to be safe. Timer is 10 kHz so that's 10 ticks.
-		//We then need a min of 100us before poking any registers; do 1ms
-		g_qspi->BlockingWrite8(base + REG_ETH0_RST, 0, 0);
-		g_logTimer->Sleep(10);
-		g_qspi->BlockingWrite8(base + REG_ETH0_RST, 0, 1);
-		g_logTimer->Sleep(10);
+/**
+	@brief Changes the MDC rate and preamble setting of one MDIO bus
 
-		//Identify the PHY and make sure it's what we expect
-		auto id1 = PhyRegisterRead(port, PHY_REG_ID1);
-		auto id2 = PhyRegisterRead(port, PHY_REG_ID2);
-		if( (id1 != 0x0022) || ( (id2 >> 4) != 0x162) )
-			g_log("Unexpected PHY identifier (ID1=%04x, ID2=%04x)\n", id1, id2);
-		else
-			g_log("Detected KSZ9031RNX rev %d\n", id2 & 0xf);
+	Must not be called while a transaction is in progress on that bus.
+ */
+void PhySetBusConfig(int port, const MdioBusConfig& config)
+{
+	uint8_t msg[2] =
+	{
+		config.clkdiv,
+		static_cast<uint8_t>(config.preambleSuppress ? 1 : 0)
+	};
+	g_qspi->BlockingWrite(port*REG_ETH_OFFSET + REG_ETH0_MDIO_CFG, 0, msg, sizeof(msg));
+	g_mdioConfig[port] = config;
+}
+
+/**
+	@brief Returns the MDC frequency of one MDIO bus, in Hz
+ */
+uint32_t PhyGetMdcRate(int port)
+{
+	return 125000000 / (2 * (g_mdioConfig[port].clkdiv + 1));
+}
+
+/**
+	@brief Number of MDIO transactions on each port that never completed
+ */
+uint32_t g_mdioTimeouts[4] = {0};
+
+/**
+	@brief Number of MDIO command queue batches that never drained
+ */
+uint32_t g_mdioBatchTimeouts = 0;
+
+/**
+	@brief Ports with an MDIO transaction that completed but hasn't been consumed yet
+ */
+static uint8_t g_mdioDone = 0;
+
+/**
+	@brief Reads the MDIO status register, saving any new done flags
+
+	The done flags in the FPGA are cleared on read, so every read of REG_MDIO_STATUS has to go through here to avoid
+	losing a completion that someone else is waiting for.
+
+	@return Bitmask of ports with a transaction in progress
+ */
+uint8_t ITCM_CODE PhyPollStatus()
+{
+	uint8_t status = g_qspi->BlockingRead16(REG_MDIO_STATUS, 0) & 0xff;
+	g_mdioDone |= (status >> 4);
+	return status & 0xf;
+}
+
+/**
+	@brief Waits for the most recent MDIO transaction on each port in portmask to complete
+
+	A transaction takes 79 UIs of MDC including IFG (so about 40 us at the default ~2 MHz, and less once
+	ProbeMdioSpeed() has picked something faster). Give up after 1 ms.
+
+	@return True if all transactions completed, false on timeout
+ */
+bool ITCM_CODE PhyWaitDone(uint8_t portmask)
+{
+	ProfileScope ps(PROBE_MDIO_WAIT);
+	uint32_t start = g_logTimer->GetCount();
+	while(true)
+	{
+		uint8_t busy = PhyPollStatus();
+		if( ( (g_mdioDone & portmask) == portmask) && ( (busy & portmask) == 0) )
+		{
+			g_mdioDone &= ~portmask;
+			return true;
+		}
 
-		//Select 16ms AN FLP interval (default is 8 but this doesn't work with some PHYs)
-		g_log("Selecting 16ms AN burst interval\n");
-		PhyRegisterIndirectWrite(port, 0, PHY_REG_MMD0_FLP_LO, 0x1a80);
-		PhyRegisterIndirectWrite(port, 0, PHY_REG_MMD0_FLP_HI, 0x0006);
+		if( (g_logTimer->GetCount() - start) > 10)
+			break;
+	}
 
-		//Change AN advertisement to exclude half duplex modes
-		g_log("Advertising all speeds in full duplex only\n");
-		PhyRegisterWrite(port, PHY_REG_AN_ADVERT, 0x141);
+	for(int port = 0; port < 4; port ++)
+	{
+		if( (portmask & (1 << port)) && !(g_mdioDone & (1 << port)) )
+		{
+			g_mdioTimeouts[port] ++;
+			g_log(Logger::WARNING, "MDIO transaction on port %d (%s) timed out\n", port, g_portDescriptions[port]);
+		}
 	}
+	return false;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PHY register cache
+
 /**
-	@brief Reads a single PHY register
+	@brief Cached value of every register on every PHY
  */
-uint16_t PhyRegisterRead(int port, uint8_t regid)
+DTCM_BSS static uint16_t g_phyCache[4][32];
+
+/**
+	@brief Bitmask of which entries in g_phyCache are valid
+ */
+DTCM_BSS static uint32_t g_phyCacheValid[4];
+
+uint32_t g_phyCacheHits[4] = {0};
+uint32_t g_phyCacheMisses[4] = {0};
+
+/**
+	@brief Registers that only change when we write them, and can be cached indefinitely
+ */
+static const uint32_t g_phyCacheStatic =
+	(1 << PHY_REG_BASIC_CONTROL) |
+	(1 << PHY_REG_ID1) |
+	(1 << PHY_REG_ID2) |
+	(1 << PHY_REG_AN_ADVERT) |
+	(1 << PHY_REG_AN_NEXT_PAGE) |
+	(1 << PHY_REG_GIG_CONTROL) |
+	(1 << PHY_REG_REMOTE_LOOPBACK) |
+	(1 << PHY_REG_MDIX);
+
+/**
+	@brief Registers that only change when the link state changes, and are flushed by OnFPGAInterrupt()
+
+	Anything not listed here or in g_phyCacheStatic (MMD access, LinkMD, error counters, interrupt status, etc) has
+	side effects or changes on its own and is never cached. That includes the registers with latching bits, since a
+	cached read would neither see the latched value nor clear it: BASIC_STATUS (link status and remote fault),
+	AN_EXPANSION (page received), and GIG_STATUS (master/slave fault, and the idle error count clears on read).
+ */
+static const uint32_t g_phyCacheVolatile =
+	(1 << PHY_REG_AN_PARTNER) |
+	(1 << PHY_REG_AN_PARTNER_NEXT_PAGE) |
+	(1 << PHY_REG_DIGITAL_PCS_PMA) |
+	(1 << PHY_REG_CTRL);
+
+/**
+	@brief Discards every cached register on a port (e.g. after resetting the PHY)
+ */
+void PhyCacheInvalidate(int port)
 {
+	g_phyCacheValid[port] = 0;
+}
+
+/**
+	@brief Discards cached registers on a port that depend on link state
+ */
+void PhyCacheInvalidateVolatile(int port)
+{
+	g_phyCacheValid[port] &= ~g_phyCacheVolatile;
+}
+
+/**
+	@brief Saves a value just read from a PHY register, if the register is cacheable
+ */
+static void PhyCacheFill(int port, uint8_t regid, uint16_t value)
+{
+	uint32_t mask = (1 << regid);
+	if( (g_phyCacheStatic | g_phyCacheVolatile) & mask)
+	{
+		g_phyCache[port][regid] = value;
+		g_phyCacheValid[port] |= mask;
+	}
+}
+
+/**
+	@brief Forgets one cached register, e.g. when we don't know what happened to it
+ */
+static void PhyCacheDiscard(int port, uint8_t regid)
+{
+	g_phyCacheValid[port] &= ~(1 << regid);
+}
+
+/**
+	@brief Updates the cache after a write to a PHY register
+ */
+static void PhyCacheWrite(int port, uint8_t regid, uint16_t value)
+{
+	uint32_t mask = (1 << regid);
+
+	//Status registers don't read back what we wrote
+	if(!(g_phyCacheStatic & mask))
+	{
+		g_phyCacheValid[port] &= ~mask;
+		return;
+	}
+
+	if(regid == PHY_REG_BASIC_CONTROL)
+	{
+		//Software reset puts every register back to its default
+		if(value & 0x8000)
+		{
+			PhyCacheInvalidate(port);
+			return;
+		}
+
+		//Restart AN is self clearing
+		value &= ~0x0200;
+	}
+
+	PhyCacheFill(port, regid, value);
+}
+
+/**
+	@brief Reads a single PHY register, from the cache if possible
+
+	@return True on success, false if the MDIO transaction timed out (value is then 0xffff, and isn't cached)
+ */
+bool ITCM_CODE PhyRegisterRead(int port, uint8_t regid, uint16_t& value)
+{
+	regid &= 0x1f;
+	if(g_phyCacheValid[port] & (1 << regid))
+	{
+		g_phyCacheHits[port] ++;
+		value = g_phyCache[port][regid];
+		return true;
+	}
+	g_phyCacheMisses[port] ++;
+
+	PhyAsyncFinish(1 << port);
 	auto base = (port * REG_ETH_OFFSET);
 	g_qspi->BlockingWrite8(base + REG_ETH0_MDIO_RADDR, 0, regid);
+	if(!PhyWaitDone(1 << port))
+	{
+		value = 0xffff;
+		return false;
+	}
 
-	//Wait for read to complete. Deterministic run time, no need for polling
-	//MDIO clock runs at about 2 MHz.
-	//An entire transaction is 32 + 2 + 2 + 5 + 5 + 1 + 16 + 16 = 79 UIs including IFG (so 39 us)
-	//Two ticks (nominal 200us) is plenty even if we don't reset the timer (so worst case 100us).
-	g_logTimer->Sleep(2);
+	value = g_qspi->BlockingRead16(base + REG_ETH0_MDIO_RDATA, 0);
+	PhyCacheFill(port, regid, value);
+	return true;
+}
+
+/**
+	@brief Reads a single PHY register, from the cache if possible
 
-	return g_qspi->BlockingRead16(base + REG_ETH0_MDIO_RDATA, 0);
+	Timeouts are logged and counted by PhyWaitDone(), and read as 0xffff (same as a PHY that isn't there).
+ */
+uint16_t ITCM_CODE PhyRegisterRead(int port, uint8_t regid)
+{
+	uint16_t value;
+	PhyRegisterRead(port, regid, value);
+	return value;
 }
 
 /**
-	@brief Writes a single PHY register
+	@brief Writes a single PHY register, updating the cache
  */
-void PhyRegisterWrite(int port, uint8_t regid, uint16_t regval)
+void ITCM_CODE PhyRegisterWrite(int port, uint8_t regid, uint16_t regval)
 {
+	regid &= 0x1f;
 	uint8_t msg[3] =
 	{
 		regid,
@@ -461,37 +993,563 @@ void PhyRegisterWrite(int port, uint8_t regid, uint16_t regval)
 		static_cast<uint8_t>(regval >> 8)
 	};
 
+	PhyAsyncFinish(1 << port);
 	auto base = (port * REG_ETH_OFFSET);
 	g_qspi->BlockingWrite(base + REG_ETH0_MDIO_WR, 0, msg, sizeof(msg));
 
-	//Wait for write to complete
-	g_logTimer->Sleep(2);
+	//If the write timed out we don't know what the register holds
+	if(PhyWaitDone(1 << port))
+		PhyCacheWrite(port, regid, regval);
+	else
+		PhyCacheDiscard(port, regid);
+}
+
+/**
+	@brief Reads the same register on all four PHYs at once
+
+	Always goes to the hardware, but refreshes the cache with the results unless the read timed out.
+ */
+void PhyRegisterReadAll(uint8_t regid, uint16_t regvals[4])
+{
+	regid &= 0x1f;
+	PhyAsyncFinish(0xf);
+	g_qspi->BlockingWrite8(REG_MDIO_RD_ALL, 0, regid);
+	bool ok = PhyWaitDone(0xf);
+
+	uint8_t buf[8];
+	g_qspi->BlockingRead(REG_MDIO_RDATA_ALL, 0, buf, sizeof(buf));
+	for(int i=0; i<4; i++)
+	{
+		regvals[i] = buf[i*2] | (buf[i*2 + 1] << 8);
+		if(ok)
+			PhyCacheFill(i, regid, regvals[i]);
+	}
+}
+
+/**
+	@brief Writes the same value to a register on all four PHYs at once
+ */
+void PhyRegisterWriteAll(uint8_t regid, uint16_t regval)
+{
+	regid &= 0x1f;
+	uint8_t msg[3] =
+	{
+		regid,
+		static_cast<uint8_t>(regval & 0xff),
+		static_cast<uint8_t>(regval >> 8)
+	};
+	PhyAsyncFinish(0xf);
+	g_qspi->BlockingWrite(REG_MDIO_WR_ALL, 0, msg, sizeof(msg));
+	bool ok = PhyWaitDone(0xf);
+	for(int i=0; i<4; i++)
+	{
+		if(ok)
+			PhyCacheWrite(i, regid, regval);
+		else
+			PhyCacheDiscard(i, regid);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Non-blocking PHY access
+
+/**
+	@brief A queued asynchronous PHY register access
+ */
+struct PhyAsyncRequest
+{
+	bool			write;
+	uint8_t			regid;
+	uint16_t		value;
+	PhyCallback		callback;
+	void*			param;
+};
+
+/**
+	@brief Per-port queue of asynchronous requests. The request at the head is the one in flight, if any.
+ */
+struct PhyAsyncQueue
+{
+	PhyAsyncRequest	requests[PHY_ASYNC_DEPTH];
+	uint8_t			head;
+	uint8_t			count;
+	bool			inFlight;
+	uint32_t		issueTime;		//g_logTimer count when the in-flight request was sent
+};
+
+DTCM_BSS static PhyAsyncQueue g_phyAsync[4];
+
+/**
+	@brief Adds a request to the queue for a port
+
+	@return False if the queue is full
+ */
+static bool PhyAsyncPush(int port, bool write, uint8_t regid, uint16_t value, PhyCallback callback, void* param)
+{
+	auto& q = g_phyAsync[port];
+	if(q.count >= PHY_ASYNC_DEPTH)
+		return false;
+
+	auto& req = q.requests[(q.head + q.count) % PHY_ASYNC_DEPTH];
+	req.write = write;
+	req.regid = regid & 0x1f;
+	req.value = value;
+	req.callback = callback;
+	req.param = param;
+	q.count ++;
+
+	SchedulerWake(g_taskTable[TASK_BACKGROUND]);
+	return true;
+}
+
+/**
+	@brief Queues a PHY register read. The callback is run from PollIO() once the value is available, or the read
+	times out.
+
+	@return False if the queue is full
+ */
+bool PhyAsyncRead(int port, uint8_t regid, PhyCallback callback, void* param)
+{
+	return PhyAsyncPush(port, false, regid, 0, callback, param);
+}
+
+/**
+	@brief Queues a PHY register write. The callback (if not null) is run from PollIO() once the write completes.
+
+	@return False if the queue is full
+ */
+bool PhyAsyncWrite(int port, uint8_t regid, uint16_t value, PhyCallback callback, void* param)
+{
+	return PhyAsyncPush(port, true, regid, value, callback, param);
+}
+
+/**
+	@brief Returns true if a port has no asynchronous requests queued or in flight
+ */
+bool ITCM_CODE PhyAsyncIdle(int port)
+{
+	return g_phyAsync[port].count == 0;
+}
+
+/**
+	@brief Retires the request at the head of a port's queue and runs its callback
+ */
+static void ITCM_CODE PhyAsyncComplete(int port, bool ok, uint16_t value)
+{
+	auto& q = g_phyAsync[port];
+	auto req = q.requests[q.head];
+	q.head = (q.head + 1) % PHY_ASYNC_DEPTH;
+	q.count --;
+	q.inFlight = false;
+
+	if(req.callback)
+		req.callback(req.param, ok, value);
+}
+
+/**
+	@brief Collects the result of the in-flight transaction on a port, which must have completed or timed out
+
+	A read that timed out completes with 0xffff, and neither kind updates the cache.
+ */
+static void ITCM_CODE PhyAsyncCollect(int port, bool ok)
+{
+	auto& req = g_phyAsync[port].requests[g_phyAsync[port].head];
+	uint16_t value = req.value;
+	if(!ok)
+	{
+		PhyCacheDiscard(port, req.regid);
+		if(!req.write)
+			value = 0xffff;
+	}
+	else if(req.write)
+		PhyCacheWrite(port, req.regid, value);
+	else
+	{
+		value = g_qspi->BlockingRead16(port*REG_ETH_OFFSET + REG_ETH0_MDIO_RDATA, 0);
+		PhyCacheFill(port, req.regid, value);
+	}
+	PhyAsyncComplete(port, ok, value);
+}
+
+/**
+	@brief Sends the request at the head of a port's queue, which must not be in flight
+
+	Reads that hit in the cache complete immediately without touching the bus.
+ */
+static void ITCM_CODE PhyAsyncIssue(int port)
+{
+	auto& q = g_phyAsync[port];
+	auto& req = q.requests[q.head];
+	auto base = (port * REG_ETH_OFFSET);
+	if(req.write)
+	{
+		uint8_t msg[3] =
+		{
+			req.regid,
+			static_cast<uint8_t>(req.value & 0xff),
+			static_cast<uint8_t>(req.value >> 8)
+		};
+		g_qspi->BlockingWrite(base + REG_ETH0_MDIO_WR, 0, msg, sizeof(msg));
+	}
+	else
+	{
+		if(g_phyCacheValid[port] & (1 << req.regid))
+		{
+			g_phyCacheHits[port] ++;
+			PhyAsyncComplete(port, true, g_phyCache[port][req.regid]);
+			return;
+		}
+		g_phyCacheMisses[port] ++;
+
+		g_qspi->BlockingWrite8(base + REG_ETH0_MDIO_RADDR, 0, req.regid);
+	}
+	q.inFlight = true;
+	q.issueTime = g_logTimer->GetCount();
+}
+
+/**
+	@brief Runs every queued asynchronous request on each port in portmask to completion, blocking until done
+
+	Called by the blocking accessors before they touch a bus, since the FPGA only holds one host request per port.
+	Draining the whole queue (not just the request in flight) keeps every access to a PHY in the order it was made.
+	Callbacks run from here, and anything they queue is drained too.
+ */
+void ITCM_CODE PhyAsyncFinish(uint8_t portmask)
+{
+	for(int port=0; port<4; port++)
+	{
+		if(!(portmask & (1 << port)))
+			continue;
+
+		auto& q = g_phyAsync[port];
+		while(q.count)
+		{
+			if(!q.inFlight)
+				PhyAsyncIssue(port);
+			else
+				PhyAsyncCollect(port, PhyWaitDone(1 << port));
+		}
+	}
+}
+
+/**
+	@brief Makes progress on all queued asynchronous requests without blocking on MDIO
+
+	Completes any transactions that have finished (or failed them, if they've taken as long as PhyWaitDone() would
+	wait) and issues the next request on each idle port.
+ */
+void ITCM_CODE PhyAsyncPoll()
+{
+	//Check for completions
+	uint8_t inFlight = 0;
+	for(int port=0; port<4; port++)
+	{
+		if(g_phyAsync[port].inFlight)
+			inFlight |= (1 << port);
+	}
+	if(inFlight)
+	{
+		uint8_t busy = PhyPollStatus();
+		for(int port=0; port<4; port++)
+		{
+			uint8_t mask = (1 << port);
+			if( (inFlight & mask) && (g_mdioDone & mask) && !(busy & mask) )
+			{
+				g_mdioDone &= ~mask;
+				PhyAsyncCollect(port, true);
+			}
+
+			//Same timeout as PhyWaitDone()
+			else if( (inFlight & mask) && ( (g_logTimer->GetCount() - g_phyAsync[port].issueTime) > 10) )
+			{
+				g_mdioTimeouts[port] ++;
+				g_log(Logger::WARNING, "MDIO transaction on port %d (%s) timed out\n", port, g_portDescriptions[port]);
+				PhyAsyncCollect(port, false);
+			}
+		}
+	}
+
+	//Issue new requests
+	for(int port=0; port<4; port++)
+	{
+		auto& q = g_phyAsync[port];
+		if(!q.inFlight && (q.count != 0) )
+			PhyAsyncIssue(port);
+	}
+}
+
+/**
+	@brief Sets the list of registers the FPGA polls in the background on each port in portmask
+
+	The same list is used for every port. Host accesses always take priority over polling, so this adds at most one
+	MDIO transaction of latency to PhyRegisterRead() / PhyRegisterWrite().
+ */
+void PhyPollerConfigure(uint8_t portmask, const uint8_t* regids, int count)
+{
+	if(count > PHY_POLL_MAX)
+		count = PHY_POLL_MAX;
+
+	uint8_t msg[2 + PHY_POLL_MAX] = {0};
+	msg[0] = portmask;
+	msg[1] = count;
+	for(int i=0; i<count; i++)
+		msg[2 + i] = regids[i];
+
+	g_qspi->BlockingWrite(REG_MDIO_POLL_CFG, 0, msg, 2 + count);
+}
+
+/**
+	@brief Returns a bitmask of ports whose shadowed registers changed since the last call
+ */
+uint8_t PhyShadowChanged()
+{
+	return g_qspi->BlockingRead16(REG_MDIO_SHADOW_CHANGED, 0) & 0xf;
+}
+
+/**
+	@brief Reads the most recently polled value of every shadowed register in one burst
+ */
+void PhyShadowRead(uint16_t regvals[4][PHY_POLL_MAX])
+{
+	uint8_t buf[4 * PHY_POLL_MAX * 2];
+	g_qspi->BlockingRead(REG_MDIO_SHADOW, 0, buf, sizeof(buf));
+	for(int port=0; port<4; port++)
+	{
+		for(int i=0; i<PHY_POLL_MAX; i++)
+		{
+			int off = (port*PHY_POLL_MAX + i) * 2;
+			regvals[port][i] = buf[off] | (buf[off + 1] << 8);
+		}
+	}
+}
+
+/**
+	@brief Pushes a list of raw 4-byte commands to the FPGA command queue, waits for them to finish, and reads back
+	the results of every MDIO read they performed
+
+	@return True on success, false if the queue timed out
+ */
+static bool ITCM_CODE PhyQueueRun(const uint8_t* cmds, int ncmds, uint16_t* results, int nresults)
+{
+	ProfileScope ps(PROBE_MDIO_BATCH);
+	PhyAsyncFinish(0xf);
+	g_qspi->BlockingWrite(REG_MDIO_BATCH, 0, cmds, ncmds * 4);
+
+	//Wait for the queue to drain.
+	//Each transaction is about 40us so 32 of them fit in 13 ticks, time out well after that.
+	//Bursts can be much longer, allow for those too.
+	uint32_t timeout = 50 + nresults / 2;
+	uint32_t start = g_logTimer->GetCount();
+	uint8_t status[2] = {0};
+	bool ok = true;
+	while(true)
+	{
+		g_qspi->BlockingRead(REG_MDIO_BATCH_STAT, 0, status, 2);
+		if( (status[0] == ncmds) && ( (status[1] & 1) == 0) )
+			break;
+
+		if( (g_logTimer->GetCount() - start) > timeout)
+		{
+			g_mdioBatchTimeouts ++;
+			g_log(Logger::WARNING, "MDIO batch timed out (%d of %d done)\n", status[0], ncmds);
+			ok = false;
+			break;
+		}
+	}
+
+	//Discard the per-port done flags set by the queue so they don't satisfy a later PhyWaitDone()
+	PhyPollStatus();
+	g_mdioDone = 0;
+
+	//Read all of the results in one burst
+	if(nresults)
+	{
+		uint8_t buf[PHY_BATCH_RESULTS_MAX * 2];
+		g_qspi->BlockingRead(REG_MDIO_BATCH_RD, 0, buf, nresults * 2);
+		for(int i=0; i<nresults; i++)
+			results[i] = buf[i*2] | (buf[i*2 + 1] << 8);
+	}
+
+	return ok;
+}
+
+/**
+	@brief Runs a list of PHY register accesses back to back using the FPGA command queue
+
+	Much faster than a sequence of PhyRegisterRead() / PhyRegisterWrite() calls since we only pay the QSPI turnaround
+	and completion polling once per batch, not once per register. Commands for different ports run concurrently on
+	their own MDIO buses. Read results are returned in the value field.
+
+	Batches always go to the hardware, but keep the register cache coherent.
+
+	@return True on success. False if the command queue timed out: read values of the failed block and everything
+	after it are garbage, and later transactions weren't run at all.
+ */
+bool PhyBatchExecute(PhyTransaction* txns, int count)
+{
+	while(count > 0)
+	{
+		int nblock = count;
+		if(nblock > PHY_BATCH_MAX)
+			nblock = PHY_BATCH_MAX;
+
+		//Push all of the commands in one burst
+		uint8_t cmds[PHY_BATCH_MAX * 4];
+		int nreads = 0;
+		for(int i=0; i<nblock; i++)
+		{
+			auto& t = txns[i];
+			t.regid &= 0x1f;
+			cmds[i*4 + 0] = (t.write ? PHY_QUEUE_OP_WRITE : PHY_QUEUE_OP_READ) | (t.port & 3);
+			cmds[i*4 + 1] = t.regid;
+			cmds[i*4 + 2] = t.value & 0xff;
+			cmds[i*4 + 3] = t.value >> 8;
+
+			if(!t.write)
+				nreads ++;
+		}
+
+		//We don't know which commands ran or what the result buffer holds, so trust none of it
+		uint16_t results[PHY_BATCH_MAX];
+		if(!PhyQueueRun(cmds, nblock, results, nreads))
+		{
+			for(int i=0; i<nblock; i++)
+				PhyCacheDiscard(txns[i].port & 3, txns[i].regid);
+			return false;
+		}
+
+		//Hand out results, and update the cache in program order so a read after a write to the same register
+		//sees the new value
+		int nread = 0;
+		for(int i=0; i<nblock; i++)
+		{
+			auto& t = txns[i];
+			if(t.write)
+				PhyCacheWrite(t.port & 3, t.regid, t.value);
+			else
+			{
+				t.value = results[nread ++];
+				PhyCacheFill(t.port & 3, t.regid, t.value);
+			}
+		}
+
+		txns += nblock;
+		count -= nblock;
+	}
+
+	return true;
+}
+
+/**
+	@brief Encodes an MMD address setup command for the FPGA command queue
+
+	The FPGA expands this into the MMD_CTRL / MMD_DATA / MMD_CTRL write sequence.
+ */
+static void PhyQueueMmdSetup(uint8_t* cmd, int port, uint8_t mmd, uint16_t regid, uint8_t mode)
+{
+	cmd[0] = PHY_QUEUE_OP_MMD_SETUP | (port & 3);
+	cmd[1] = (mode << 6) | (mmd & 0x1f);
+	cmd[2] = regid & 0xff;
+	cmd[3] = regid >> 8;
 }
 
 /**
 	@brief Reads an indirect PHY register
+
+	@return True on success, false if the command queue timed out (value is garbage)
  */
-uint16_t PhyRegisterIndirectRead(int port, uint8_t mmd, uint16_t regid)
+bool PhyRegisterIndirectRead(int port, uint8_t mmd, uint16_t regid, uint16_t& value)
 {
-	PhyRegisterWrite(port, PHY_REG_MMD_CTRL, mmd);
-	PhyRegisterWrite(port, PHY_REG_MMD_DATA, regid);
-	PhyRegisterWrite(port, PHY_REG_MMD_CTRL, mmd | 0x4000);
-	return PhyRegisterRead(port, PHY_REG_MMD_DATA);
+	uint8_t cmds[8];
+	PhyQueueMmdSetup(cmds, port, mmd, regid, PHY_MMD_MODE_DATA);
+	cmds[4] = PHY_QUEUE_OP_MMD_READ | (port & 3);
+	cmds[5] = 0;
+	cmds[6] = 1;
+	cmds[7] = 0;
+
+	return PhyQueueRun(cmds, 2, &value, 1);
+}
+
+/**
+	@brief Reads a block of consecutive indirect PHY registers using the PHY's post-increment mode
+
+	Each chunk of up to PHY_MMD_BURST_MAX registers costs one QSPI write, one status poll loop and one QSPI read.
+
+	@return True on success, false if the command queue timed out (the rest of the range isn't read)
+ */
+bool PhyRegisterIndirectReadRange(int port, uint8_t mmd, uint16_t start, int count, uint16_t* values)
+{
+	while(count > 0)
+	{
+		int nblock = count;
+		if(nblock > PHY_MMD_BURST_MAX)
+			nblock = PHY_MMD_BURST_MAX;
+
+		uint8_t cmds[8];
+		PhyQueueMmdSetup(cmds, port, mmd, start, PHY_MMD_MODE_DATA_INC_RW);
+		cmds[4] = PHY_QUEUE_OP_MMD_READ | (port & 3);
+		cmds[5] = 0;
+		cmds[6] = nblock;
+		cmds[7] = 0;
+		if(!PhyQueueRun(cmds, 2, values, nblock))
+			return false;
+
+		start += nblock;
+		values += nblock;
+		count -= nblock;
+	}
+
+	return true;
 }
 
 /**
 	@brief Writes an indirect PHY register
+
+	@return True on success, false if the command queue timed out
  */
-void PhyRegisterIndirectWrite(int port, uint8_t mmd, uint16_t regid, uint16_t regval)
+bool PhyRegisterIndirectWrite(int port, uint8_t mmd, uint16_t regid, uint16_t regval)
 {
-	PhyRegisterWrite(port, PHY_REG_MMD_CTRL, mmd);
-	PhyRegisterWrite(port, PHY_REG_MMD_DATA, regid);
-	PhyRegisterWrite(port, PHY_REG_MMD_CTRL, mmd | 0x4000);
-	PhyRegisterWrite(port, PHY_REG_MMD_DATA, regval);
+	uint8_t cmds[8];
+	PhyQueueMmdSetup(cmds, port, mmd, regid, PHY_MMD_MODE_DATA);
+	cmds[4] = PHY_QUEUE_OP_WRITE | (port & 3);
+	cmds[5] = PHY_REG_MMD_DATA;
+	cmds[6] = regval & 0xff;
+	cmds[7] = regval >> 8;
+	return PhyQueueRun(cmds, 2, nullptr, 0);
 }
 
-void OnFPGAInterrupt()
+/**
+	@brief Handles events from the FPGA IRQ line. Run by the scheduler after EXTI15_10_Handler() queues an event.
+ */
+void ITCM_CODE OnFPGAInterrupt()
 {
+	ProfileScope ps(PROBE_FPGA_IRQ);
+
+	//Several edges may have queued up since we last ran. One pass over the status registers handles all of them,
+	//so latency is measured from the oldest one.
+	uint32_t timestamp = 0;
+	bool gotEvent = false;
+	FPGAEvent ev;
+	while(g_fpgaEvents.Pop(ev))
+	{
+		if(!gotEvent)
+			timestamp = ev.timestamp;
+		gotEvent = true;
+	}
+
+	//The line is level sensitive but the EXTI only sees rising edges.
+	//If it's still asserted after we've handled everything, a new cause came in and there won't be another edge.
+	if(!*g_irq)
+		return;
+	if(!gotEvent)
+		timestamp = g_logTimer->GetCount();
+
+	//Only the link state cause is enabled. MDIO completion is polled by PhyWaitDone() and shadow register changes
+	//by UpdateSpeedLEDs()
+	uint8_t cause = g_qspi->BlockingRead16(REG_IRQ_STATUS, 0) & 0xff;
+	if(!(cause & IRQ_LINK_STATE))
+		return;
+
 	uint16_t status = g_qspi->BlockingRead16(REG_LINK_STATE, 0);
 	uint16_t delta = status ^ g_linkState;
 
@@ -503,6 +1561,9 @@ void OnFPGAInterrupt()
 		if( ((delta >> shift) & 0xf) == 0)
 			continue;
 
+		//Status and partner ability registers are stale now
+		PhyCacheInvalidateVolatile(nport);
+
 		//If speed changed while link is down, ignore that
 		int state = (status >> shift) & 0xf;
 		auto up = state & 0x8;
@@ -518,10 +1579,20 @@ void OnFPGAInterrupt()
 	}
 
 	g_linkState = status;
+
+	uint32_t latency = g_logTimer->GetCount() - timestamp;
+	g_fpgaIrqLatencyLast = latency;
+	if(latency > g_fpgaIrqLatencyMax)
+		g_fpgaIrqLatencyMax = latency;
+
+	if(*g_irq)
+		SchedulerWake(g_taskTable[TASK_FPGA_IRQ]);
 }
 
 void UpdateSpeedLEDs()
 {
+	ProfileScope ps(PROBE_LEDS);
+
 	//LEDs
 	static GPIOPin left_aneg_en(&GPIOC, 4, GPIOPin::MODE_OUTPUT, GPIOPin::SLEW_SLOW);
 	static GPIOPin left_10m_en(&GPIOB, 11, GPIOPin::MODE_OUTPUT, GPIOPin::SLEW_SLOW);
@@ -533,22 +1604,30 @@ void UpdateSpeedLEDs()
 	static GPIOPin right_100m_en(&GPIOG, 15, GPIOPin::MODE_OUTPUT, GPIOPin::SLEW_SLOW);
 	static GPIOPin right_1000m_en(&GPIOB, 8, GPIOPin::MODE_OUTPUT, GPIOPin::SLEW_SLOW);
 
-	//Get advertised speeds/modes for each port
-	auto leftAd = PhyRegisterRead(0, PHY_REG_AN_ADVERT);
-	auto leftGig = PhyRegisterRead(0, PHY_REG_GIG_CONTROL);
+	//Get advertised speeds/modes, actual operating speeds, and AN enable status for each port.
+	//These are polled by the FPGA in the background, so only fetch them when something changed.
+	static uint16_t regs[4][PHY_POLL_MAX] = {{0}};
+	static bool shadowValid = false;
+	if(!shadowValid || (PhyShadowChanged() & 0x3) )
+	{
+		PhyShadowRead(regs);
+		shadowValid = true;
+	}
+
+	auto leftAd = regs[0][PHY_POLL_AN_ADVERT];
+	auto leftGig = regs[0][PHY_POLL_GIG_CONTROL];
 	bool left10 = (leftAd & 0x40) == 0x40;
 	bool left100 = (leftAd & 0x100) == 0x100;
 	bool left1000 = (leftGig & 0x200) == 0x200;
 
-	auto rightAd = PhyRegisterRead(1, PHY_REG_AN_ADVERT);
-	auto rightGig = PhyRegisterRead(1, PHY_REG_GIG_CONTROL);
+	auto rightAd = regs[1][PHY_POLL_AN_ADVERT];
+	auto rightGig = regs[1][PHY_POLL_GIG_CONTROL];
 	bool right10 = (rightAd & 0x40) == 0x40;
 	bool right100 = (rightAd & 0x100) == 0x100;
 	bool right1000 = (rightGig & 0x200) == 0x200;
 
-	//Get actual operating speeds
-	auto leftCtrl = PhyRegisterRead(0, PHY_REG_CTRL);
-	auto rightCtrl = PhyRegisterRead(1, PHY_REG_CTRL);
+	auto leftCtrl = regs[0][PHY_POLL_CTRL];
+	auto rightCtrl = regs[1][PHY_POLL_CTRL];
 	int leftSpeed = 0;
 	int rightSpeed = 0;
 	if(leftCtrl & 0x10)
@@ -564,9 +1643,8 @@ void UpdateSpeedLEDs()
 	if(rightCtrl & 0x40)
 		rightSpeed = 1000;
 
-	//Get AN enable status
-	auto leftBasic = PhyRegisterRead(0, PHY_REG_BASIC_CONTROL);
-	auto rightBasic = PhyRegisterRead(1, PHY_REG_BASIC_CONTROL);
+	auto leftBasic = regs[0][PHY_POLL_BASIC_CONTROL];
+	auto rightBasic = regs[1][PHY_POLL_BASIC_CONTROL];
 	bool leftAneg = (leftBasic & 0x1000) == 0x1000;
 	bool rightAneg = (rightBasic & 0x1000) == 0x1000;
 
@@ -600,9 +1678,20 @@ void UpdateSpeedLEDs()
 	right_aneg_en = rightAneg;
 }
 
+/**
+	@brief Reads the front panel buttons and acts on any presses
+
+	Called every 10 ms by the scheduler. A press is acted on once it has read the same for two consecutive samples,
+	and then ignored until all buttons are released.
+ */
 void CheckButtons()
 {
-	static bool changedLastTime = false;
+	ProfileScope ps(PROBE_BUTTONS);
+
+	static uint8_t lastSample = 0;
+
+	//A button held at power up to pick the clock profile isn't a press
+	static bool handled = g_clockProfileFromButton;
 
 	static GPIOPin left_aneg_sw(&GPIOF, 14, GPIOPin::MODE_INPUT, GPIOPin::SLEW_SLOW);
 	static GPIOPin left_10m_sw(&GPIOH, 2, GPIOPin::MODE_INPUT, GPIOPin::SLEW_SLOW);
@@ -624,90 +1713,94 @@ void CheckButtons()
 	bool right_100m = right_100m_sw;
 	bool right_1000m = right_1000m_sw;
 
-	//See which port (if any) was hit
-	int nport = 0;
-	bool changed = false;
-	if(left_aneg || left_10m || left_100m || left_1000m)
-		changed = true;
-	if(right_aneg || right_10m || right_100m || right_1000m)
+	uint8_t sample =
+		(left_aneg << 0) | (left_10m << 1) | (left_100m << 2) | (left_1000m << 3) |
+		(right_aneg << 4) | (right_10m << 5) | (right_100m << 6) | (right_1000m << 7);
+
+	//Wait for the inputs to settle
+	bool stable = (sample == lastSample);
+	lastSample = sample;
+	if(!stable)
+		return;
+
+	//All released? Ready for the next press
+	if(sample == 0)
 	{
-		changed = true;
-		nport = 1;
+		handled = false;
+		return;
 	}
 
-	//Ignore any button presses if we just executed one
-	if(changedLastTime && changed)
+	//Ignore the buttons being held down after we already executed the press
+	if(handled)
 		return;
+	handled = true;
 
-	changedLastTime = changed;
+	//See which port was hit
+	int nport = 0;
+	if(right_aneg || right_10m || right_100m || right_1000m)
+		nport = 1;
 
 	//Process the changes
-	if(changed)
+	auto basic = PhyRegisterRead(nport, PHY_REG_BASIC_CONTROL);
+	auto an_on = (basic & 0x1000) == 0x1000;
+	auto gig = PhyRegisterRead(nport, PHY_REG_GIG_CONTROL);
+	auto adv = PhyRegisterRead(nport, PHY_REG_AN_ADVERT);
+
+	//Toggle AN flag
+	if(left_aneg || right_aneg)
 	{
-		auto basic = PhyRegisterRead(nport, PHY_REG_BASIC_CONTROL);
-		auto an_on = (basic & 0x1000) == 0x1000;
-		auto gig = PhyRegisterRead(nport, PHY_REG_GIG_CONTROL);
-		auto adv = PhyRegisterRead(nport, PHY_REG_AN_ADVERT);
+		basic ^= 0x1000;
+		an_on = !an_on;
 
-		//Toggle AN flag
-		if(left_aneg || right_aneg)
+		//If turning AN off, force to highest currently advertised speed
+		if(!an_on)
 		{
-			basic ^= 0x1000;
-			an_on = !an_on;
-
-			//If turning AN off, force to highest currently advertised speed
-			if(!an_on)
-			{
-				basic &= 0xdfbf;
-				if(gig & 0x200)
-					basic |= 0x0040;
-				else if(adv & 0x100)
-					basic |= 0x2000;
-			}
-
-			PhyRegisterWrite(nport, PHY_REG_BASIC_CONTROL, basic);
+			basic &= 0xdfbf;
+			if(gig & 0x200)
+				basic |= 0x0040;
+			else if(adv & 0x100)
+				basic |= 0x2000;
 		}
 
-		//If AN is on, toggle advertised speeds
-		if(an_on)
-		{
-			if(left_10m || right_10m || left_100m || right_100m )
-			{
-				if(left_10m || right_10m)
-					adv ^= 0x40;
-				if(left_100m || right_100m)
-					adv ^= 0x100;
-
-				PhyRegisterWrite(nport, PHY_REG_AN_ADVERT, adv);
-			}
+		PhyRegisterWrite(nport, PHY_REG_BASIC_CONTROL, basic);
+	}
 
-			if(left_1000m || right_1000m)
-				PhyRegisterWrite(nport, PHY_REG_GIG_CONTROL, gig ^ 0x200);
+	//If AN is on, toggle advertised speeds
+	if(an_on)
+	{
+		if(left_10m || right_10m || left_100m || right_100m )
+		{
+			if(left_10m || right_10m)
+				adv ^= 0x40;
+			if(left_100m || right_100m)
+				adv ^= 0x100;
 
-			RestartNegotiation(nport);
+			PhyRegisterWrite(nport, PHY_REG_AN_ADVERT, adv);
 		}
 
-		//If AN is off, force the clicked speed
-		else if(left_10m || right_10m || left_100m || right_100m || left_1000m || right_1000m)
-		{
-			//Mask off speed select
-			basic &= 0xdfbf;
+		if(left_1000m || right_1000m)
+			PhyRegisterWrite(nport, PHY_REG_GIG_CONTROL, gig ^ 0x200);
 
-			if(left_10m || right_10m)
-			{
-				//nothing to do, code 0 is 10M
-			}
+		RestartNegotiation(nport);
+	}
 
-			if(left_100m || right_100m)
-				basic |= 0x2000;
-			if(left_1000m || right_1000m)
-				basic |= 0x0040;
+	//If AN is off, force the clicked speed
+	else if(left_10m || right_10m || left_100m || right_100m || left_1000m || right_1000m)
+	{
+		//Mask off speed select
+		basic &= 0xdfbf;
 
-			PhyRegisterWrite(nport, PHY_REG_BASIC_CONTROL, basic);
+		if(left_10m || right_10m)
+		{
+			//nothing to do, code 0 is 10M
 		}
 
-		//1ms debounce timer
-		g_logTimer->Sleep(10);
+		if(left_100m || right_100m)
+			basic |= 0x2000;
+		if(left_1000m || right_1000m)
+			basic |= 0x0040;
+
+		PhyRegisterWrite(nport, PHY_REG_BASIC_CONTROL, basic);
 	}
 }
 
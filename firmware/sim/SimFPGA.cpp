@@ -0,0 +1,864 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include <string.h>
+#include "../ethernet-tap.h"
+#include "SimFPGA.h"
+
+SimFPGA g_simFPGA;
+
+//Simulated time since reset
+static uint64_t g_simTimeNs = 0;
+
+uint64_t SimGetTime()
+{
+	return g_simTimeNs;
+}
+
+void SimAdvance(uint64_t ns)
+{
+	g_simTimeNs += ns;
+}
+
+//Period of the FPGA fabric clock
+static const uint64_t g_fabricClockNs = 8;
+
+//CROSSING_FIFO_BYTES in PacketDatapath
+static const uint16_t g_pathFifoSize = 4096;
+
+SimFPGA::SimFPGA()
+	: m_mdioDone(0)
+	, m_linkStateLastRead(0)
+	, m_irqLink(false)
+	, m_irqMdio(false)
+	, m_irqEnable(IRQ_LINK_STATE)
+	, m_pollPorts(0)
+	, m_pollCount(0)
+	, m_monAggregate(false)
+	, m_monTagMode(MON_TAG_NONE)
+	, m_timestamp(false)
+	, m_filterDefault(FILTER_OFF)
+	, m_timestampBase(0)
+	, m_timestampLoadTime(0)
+	, m_trigMux(0)
+{
+	for(int i=0; i<4; i++)
+	{
+		m_clkdiv[i] = MDIO_CLKDIV_DEFAULT;
+		m_preambleSuppress[i] = false;
+		m_rstn[i] = false;
+		m_busFree[i] = 0;
+		m_hostBusy[i] = false;
+		m_hostDoneTime[i] = 0;
+		m_hostRdData[i] = 0;
+		m_hostPendingData[i] = 0;
+		m_hostPendingRead[i] = false;
+	}
+	memset(m_pollRegs, 0, sizeof(m_pollRegs));
+	memset(m_snaplen, 0, sizeof(m_snaplen));
+	memset(m_snapTrailer, 0, sizeof(m_snapTrailer));
+	memset(m_shadowLast, 0, sizeof(m_shadowLast));
+	memset(m_filterAction, 0, sizeof(m_filterAction));
+	memset(m_filterValue, 0, sizeof(m_filterValue));
+	memset(m_filterMask, 0, sizeof(m_filterMask));
+	memset(m_filterHits, 0, sizeof(m_filterHits));
+	memset(m_filterHitsSnapshot, 0, sizeof(m_filterHitsSnapshot));
+	for(int i=0; i<2; i++)
+	{
+		m_sampleMode[i] = SAMPLE_OFF;
+		m_sampleRate[i] = 0;
+		m_sampleCount[i] = 0;
+		m_sampleStats[i] = {0, 0};
+		m_sampleStatsSnapshot[i] = {0, 0};
+	}
+	memset(m_rmon, 0, sizeof(m_rmon));
+	memset(m_rmonSnapshot, 0, sizeof(m_rmonSnapshot));
+	memset(m_histogram, 0, sizeof(m_histogram));
+	memset(m_histogramSnapshot, 0, sizeof(m_histogramSnapshot));
+	for(int i=0; i<PATH_COUNT; i++)
+	{
+		m_paths[i] = {0, 0, 0, g_pathFifoSize};
+		m_pathsSnapshot[i] = m_paths[i];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// MDIO
+
+/**
+	@brief Time one MDIO frame plus inter-frame gap takes on a port's bus
+ */
+uint64_t SimFPGA::GetMdioDuration(int port)
+{
+	uint64_t bits = m_preambleSuppress[port] ? (1 + 32 + 15) : (32 + 32 + 15);
+	return bits * 2 * (m_clkdiv[port] + 1) * g_fabricClockNs;
+}
+
+/**
+	@brief Runs one MDIO transaction against the PHY model
+
+	@param earliest	Time the transaction can start, if the bus is free
+
+	@return Completion time
+ */
+uint64_t SimFPGA::MdioTransaction(int port, bool write, uint8_t regid, uint16_t& value, uint64_t earliest)
+{
+	uint64_t start = earliest;
+	if(m_busFree[port] > start)
+		start = m_busFree[port];
+	uint64_t done = start + GetMdioDuration(port);
+	m_busFree[port] = done;
+	m_stats.mdioTransactions[port] ++;
+
+	//PHY doesn't respond if held in reset, clocked too fast, or the preamble is missing and it needs one
+	auto& phy = m_phys[port];
+	uint32_t rate = 125000000 / (2 * (m_clkdiv[port] + 1));
+	bool ok = m_rstn[port] && (rate <= phy.m_maxMdcRate) && (!m_preambleSuppress[port] || phy.m_preambleSuppressOK);
+
+	if(write)
+	{
+		if(ok)
+			phy.Write(regid, value);
+	}
+	else
+		value = ok ? phy.Read(regid) : 0xffff;
+
+	return done;
+}
+
+/**
+	@brief Starts a transaction through the single-register host interface
+ */
+void SimFPGA::HostTransaction(int port, bool write, uint8_t regid, uint16_t value)
+{
+	uint64_t done = MdioTransaction(port, write, regid, value, SimGetTime());
+	m_hostBusy[port] = true;
+	m_hostDoneTime[port] = done;
+	m_hostPendingRead[port] = !write;
+	m_hostPendingData[port] = value;
+}
+
+/**
+	@brief Retires any host transactions that have completed by now
+ */
+void SimFPGA::Update()
+{
+	uint64_t now = SimGetTime();
+	for(int i=0; i<4; i++)
+	{
+		if(m_hostBusy[i] && (now >= m_hostDoneTime[i]) )
+		{
+			m_hostBusy[i] = false;
+			if(m_hostPendingRead[i])
+				m_hostRdData[i] = m_hostPendingData[i];
+			m_mdioDone |= (1 << i);
+			m_irqMdio = true;
+		}
+	}
+}
+
+/**
+	@brief Executes a REG_MDIO_BATCH command list (see MDIOCommandQueue.sv for the format)
+
+	Commands are issued in order and each waits for its own bus, so different ports overlap.
+ */
+void SimFPGA::RunBatch(const uint8_t* data, uint32_t len)
+{
+	m_queueDoneTimes.clear();
+	m_queueResults.clear();
+
+	uint64_t issue = SimGetTime();
+	for(uint32_t off = 0; off + 4 <= len; off += 4)
+	{
+		uint8_t op = data[off] >> 6;
+		int port = data[off] & 3;
+		uint8_t b1 = data[off + 1];
+		uint16_t arg = data[off + 2] | (data[off + 3] << 8);
+
+		//In order issue: can't start before the previous command did
+		if(m_busFree[port] > issue)
+			issue = m_busFree[port];
+
+		uint64_t done = issue;
+		uint16_t value;
+		switch(op)
+		{
+			case 0:
+				done = MdioTransaction(port, false, b1 & 0x1f, value, issue);
+				m_queueResults.push_back(value);
+				break;
+
+			case 1:
+				value = arg;
+				done = MdioTransaction(port, true, b1 & 0x1f, value, issue);
+				break;
+
+			case 2:
+				{
+					uint16_t mmd = b1 & 0x1f;
+					uint16_t mode = b1 >> 6;
+					value = mmd;
+					MdioTransaction(port, true, PHY_REG_MMD_CTRL, value, issue);
+					value = arg;
+					MdioTransaction(port, true, PHY_REG_MMD_DATA, value, issue);
+					value = (mode << 14) | mmd;
+					done = MdioTransaction(port, true, PHY_REG_MMD_CTRL, value, issue);
+				}
+				break;
+
+			case 3:
+				{
+					int n = arg & 0xff;
+					if(n == 0)
+						n = 1;
+					for(int i=0; i<n; i++)
+					{
+						done = MdioTransaction(port, false, PHY_REG_MMD_DATA, value, issue);
+						m_queueResults.push_back(value);
+					}
+				}
+				break;
+		}
+
+		m_queueDoneTimes.push_back(done);
+
+		//The queue goes through the host MDIO path, so it sets the done flags too
+		m_hostBusy[port] = true;
+		m_hostPendingRead[port] = false;
+		if(done > m_hostDoneTime[port])
+			m_hostDoneTime[port] = done;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Link state and interrupts
+
+void SimFPGA::SetLink(int port, bool up, int speed)
+{
+	m_phys[port].SetLink(up, speed);
+	if(GetLinkState() != m_linkStateLastRead)
+		m_irqLink = true;
+}
+
+/**
+	@brief Receives a burst of identical frames on a tap port, as RmonCounters would count them
+
+	@param len	Frame length without preamble or FCS
+ */
+void SimFPGA::AddTraffic(int port, uint32_t frames, uint32_t len, SimFrameType type)
+{
+	if( (port >= RMON_PORTS) || !m_rstn[port] || !m_phys[port].IsLinkUp() )
+		return;
+
+	auto counters = m_rmon[port];
+	if(type == SIM_FRAME_BAD_FCS)
+	{
+		counters[RMON_DROPS] += frames;
+		return;
+	}
+
+	if( (len < 60) || (len > 1518) )
+		counters[RMON_ERRORS] += frames;
+	else
+	{
+		counters[RMON_FRAMES] += frames;
+		counters[RMON_BYTES] += static_cast<uint64_t>(frames) * len;
+		if(type == SIM_FRAME_BROADCAST)
+			counters[RMON_BROADCAST] += frames;
+		else if(type == SIM_FRAME_MULTICAST)
+			counters[RMON_MULTICAST] += frames;
+	}
+	m_histogram[port][GetSizeBin(len)] += frames;
+
+	//Monitor copies are filtered, sampled, truncated (simulated frames have no IP headers, so only the length limit
+	//applies, and FILTER_TRUNCATE does nothing), grow by the trailer and direction tag, and both go out mona when
+	//aggregated
+	uint32_t monFrames = 0;
+	if(RunFilter(port, frames, type) != FILTER_DROP)
+		monFrames = RunSampler(port, frames);
+
+	uint32_t monLen = len;
+	if(m_snaplen[port])
+	{
+		uint32_t snaplen = (m_snaplen[port] < 60) ? 60 : m_snaplen[port];
+		if(monLen > snaplen)
+			monLen = snaplen;
+	}
+	if(m_snapTrailer[port])
+		monLen += 2;
+	if(m_timestamp)
+		monLen += 8;
+	if(m_monTagMode == MON_TAG_VLAN)
+		monLen += 4;
+	else if(m_monTagMode == MON_TAG_TRAILER)
+		monLen ++;
+
+	if(port == 0)
+	{
+		AddPathTraffic(PATH_A_TO_B, 0, 1, frames, len);
+		if(monFrames)
+			AddPathTraffic(PATH_A_TO_MON, 0, 2, monFrames, monLen);
+	}
+	else
+	{
+		AddPathTraffic(PATH_B_TO_A, 1, 0, frames, len);
+		if(monFrames)
+			AddPathTraffic(PATH_B_TO_MON, 1, m_monAggregate ? 2 : 3, monFrames, monLen);
+	}
+}
+
+/**
+	@brief Histogram bin of a frame, as RmonCounters would pick it
+
+	@param len	Frame length without preamble or FCS
+ */
+rmonbin_t SimFPGA::GetSizeBin(uint32_t len)
+{
+	if( (len < 60) || (len > 1518) )
+		return RMON_BIN_BAD_LEN;
+
+	uint32_t wireLen = len + 4;
+	if(wireLen == 64)
+		return RMON_BIN_64;
+	else if(wireLen < 128)
+		return RMON_BIN_65_127;
+	else if(wireLen < 256)
+		return RMON_BIN_128_255;
+	else if(wireLen < 512)
+		return RMON_BIN_256_511;
+	else if(wireLen < 1024)
+		return RMON_BIN_512_1023;
+	else if(wireLen < 1519)
+		return RMON_BIN_1024_1518;
+	else
+		return RMON_BIN_1519_MAX;
+}
+
+/**
+	@brief Checks a burst against the monitor filter rules, as MonitorFilter would, and counts the hits
+
+	@return Action taken on every frame of the burst
+ */
+filteraction_t SimFPGA::RunFilter(int port, uint32_t frames, SimFrameType type)
+{
+	//Locally administered unicast addresses, all else zero (no VLAN tag, not IP)
+	uint8_t key[FILTER_KEY_SIZE] = {0};
+	static const uint8_t unicast[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	static const uint8_t broadcast[6] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	static const uint8_t multicast[6] = { 0x01, 0x00, 0x5e, 0x00, 0x00, 0x01 };
+	if(type == SIM_FRAME_BROADCAST)
+		memcpy(key, broadcast, 6);
+	else if(type == SIM_FRAME_MULTICAST)
+		memcpy(key, multicast, 6);
+	else
+		memcpy(key, unicast, 6);
+	memcpy(key + 6, unicast, 6);
+	key[11] = 0x02 + port;
+
+	for(int i=0; i<FILTER_RULES; i++)
+	{
+		if(m_filterAction[i] == FILTER_OFF)
+			continue;
+
+		bool match = true;
+		for(int j=0; j<FILTER_KEY_SIZE; j++)
+		{
+			if( (key[j] ^ m_filterValue[i][j]) & m_filterMask[i][j])
+				match = false;
+		}
+
+		if(match)
+		{
+			m_filterHits[port][i] += frames;
+			return m_filterAction[i];
+		}
+	}
+
+	return m_filterDefault;
+}
+
+/**
+	@brief Thins out a burst the filter let through, as MonitorSampler would
+
+	Simulated frames have no flow, so SAMPLE_FLOW falls back to SAMPLE_RANDOM like the FPGA does, and both of those
+	are modeled as SAMPLE_COUNT (same long term rate, reproducible output).
+
+	@return Number of frames kept
+ */
+uint32_t SimFPGA::RunSampler(int port, uint32_t frames)
+{
+	uint32_t kept = frames;
+	uint32_t rate = m_sampleRate[port];
+	if( (m_sampleMode[port] != SAMPLE_OFF) && (rate > 1) )
+	{
+		//Frames are kept when the counter is zero, before it increments
+		uint64_t count = m_sampleCount[port];
+		kept = (count + frames + rate - 1) / rate - (count + rate - 1) / rate;
+		m_sampleCount[port] = (count + frames) % rate;
+	}
+
+	m_sampleStats[port].kept += kept;
+	m_sampleStats[port].skipped += frames - kept;
+	return kept;
+}
+
+/**
+	@brief Link speed of a port in Mbps, or zero if it's down
+ */
+int SimFPGA::GetLinkMbps(int port)
+{
+	if(!m_rstn[port] || !m_phys[port].IsLinkUp())
+		return 0;
+
+	static const int speeds[] = {10, 100, 1000};
+	return speeds[m_phys[port].GetSpeed() % 3];
+}
+
+/**
+	@brief Pushes a line rate burst through one path's FIFO, and drops whatever the output port can't keep up with
+ */
+void SimFPGA::AddPathTraffic(int path, int src, int dst, uint32_t frames, uint32_t len)
+{
+	auto& stats = m_paths[path];
+	int srcMbps = GetLinkMbps(src);
+	int dstMbps = GetLinkMbps(dst);
+
+	uint32_t sent = frames;
+	if(dstMbps == 0)
+		sent = 0;
+	else if(dstMbps < srcMbps)
+		sent = static_cast<uint64_t>(frames) * dstMbps / srcMbps;
+
+	//Once we're dropping, the FIFO is as full as it gets: completely on the tapped paths, and as full as admission
+	//control lets it get on the monitor paths
+	uint16_t occupancy = len;
+	if(sent < frames)
+	{
+		stats.dropFrames += frames - sent;
+		stats.dropBytes += static_cast<uint64_t>(frames - sent) * len;
+		if(path < PATH_A_TO_MON)
+			occupancy = stats.fifoSize;
+		else
+			occupancy = stats.fifoSize - 1536 + ((len < 1536) ? len : 1536);
+	}
+	if(occupancy > stats.highWater)
+		stats.highWater = occupancy;
+}
+
+uint16_t SimFPGA::GetLinkState()
+{
+	uint16_t state = 0;
+	for(int i=0; i<4; i++)
+	{
+		auto& phy = m_phys[i];
+		if(m_rstn[i] && phy.IsLinkUp())
+			state |= (0x8 | phy.GetSpeed()) << (i*4);
+	}
+	return state;
+}
+
+bool SimFPGA::GetIRQ()
+{
+	Update();
+	return (m_irqLink && (m_irqEnable & IRQ_LINK_STATE)) || (m_irqMdio && (m_irqEnable & IRQ_MDIO_DONE));
+}
+
+/**
+	@brief Current values of every shadowed register
+ */
+void SimFPGA::ReadShadow(uint16_t shadow[4][8])
+{
+	for(int port=0; port<4; port++)
+	{
+		for(int i=0; i<8; i++)
+		{
+			if( (m_pollPorts & (1 << port)) && (i < m_pollCount) && m_rstn[port])
+				shadow[port][i] = m_phys[port].Peek(m_pollRegs[i]);
+			else
+				shadow[port][i] = 0;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Register access
+
+void SimFPGA::Write(uint16_t insn, const uint8_t* data, uint32_t len)
+{
+	Update();
+	if(len == 0)
+		return;
+
+	int port = (insn / REG_ETH_OFFSET) - 1;
+	switch(insn)
+	{
+		case REG_TRIG_MUX:
+			m_trigMux = data[0];
+			break;
+
+		case REG_IRQ_ENABLE:
+			m_irqEnable = data[0] & 7;
+			break;
+
+		case REG_MDIO_BATCH:
+			RunBatch(data, len);
+			break;
+
+		case REG_STATS_SNAPSHOT:
+			memcpy(m_rmonSnapshot, m_rmon, sizeof(m_rmon));
+			memcpy(m_histogramSnapshot, m_histogram, sizeof(m_histogram));
+			memcpy(m_pathsSnapshot, m_paths, sizeof(m_paths));
+			memcpy(m_filterHitsSnapshot, m_filterHits, sizeof(m_filterHits));
+			memcpy(m_sampleStatsSnapshot, m_sampleStats, sizeof(m_sampleStats));
+			break;
+
+		case REG_MONITOR_CFG:
+			m_monAggregate = (data[0] & 1);
+			m_monTagMode = (data[0] >> 1) & 3;
+			m_timestamp = (data[0] & 8) != 0;
+			m_filterDefault = static_cast<filteraction_t>((data[0] >> 4) & 3);
+			break;
+
+		//Rows land as they complete, the action once all three have
+		case REG_FILTER_RULE:
+			if(len >= 2)
+			{
+				int rule = data[0] & 0xf;
+				if( (data[1] & 3) == FILTER_OFF)
+					m_filterAction[rule] = FILTER_OFF;
+
+				for(uint32_t row=0; (row < 3) && (2 + (row+1)*36 <= len); row++)
+				{
+					memcpy(m_filterValue[rule] + row*18, data + 2 + row*36, 18);
+					memcpy(m_filterMask[rule] + row*18, data + 2 + row*36 + 18, 18);
+				}
+
+				if(len >= 110)
+					m_filterAction[rule] = static_cast<filteraction_t>(data[1] & 3);
+			}
+			break;
+
+		case REG_TIMESTAMP_SET:
+			if(len >= 8)
+			{
+				m_timestampBase = 0;
+				for(int i=7; i>=0; i--)
+					m_timestampBase = (m_timestampBase << 8) | data[i];
+				m_timestampLoadTime = SimGetTime();
+			}
+			break;
+
+		case REG_MONITOR_SAMPLE:
+			for(uint32_t i=0; (i < 2) && (i*8 + 3 < len); i++)
+			{
+				m_sampleMode[i] = static_cast<samplemode_t>(data[i*8] & 3);
+				m_sampleRate[i] = data[i*8 + 1] | (data[i*8 + 2] << 8) | (data[i*8 + 3] << 16);
+				m_sampleCount[i] = 0;
+			}
+			break;
+
+		case REG_MONITOR_SNAPLEN:
+			for(uint32_t i=0; (i < 2) && (i*3 + 2 < len); i++)
+			{
+				m_snaplen[i] = data[i*3] | (data[i*3 + 1] << 8);
+				m_snapTrailer[i] = (data[i*3 + 2] & 2) != 0;
+			}
+			break;
+
+		case REG_STATS_CLEAR:
+			for(int i=0; i<RMON_PORTS; i++)
+			{
+				if(data[0] & (1 << i))
+				{
+					memset(m_rmon[i], 0, sizeof(m_rmon[i]));
+					memset(m_histogram[i], 0, sizeof(m_histogram[i]));
+				}
+			}
+			for(int i=0; i<PATH_COUNT; i++)
+			{
+				if(data[0] & (4 << i))
+					m_paths[i] = {0, 0, 0, g_pathFifoSize};
+			}
+			if(data[0] & 0x40)
+				memset(m_filterHits, 0, sizeof(m_filterHits));
+			if(data[0] & 0x80)
+				memset(m_sampleStats, 0, sizeof(m_sampleStats));
+			break;
+
+		case REG_MDIO_RD_ALL:
+			for(int i=0; i<4; i++)
+				HostTransaction(i, false, data[0] & 0x1f, 0);
+			break;
+
+		case REG_MDIO_WR_ALL:
+			if(len >= 3)
+			{
+				for(int i=0; i<4; i++)
+					HostTransaction(i, true, data[0] & 0x1f, data[1] | (data[2] << 8));
+			}
+			break;
+
+		case REG_MDIO_POLL_CFG:
+			m_pollPorts = data[0] & 0xf;
+			if(len > 1)
+				m_pollCount = (data[1] > 8) ? 8 : data[1];
+			for(uint32_t i=2; (i < len) && (i < 10); i++)
+				m_pollRegs[i-2] = data[i] & 0x1f;
+			ReadShadow(m_shadowLast);
+			break;
+
+		case REG_ETH0_RST:
+		case REG_ETH1_RST:
+		case REG_ETH2_RST:
+		case REG_ETH3_RST:
+			{
+				bool rstn = (data[0] & 1);
+				if(!rstn)
+					m_phys[port].Reset();
+				m_rstn[port] = rstn;
+				if(GetLinkState() != m_linkStateLastRead)
+					m_irqLink = true;
+			}
+			break;
+
+		case REG_ETH0_MDIO_RADDR:
+		case REG_ETH1_MDIO_RADDR:
+		case REG_ETH2_MDIO_RADDR:
+		case REG_ETH3_MDIO_RADDR:
+			HostTransaction(port, false, data[0] & 0x1f, 0);
+			break;
+
+		case REG_ETH0_MDIO_WR:
+		case REG_ETH1_MDIO_WR:
+		case REG_ETH2_MDIO_WR:
+		case REG_ETH3_MDIO_WR:
+			if(len >= 3)
+				HostTransaction(port, true, data[0] & 0x1f, data[1] | (data[2] << 8));
+			break;
+
+		case REG_ETH0_MDIO_CFG:
+		case REG_ETH1_MDIO_CFG:
+		case REG_ETH2_MDIO_CFG:
+		case REG_ETH3_MDIO_CFG:
+			m_clkdiv[port] = data[0];
+			if(len > 1)
+				m_preambleSuppress[port] = data[1] & 1;
+			break;
+
+		default:
+			break;
+	}
+}
+
+void SimFPGA::Read(uint16_t insn, uint8_t* data, uint32_t len)
+{
+	Update();
+	memset(data, 0, len);
+	if(len == 0)
+		return;
+
+	uint64_t now = SimGetTime();
+	int port = (insn / REG_ETH_OFFSET) - 1;
+	switch(insn)
+	{
+		case REG_FPGA_IDCODE:
+			{
+				static const uint8_t idcode[4] = { 0x03, 0x62, 0x00, 0x93 };
+				for(uint32_t i=0; i<len; i++)
+					data[i] = idcode[i % 4];
+			}
+			break;
+
+		case REG_FPGA_SERIAL:
+			for(uint32_t i=0; i<len; i++)
+				data[i] = 0x50 + (i % 8);
+			break;
+
+		case REG_TIMESTAMP:
+			{
+				//Counter advances in 8 ns steps
+				uint64_t ns = m_timestampBase + ((now - m_timestampLoadTime) & ~7ULL);
+				for(uint32_t i=0; (i < len) && (i < 8); i++)
+					data[i] = (ns >> (i*8)) & 0xff;
+			}
+			break;
+
+		case REG_LINK_STATE:
+			{
+				uint16_t state = GetLinkState();
+				data[0] = state & 0xff;
+				if(len > 1)
+				{
+					data[1] = state >> 8;
+					m_irqLink = false;
+					m_linkStateLastRead = state;
+				}
+			}
+			break;
+
+		case REG_MDIO_BATCH_STAT:
+			{
+				uint8_t done = 0;
+				bool active = false;
+				for(auto t : m_queueDoneTimes)
+				{
+					if(t <= now)
+						done ++;
+					else
+						active = true;
+				}
+				data[0] = done;
+				if(len > 1)
+					data[1] = active ? 1 : 0;
+			}
+			break;
+
+		case REG_MDIO_BATCH_RD:
+			for(uint32_t i=0; i<len; i++)
+			{
+				size_t n = i/2;
+				uint16_t value = (n < m_queueResults.size()) ? m_queueResults[n] : 0;
+				data[i] = (i & 1) ? (value >> 8) : (value & 0xff);
+			}
+			break;
+
+		case REG_MDIO_RDATA_ALL:
+			for(uint32_t i=0; (i < len) && (i < 8); i++)
+			{
+				uint16_t value = m_hostRdData[i/2];
+				data[i] = (i & 1) ? (value >> 8) : (value & 0xff);
+			}
+			break;
+
+		case REG_MDIO_STATUS:
+			{
+				uint8_t busy = 0;
+				for(int i=0; i<4; i++)
+				{
+					if(m_hostBusy[i])
+						busy |= (1 << i);
+				}
+				data[0] = (m_mdioDone << 4) | busy;
+				m_mdioDone = 0;
+				m_irqMdio = false;
+			}
+			break;
+
+		case REG_IRQ_STATUS:
+			data[0] = (m_irqMdio ? IRQ_MDIO_DONE : 0) | (m_irqLink ? IRQ_LINK_STATE : 0);
+			break;
+
+		case REG_MDIO_SHADOW:
+			{
+				uint16_t shadow[4][8];
+				ReadShadow(shadow);
+				for(uint32_t i=0; (i < len) && (i < 64); i++)
+				{
+					uint16_t value = shadow[i/16][(i/2) % 8];
+					data[i] = (i & 1) ? (value >> 8) : (value & 0xff);
+				}
+			}
+			break;
+
+		case REG_MDIO_SHADOW_CHANGED:
+			{
+				uint16_t shadow[4][8];
+				ReadShadow(shadow);
+				uint8_t changed = 0;
+				for(int p=0; p<4; p++)
+				{
+					if(memcmp(shadow[p], m_shadowLast[p], sizeof(shadow[p])) != 0)
+						changed |= (1 << p);
+				}
+				memcpy(m_shadowLast, shadow, sizeof(shadow));
+				data[0] = changed;
+			}
+			break;
+
+		//Status byte (always complete), then the snapshot bank
+		case REG_RMON_COUNTERS:
+			for(uint32_t i=1; (i < len) && (i <= RMON_PORTS*RMON_SLOTS*8); i++)
+			{
+				uint32_t slot = ((i-1) / 8) % RMON_SLOTS;
+				if(slot < RMON_COUNT)
+					data[i] = m_rmonSnapshot[(i-1) / (RMON_SLOTS*8)][slot] >> (8 * ((i-1) % 8));
+			}
+			break;
+
+		case REG_RMON_HISTOGRAM:
+			for(uint32_t i=1; (i < len) && (i <= RMON_PORTS*RMON_SLOTS*8); i++)
+				data[i] = m_histogramSnapshot[(i-1) / (RMON_SLOTS*8)][((i-1) / 8) % RMON_SLOTS] >> (8 * ((i-1) % 8));
+			break;
+
+		case REG_PATH_STATS:
+			for(uint32_t i=1; (i < len) && (i <= PATH_COUNT*PATH_STATS_SIZE); i++)
+			{
+				auto& stats = m_pathsSnapshot[(i-1) / PATH_STATS_SIZE];
+				uint32_t off = (i-1) % PATH_STATS_SIZE;
+				if(off < 8)
+					data[i] = stats.dropFrames >> (8 * off);
+				else if(off < 16)
+					data[i] = stats.dropBytes >> (8 * (off - 8));
+				else if(off < 18)
+					data[i] = stats.highWater >> (8 * (off - 16));
+				else if(off < 20)
+					data[i] = stats.fifoSize >> (8 * (off - 18));
+			}
+			break;
+
+		case REG_FILTER_HITS:
+			for(uint32_t i=1; (i < len) && (i <= 2*FILTER_RULES*4); i++)
+				data[i] = m_filterHitsSnapshot[(i-1) / (FILTER_RULES*4)][((i-1) / 4) % FILTER_RULES] >> (8 * ((i-1) % 4));
+			break;
+
+		case REG_SAMPLE_STATS:
+			for(uint32_t i=1; (i < len) && (i <= 32); i++)
+			{
+				auto& stats = m_sampleStatsSnapshot[(i-1) / 16];
+				uint32_t off = (i-1) % 16;
+				if(off < 8)
+					data[i] = stats.kept >> (8 * off);
+				else
+					data[i] = stats.skipped >> (8 * (off - 8));
+			}
+			break;
+
+		case REG_ETH0_MDIO_RDATA:
+		case REG_ETH1_MDIO_RDATA:
+		case REG_ETH2_MDIO_RDATA:
+		case REG_ETH3_MDIO_RDATA:
+			data[0] = m_hostRdData[port] & 0xff;
+			if(len > 1)
+				data[1] = m_hostRdData[port] >> 8;
+			break;
+
+		default:
+			break;
+	}
+}
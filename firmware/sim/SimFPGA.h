@@ -0,0 +1,185 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SimFPGA
+ */
+#ifndef SimFPGA_h
+#define SimFPGA_h
+
+#include <stdint.h>
+#include <vector>
+#include "SimPHY.h"
+#include "../RmonCounters.h"
+#include "../PathStats.h"
+#include "../FilterRules.h"
+
+uint64_t SimGetTime();
+void SimAdvance(uint64_t ns);
+
+/**
+	@brief Transaction counters, for the benchmark driver
+ */
+struct SimStats
+{
+	uint64_t	qspiTransactions;
+	uint64_t	qspiBytes;
+	uint64_t	mdioTransactions[4];
+
+	uint64_t GetMdioTotal() const
+	{ return mdioTransactions[0] + mdioTransactions[1] + mdioTransactions[2] + mdioTransactions[3]; }
+};
+
+/**
+	@brief Kinds of frame the traffic model can receive
+ */
+enum SimFrameType
+{
+	SIM_FRAME_UNICAST,
+	SIM_FRAME_BROADCAST,
+	SIM_FRAME_MULTICAST,
+	SIM_FRAME_BAD_FCS
+};
+
+/**
+	@brief Model of the MicrocontrollerInterface register map and the four MDIO buses behind it
+
+	Timing follows the RTL: MDIO transactions take 64 MDC cycles (33 with preamble suppression) plus a 15 cycle gap,
+	at the configured clock divider, and each bus runs one transaction at a time. Host transactions and command
+	queue batches complete asynchronously and are polled through the same status registers as on hardware.
+
+	The background register poller is not timed. Shadow registers always reflect the current PHY state.
+
+	There is no packet datapath, just RMON counters and path statistics fed by AddTraffic(). Each burst is assumed
+	to arrive at line rate, so a path to a slower (or down) port drops the excess. Snapshots complete immediately.
+	Monitor filter rules see only the MAC addresses, since simulated frames have no higher layer headers.
+ */
+class SimFPGA
+{
+public:
+	SimFPGA();
+
+	void Write(uint16_t insn, const uint8_t* data, uint32_t len);
+	void Read(uint16_t insn, uint8_t* data, uint32_t len);
+
+	bool GetIRQ();
+	void SetLink(int port, bool up, int speed);
+	void AddTraffic(int port, uint32_t frames, uint32_t len, SimFrameType type);
+
+	SimPHY m_phys[4];
+	SimStats m_stats;
+
+protected:
+	void Update();
+
+	uint64_t GetMdioDuration(int port);
+	uint64_t MdioTransaction(int port, bool write, uint8_t regid, uint16_t& value, uint64_t earliest);
+	void HostTransaction(int port, bool write, uint8_t regid, uint16_t value);
+	void RunBatch(const uint8_t* data, uint32_t len);
+	void ReadShadow(uint16_t shadow[4][8]);
+	uint16_t GetLinkState();
+	int GetLinkMbps(int port);
+	void AddPathTraffic(int path, int src, int dst, uint32_t frames, uint32_t len);
+	static rmonbin_t GetSizeBin(uint32_t len);
+	filteraction_t RunFilter(int port, uint32_t frames, SimFrameType type);
+	uint32_t RunSampler(int port, uint32_t frames);
+
+	//MDIO bus configuration
+	uint8_t		m_clkdiv[4];
+	bool		m_preambleSuppress[4];
+	bool		m_rstn[4];
+
+	//Bus occupancy
+	uint64_t	m_busFree[4];
+
+	//Single host transactions
+	bool		m_hostBusy[4];
+	uint64_t	m_hostDoneTime[4];
+	uint16_t	m_hostRdData[4];
+	uint16_t	m_hostPendingData[4];
+	bool		m_hostPendingRead[4];
+	uint8_t		m_mdioDone;
+
+	//Command queue
+	std::vector<uint64_t>	m_queueDoneTimes;
+	std::vector<uint16_t>	m_queueResults;
+
+	//Interrupts
+	uint16_t	m_linkStateLastRead;
+	bool		m_irqLink;
+	bool		m_irqMdio;
+	uint8_t		m_irqEnable;
+
+	//Background poller
+	uint8_t		m_pollPorts;
+	uint8_t		m_pollCount;
+	uint8_t		m_pollRegs[8];
+	uint16_t	m_shadowLast[4][8];
+
+	//Traffic statistics for the two tap ports
+	uint64_t	m_rmon[RMON_PORTS][RMON_COUNT];
+	uint64_t	m_rmonSnapshot[RMON_PORTS][RMON_COUNT];
+	uint64_t	m_histogram[RMON_PORTS][RMON_BIN_COUNT];
+	uint64_t	m_histogramSnapshot[RMON_PORTS][RMON_BIN_COUNT];
+	PathStats	m_paths[PATH_COUNT];
+	PathStats	m_pathsSnapshot[PATH_COUNT];
+
+	//Monitor path config
+	bool		m_monAggregate;
+	uint8_t		m_monTagMode;
+	uint16_t	m_snaplen[2];
+	bool		m_snapTrailer[2];
+	bool		m_timestamp;
+
+	//Monitor filter, rows in REG_FILTER_RULE format
+	filteraction_t	m_filterDefault;
+	filteraction_t	m_filterAction[FILTER_RULES];
+	uint8_t		m_filterValue[FILTER_RULES][FILTER_KEY_SIZE];
+	uint8_t		m_filterMask[FILTER_RULES][FILTER_KEY_SIZE];
+	uint32_t	m_filterHits[2][FILTER_RULES];
+	uint32_t	m_filterHitsSnapshot[2][FILTER_RULES];
+
+	//Monitor sampler
+	samplemode_t	m_sampleMode[2];
+	uint32_t	m_sampleRate[2];
+	uint32_t	m_sampleCount[2];
+	SampleStats	m_sampleStats[2];
+	SampleStats	m_sampleStatsSnapshot[2];
+
+	//Timestamp counter is the loaded value plus simulated time since the load
+	uint64_t	m_timestampBase;
+	uint64_t	m_timestampLoadTime;
+
+	uint8_t		m_trigMux;
+};
+
+extern SimFPGA g_simFPGA;
+
+#endif
@@ -0,0 +1,216 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "SimFPGA.h"
+#include "SimPHY.h"
+
+//LinkMD takes a while in real life, make the firmware poll for it
+static const uint64_t g_linkmdDurationNs = 2000000;
+
+SimPHY::SimPHY()
+	: m_maxMdcRate(12500000)
+	, m_preambleSuppressOK(true)
+	, m_linkUp(false)
+	, m_speed(2)
+	, m_linkmdDoneTime(0)
+{
+	Reset();
+}
+
+/**
+	@brief Puts every register back to its power-on default
+ */
+void SimPHY::Reset()
+{
+	for(int i=0; i<32; i++)
+		m_regs[i] = 0;
+
+	m_regs[0x00] = 0x1140;		//AN enabled, full duplex, 1000 Mbps
+	m_regs[0x02] = 0x0022;		//ID1
+	m_regs[0x03] = 0x1622;		//ID2 (KSZ9031RNX rev 2)
+	m_regs[0x04] = 0x01e1;		//advertise 10/100 half/full
+	m_regs[0x09] = 0x0300;		//advertise 1000 full/half
+	m_regs[0x1c] = 0x0040;		//auto MDI-X
+
+	m_mmdCtrl = 0;
+	for(int i=0; i<32; i++)
+		m_mmdAddr[i] = 0;
+	m_mmd.clear();
+
+	//MMD 0 AN FLP burst timing defaults (8ms)
+	m_mmd[0x00003] = 0x1a80;
+	m_mmd[0x00004] = 0x0003;
+
+	m_linkmdDoneTime = 0;
+	UpdateStatus();
+}
+
+/**
+	@brief Changes the state of the (imaginary) link partner
+
+	@param up		True if link is up
+	@param speed	0 = 10, 1 = 100, 2 = 1000 Mbps
+ */
+void SimPHY::SetLink(bool up, int speed)
+{
+	m_linkUp = up;
+	m_speed = speed;
+	UpdateStatus();
+}
+
+/**
+	@brief Recomputes the read-only status registers from the link state
+ */
+void SimPHY::UpdateStatus()
+{
+	uint16_t status = 0x7909;		//10/100 half/full capable, extended status, extended capability
+	if(m_linkUp)
+		status |= 0x0024;			//link up, AN complete
+	m_regs[0x01] = status;
+
+	m_regs[0x05] = m_linkUp ? 0xc5e1 : 0;
+	m_regs[0x0a] = (m_linkUp && (m_speed == 2)) ? 0x3c00 : 0;
+
+	uint16_t ctrl = m_regs[0x1f] & 0xff87;
+	if(m_linkUp)
+	{
+		ctrl |= 0x0008;				//full duplex
+		ctrl |= (0x10 << m_speed);	//10 / 100 / 1000 status bits
+	}
+	m_regs[0x1f] = ctrl;
+}
+
+/**
+	@brief Reads a register without any side effects (for the background poller model)
+ */
+uint16_t SimPHY::Peek(uint8_t regid)
+{
+	regid &= 0x1f;
+	return m_regs[regid];
+}
+
+uint16_t SimPHY::Read(uint8_t regid)
+{
+	regid &= 0x1f;
+	switch(regid)
+	{
+		case 0x0e:
+			return MmdAccess(false, 0);
+
+		//LinkMD: busy until the test has had time to run, then report a normal cable
+		case 0x12:
+			if( (m_regs[0x12] & 0x8000) && (SimGetTime() >= m_linkmdDoneTime) )
+				m_regs[0x12] &= 0x3000;
+			return m_regs[0x12];
+
+		default:
+			return m_regs[regid];
+	}
+}
+
+void SimPHY::Write(uint8_t regid, uint16_t value)
+{
+	regid &= 0x1f;
+	switch(regid)
+	{
+		//Read only
+		case 0x01:
+		case 0x02:
+		case 0x03:
+		case 0x05:
+		case 0x0a:
+			break;
+
+		case 0x00:
+			if(value & 0x8000)
+			{
+				Reset();
+				return;
+			}
+			m_regs[0] = value & ~0x0200;	//restart AN is self clearing
+			break;
+
+		case 0x0d:
+			m_mmdCtrl = value;
+			break;
+
+		case 0x0e:
+			MmdAccess(true, value);
+			break;
+
+		case 0x12:
+			m_regs[0x12] = value;
+			if(value & 0x8000)
+				m_linkmdDoneTime = SimGetTime() + g_linkmdDurationNs;
+			break;
+
+		//Status bits in the PHY control register are read only
+		case 0x1f:
+			m_regs[0x1f] = (value & 0xff87) | (m_regs[0x1f] & 0x0078);
+			break;
+
+		default:
+			m_regs[regid] = value;
+			break;
+	}
+}
+
+/**
+	@brief Handles a read or write of the MMD data register
+ */
+uint16_t SimPHY::MmdAccess(bool write, uint16_t value)
+{
+	int mode = m_mmdCtrl >> 14;
+	int mmd = m_mmdCtrl & 0x1f;
+
+	//Mode 0 accesses the address register
+	if(mode == 0)
+	{
+		if(write)
+			m_mmdAddr[mmd] = value;
+		return m_mmdAddr[mmd];
+	}
+
+	uint32_t key = (mmd << 16) | m_mmdAddr[mmd];
+	uint16_t ret = 0;
+	if(write)
+		m_mmd[key] = value;
+	else
+	{
+		auto it = m_mmd.find(key);
+		if(it != m_mmd.end())
+			ret = it->second;
+	}
+
+	//Post increment on read/write (mode 2), or on write only (mode 3)
+	if( (mode == 2) || ( (mode == 3) && write) )
+		m_mmdAddr[mmd] ++;
+
+	return ret;
+}
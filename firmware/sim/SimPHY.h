@@ -0,0 +1,88 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SimPHY
+ */
+#ifndef SimPHY_h
+#define SimPHY_h
+
+#include <stdint.h>
+#include <map>
+
+/**
+	@brief Register level model of a KSZ9031RNX
+
+	Covers what the firmware uses: the IEEE registers, MMD indirect access with all of the post-increment modes,
+	software reset, LinkMD cable diagnostics and link status. There is no actual Ethernet, link state is set by the
+	simulation.
+ */
+class SimPHY
+{
+public:
+	SimPHY();
+
+	void Reset();
+
+	uint16_t Read(uint8_t regid);
+	uint16_t Peek(uint8_t regid);
+	void Write(uint8_t regid, uint16_t value);
+
+	void SetLink(bool up, int speed);
+
+	bool IsLinkUp() const
+	{ return m_linkUp; }
+
+	int GetSpeed() const
+	{ return m_speed; }
+
+	///@brief Fastest MDC this PHY reads back reliably at, in Hz
+	uint32_t m_maxMdcRate;
+
+	///@brief Whether this PHY accepts frames without the 32-bit preamble
+	bool m_preambleSuppressOK;
+
+protected:
+	uint16_t MmdAccess(bool write, uint16_t value);
+	void UpdateStatus();
+
+	uint16_t m_regs[32];
+
+	uint16_t m_mmdCtrl;
+	uint16_t m_mmdAddr[32];
+	std::map<uint32_t, uint16_t> m_mmd;
+
+	bool m_linkUp;
+	int m_speed;
+
+	uint64_t m_linkmdDoneTime;
+};
+
+#endif
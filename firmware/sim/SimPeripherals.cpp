@@ -0,0 +1,333 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stm32.h>
+#include <peripheral/Flash.h>
+#include <peripheral/GPIO.h>
+#include <peripheral/OctoSPI.h>
+#include <peripheral/Power.h>
+#include <peripheral/RCC.h>
+#include <peripheral/Timer.h>
+#include <peripheral/UART.h>
+#include <util/Logger.h>
+#include <cli/UARTOutputStream.h>
+#include "../CpuIntrinsics.h"
+#include "../ethernet-tap.h"
+#include "SimFPGA.h"
+
+//Where simulated console output goes (nullptr to discard it)
+FILE* g_simConsole = nullptr;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Peripheral registers
+
+//STM32H735 rev Z
+volatile dbgmcu_t DBGMCU = { 0x10016483 };
+volatile syscfg_t SYSCFG = { {0, 0, 0, 0}, 10 };
+volatile scb_t SCB = { 0 };
+volatile usart_t UART4 = { 0, 0, 0, 0, USART_ISR_TXE, 0, {} };
+volatile tim_t TIM2 = { 0 };
+volatile octospi_t OCTOSPI1 = { 0 };
+volatile gpio_t GPIOA = { 0, 0 };
+volatile gpio_t GPIOB = { 0, 0 };
+volatile gpio_t GPIOC = { 0, 0 };
+volatile gpio_t GPIOD = { 0, 0 };
+volatile gpio_t GPIOE = { 0, 0 };
+volatile gpio_t GPIOF = { 0, 0 };
+volatile gpio_t GPIOG = { 0, 0 };
+volatile gpio_t GPIOH = { 0, 0 };
+
+//"H735", 1024 kB flash, made up die ID
+uint32_t L_ID = 0x48373335;
+uint32_t F_ID = 1024;
+uint32_t U_ID[3] = { 0x00100020, 0x53494d07, 0x554c4154 };
+
+uint8_t g_simData;
+uint8_t g_simDataRom;
+
+void EnableInterrupts()
+{
+}
+
+void DisableInterrupts()
+{
+}
+
+void SimUartTDR::operator=(uint32_t ch) volatile
+{
+	if(g_simConsole)
+		fputc(ch, g_simConsole);
+}
+
+uint32_t GetCycleCount()
+{
+	return (SimGetTime() * (g_clockProfile->sysclkHz / 1000000)) / 1000;
+}
+
+bool SimGPIORead(volatile gpio_t* gpio, uint8_t pin)
+{
+	//PE12 is the FPGA IRQ, nothing else is an input we care about
+	if( (gpio == &GPIOE) && (pin == 12) )
+		return g_simFPGA.GetIRQ();
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Clocks and power (nothing to do)
+
+void Flash::SetConfiguration(int mhz, vos_t range)
+{
+	(void)mhz;
+	(void)range;
+}
+
+void Power::ConfigureSMPSToLDOCascade(voltage_t vcore, vos_t range)
+{
+	(void)vcore;
+	(void)range;
+}
+
+void RCCHelper::EnableSyscfg()
+{
+}
+
+void RCCHelper::EnableHighSpeedInternalClock(int mhz)
+{
+	(void)mhz;
+}
+
+void RCCHelper::InitializeSystemClocks(
+	uint16_t sysclkdiv,
+	uint16_t ahbdiv,
+	uint8_t apb1div,
+	uint8_t apb2div,
+	uint8_t apb3div,
+	uint8_t apb4div)
+{
+	(void)sysclkdiv;
+	(void)ahbdiv;
+	(void)apb1div;
+	(void)apb2div;
+	(void)apb3div;
+	(void)apb4div;
+}
+
+void RCCHelper::InitializePLL(
+	uint8_t npll,
+	float in_mhz,
+	uint8_t prediv,
+	uint16_t mult,
+	uint8_t divP,
+	uint8_t divQ,
+	uint8_t divR,
+	ClockSource source)
+{
+	(void)npll;
+	(void)in_mhz;
+	(void)prediv;
+	(void)mult;
+	(void)divP;
+	(void)divQ;
+	(void)divR;
+	(void)source;
+}
+
+void RCCHelper::SelectSystemClockFromPLL1()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Timer
+
+Timer::Timer(volatile tim_t* chan, features type, uint32_t prescale)
+{
+	(void)chan;
+	(void)type;
+	(void)prescale;
+}
+
+uint32_t Timer::GetCount()
+{
+	//Reading the counter isn't free, and busy-wait loops rely on time moving forward
+	SimAdvance(50);
+	return SimGetTime() / 100000;
+}
+
+void Timer::Sleep(uint32_t ticks, bool reset)
+{
+	(void)reset;
+	SimAdvance(ticks * 100000ULL);
+}
+
+void Timer::Restart()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// UART and console output
+
+UART::UART(volatile usart_t* lane, uint32_t baud_div)
+{
+	(void)lane;
+	(void)baud_div;
+}
+
+void UART::PrintBinary(char ch)
+{
+	UART4.TDR = ch;
+}
+
+char UART::BlockingRead()
+{
+	return ' ';
+}
+
+void CharacterDevice::PrintString(const char* str)
+{
+	while(*str)
+		PrintBinary(*(str++));
+}
+
+void CharacterDevice::Printf(const char* format, ...)
+{
+	char buf[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	PrintString(buf);
+}
+
+void Logger::operator()(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	Print(NOTICE, format, args);
+	va_end(args);
+}
+
+void Logger::operator()(LogType type, const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	Print(type, format, args);
+	va_end(args);
+}
+
+void Logger::Print(LogType type, const char* format, va_list args)
+{
+	if(!m_target)
+		return;
+
+	uint32_t ticks = m_timer ? m_timer->GetCount() : 0;
+	m_target->Printf("[%6u.%04u] ", ticks / 10000, ticks % 10000);
+	for(int i=0; i<m_indentLevel; i++)
+		m_target->PrintString("    ");
+	if(type == WARNING)
+		m_target->PrintString("Warning: ");
+	else if(type == ERROR)
+		m_target->PrintString("Error: ");
+
+	char buf[512];
+	vsnprintf(buf, sizeof(buf), format, args);
+	m_target->PrintString(buf);
+}
+
+void UARTOutputStream::PutCharacter(char ch)
+{
+	m_uart->PrintBinary(ch);
+}
+
+void UARTOutputStream::PutString(const char* str)
+{
+	m_uart->PrintString(str);
+}
+
+void UARTOutputStream::Printf(const char* format, ...)
+{
+	char buf[512];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	m_uart->PrintString(buf);
+}
+
+void UARTOutputStream::Flush()
+{
+}
+
+void UARTOutputStream::Backspace()
+{
+	m_uart->PrintString("\x1b[D \x1b[D");
+}
+
+void UARTOutputStream::Clear()
+{
+	m_uart->PrintString("\x1b[2J\x1b[0;0H");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// QSPI
+
+OctoSPI::OctoSPI(volatile octospi_t* lane, uint32_t sizeBytes, uint8_t prescale)
+	: m_prescale(prescale)
+{
+	(void)lane;
+	(void)sizeBytes;
+}
+
+/**
+	@brief Advances time by one QSPI transaction: 4 instruction cycles, 1 dummy, 2 per data byte, plus overhead
+ */
+static void SimQSPITransaction(uint32_t len)
+{
+	uint64_t cycles = 4 + 1 + 2*len + 2;
+	uint64_t hz = g_clockProfile->GetQSPIClock();
+	SimAdvance( (cycles * 1000000000ULL) / hz + 200);
+
+	g_simFPGA.m_stats.qspiTransactions ++;
+	g_simFPGA.m_stats.qspiBytes += len;
+}
+
+void OctoSPI::BlockingWrite(uint32_t insn, uint32_t addr, const uint8_t* data, uint32_t len)
+{
+	(void)addr;
+	SimQSPITransaction(len);
+	g_simFPGA.Write(insn, data, len);
+}
+
+void OctoSPI::BlockingRead(uint32_t insn, uint32_t addr, uint8_t* data, uint32_t len)
+{
+	(void)addr;
+	SimQSPITransaction(len);
+	g_simFPGA.Read(insn, data, len);
+}
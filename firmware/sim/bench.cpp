@@ -0,0 +1,459 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@brief Host benchmark driver for the firmware
+
+	Boots the firmware against the simulated FPGA, then runs a script of CLI commands and reports how long each one
+	took in simulated time and how much MDIO / QSPI traffic it generated. Since the timing model is deterministic,
+	results from two builds can be compared directly to catch performance regressions.
+
+	Script syntax, one entry per line:
+		# comment
+		!link <port> <up|down> [10|100|1000]
+		!idle <ms>
+		!traffic <port> <frames> <length> [unicast|broadcast|multicast|bad]
+		anything else is typed into the CLI, followed by enter
+
+	Usage: tapsim [-v] [--profile name] [--csv results.csv] [--baseline previous.csv] script.txt
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../ethernet-tap.h"
+#include "../BackgroundJob.h"
+#include "../BufferedUART.h"
+#include "SimFPGA.h"
+
+void SelectClockProfile();
+void InitClocks();
+void InitLog();
+void InitQSPI();
+void InitFPGA();
+void InitPHYs();
+void InitCLI();
+
+extern GPIOPin* g_irq;
+extern FILE* g_simConsole;
+
+//Give up on a command if it takes longer than this
+static const uint64_t g_commandTimeoutNs = 60 * 1000000000ULL;
+
+//Scheduler tick, same as g_logTimer
+static const uint64_t g_tickNs = 100000;
+
+/**
+	@brief Results for one script line
+ */
+struct BenchResult
+{
+	std::string	command;
+	uint64_t	latencyNs;
+	uint64_t	mdio;
+	uint64_t	qspiTransactions;
+	uint64_t	qspiBytes;
+	bool		timedOut;
+};
+
+static bool g_lastIRQ = false;
+
+/**
+	@brief Runs the main loop for one tick: takes the FPGA interrupt if it fired, runs tasks, then lets time pass
+ */
+static void RunOneTick()
+{
+	bool irq = g_simFPGA.GetIRQ();
+	if(irq && !g_lastIRQ)
+	{
+		FPGAEvent ev;
+		ev.timestamp = g_logTimer->GetCount();
+		g_fpgaEvents.Push(ev);
+		SchedulerWake(g_taskTable[TASK_FPGA_IRQ]);
+	}
+	g_lastIRQ = irq;
+
+	PollIO();
+	SimAdvance(g_tickNs);
+}
+
+/**
+	@brief Returns true if the firmware has nothing left in flight
+ */
+static bool IsQuiescent()
+{
+	if(IsBackgroundJobRunning())
+		return false;
+	for(int i=0; i<4; i++)
+	{
+		if(!PhyAsyncIdle(i))
+			return false;
+	}
+	return true;
+}
+
+/**
+	@brief Types one line into the CLI and runs the firmware until it's done with it
+ */
+static BenchResult RunCommand(const std::string& line)
+{
+	BenchResult ret;
+	ret.command = line;
+	ret.timedOut = false;
+
+	SimStats before = g_simFPGA.m_stats;
+	uint64_t start = SimGetTime();
+
+	for(auto c : line)
+		g_uartCliContext.OnKeystroke(c);
+	g_uartCliContext.OnKeystroke('\r');
+
+	//Run at least one pass so anything the command woke gets a chance to start
+	do
+	{
+		RunOneTick();
+		if( (SimGetTime() - start) > g_commandTimeoutNs)
+		{
+			ret.timedOut = true;
+			break;
+		}
+	} while(!IsQuiescent());
+
+	//Don't count the idle tick we spent noticing it was done
+	ret.latencyNs = SimGetTime() - start - g_tickNs;
+	ret.mdio = g_simFPGA.m_stats.GetMdioTotal() - before.GetMdioTotal();
+	ret.qspiTransactions = g_simFPGA.m_stats.qspiTransactions - before.qspiTransactions;
+	ret.qspiBytes = g_simFPGA.m_stats.qspiBytes - before.qspiBytes;
+	return ret;
+}
+
+/**
+	@brief Handles a !directive line, returns false if it's malformed
+ */
+static bool RunDirective(const char* line)
+{
+	char verb[32];
+	int port;
+	char state[32];
+	int mbps = 1000;
+	int ms;
+
+	if(1 == sscanf(line, "!idle %d", &ms))
+	{
+		uint64_t end = SimGetTime() + ms * 1000000ULL;
+		while(SimGetTime() < end)
+			RunOneTick();
+		return true;
+	}
+
+	unsigned int frames;
+	unsigned int len;
+	char type[32] = "unicast";
+	if(sscanf(line, "!traffic %d %u %u %31s", &port, &frames, &len, type) >= 3)
+	{
+		if( (port < 0) || (port >= RMON_PORTS) )
+			return false;
+
+		if(!strcmp(type, "unicast"))
+			g_simFPGA.AddTraffic(port, frames, len, SIM_FRAME_UNICAST);
+		else if(!strcmp(type, "broadcast"))
+			g_simFPGA.AddTraffic(port, frames, len, SIM_FRAME_BROADCAST);
+		else if(!strcmp(type, "multicast"))
+			g_simFPGA.AddTraffic(port, frames, len, SIM_FRAME_MULTICAST);
+		else if(!strcmp(type, "bad"))
+			g_simFPGA.AddTraffic(port, frames, len, SIM_FRAME_BAD_FCS);
+		else
+			return false;
+		return true;
+	}
+
+	int n = sscanf(line, "!%31s %d %31s %d", verb, &port, state, &mbps);
+	if( (n >= 3) && !strcmp(verb, "link") && (port >= 0) && (port < 4) )
+	{
+		int speed = 2;
+		if(mbps == 10)
+			speed = 0;
+		else if(mbps == 100)
+			speed = 1;
+		g_simFPGA.SetLink(port, !strcmp(state, "up"), speed);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+	@brief Loads latency and MDIO counts from a previous --csv run
+ */
+static bool LoadBaseline(const char* path, std::vector<BenchResult>& results)
+{
+	FILE* fp = fopen(path, "r");
+	if(!fp)
+		return false;
+
+	char line[512];
+	while(fgets(line, sizeof(line), fp))
+	{
+		//Skip the header
+		if(!strncmp(line, "command,", 8))
+			continue;
+
+		//Command is quoted, then the numbers
+		char* end = strrchr(line, '"');
+		if( (line[0] != '"') || (end == line) || !end)
+			continue;
+
+		BenchResult r;
+		r.command = std::string(line + 1, end - line - 1);
+		unsigned long long latency;
+		unsigned long long mdio;
+		unsigned long long qspi;
+		unsigned long long bytes;
+		if(4 != sscanf(end + 1, ",%llu,%llu,%llu,%llu", &latency, &mdio, &qspi, &bytes))
+			continue;
+		r.latencyNs = latency;
+		r.mdio = mdio;
+		r.qspiTransactions = qspi;
+		r.qspiBytes = bytes;
+		r.timedOut = false;
+		results.push_back(r);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+static void Usage()
+{
+	fprintf(stderr, "Usage: tapsim [-v] [--profile name] [--csv results.csv] [--baseline previous.csv] script.txt\n");
+}
+
+int main(int argc, char* argv[])
+{
+	bool verbose = false;
+	const char* scriptPath = nullptr;
+	const char* csvPath = nullptr;
+	const char* baselinePath = nullptr;
+	bool profileGiven = false;
+
+	for(int i=1; i<argc; i++)
+	{
+		std::string s(argv[i]);
+		if(s == "-v")
+			verbose = true;
+		else if( (s == "--csv") && (i+1 < argc) )
+			csvPath = argv[++i];
+		else if( (s == "--baseline") && (i+1 < argc) )
+			baselinePath = argv[++i];
+		else if( (s == "--profile") && (i+1 < argc) )
+		{
+			profileGiven = true;
+			g_clockProfileFromButton = true;
+			const char* name = argv[++i];
+			g_clockProfile = nullptr;
+			for(int j=0; j<CLOCK_PROFILE_COUNT; j++)
+			{
+				if(!strcmp(g_clockProfiles[j].name, name))
+					g_clockProfile = &g_clockProfiles[j];
+			}
+			if(!g_clockProfile)
+			{
+				fprintf(stderr, "Unknown clock profile \"%s\"\n", name);
+				return 1;
+			}
+		}
+		else if(s[0] == '-')
+		{
+			Usage();
+			return 1;
+		}
+		else
+			scriptPath = argv[i];
+	}
+	if(!scriptPath)
+	{
+		Usage();
+		return 1;
+	}
+
+	FILE* fp = fopen(scriptPath, "r");
+	if(!fp)
+	{
+		fprintf(stderr, "Couldn't open script \"%s\"\n", scriptPath);
+		return 1;
+	}
+
+	if(verbose)
+		g_simConsole = stdout;
+
+	//Same bringup as the firmware's main(), minus the interrupt controller setup.
+	//--profile stands in for holding down a button at boot.
+	if(!profileGiven)
+		SelectClockProfile();
+	static BufferedUART uart(&UART4, g_clockProfile->GetUARTDivisor(115200));
+	g_cliUART = &uart;
+	InitClocks();
+	InitProfiler();
+	InitLog();
+	InitQSPI();
+	InitFPGA();
+	InitPHYs();
+	InitCLI();
+
+	static GPIOPin irq(&GPIOE, 12, GPIOPin::MODE_INPUT, GPIOPin::SLEW_SLOW);
+	g_irq = &irq;
+
+	g_uartCliContext.PrintPrompt();
+	SchedulerInit(g_taskTable, TASK_COUNT);
+	g_log.SetDeferred(true);
+	SchedulerWake(g_taskTable[TASK_FPGA_IRQ]);
+
+	//Let the boot-time work settle before measuring anything
+	RunCommand("");
+	g_simFPGA.m_stats = SimStats();
+
+	//Run the script
+	std::vector<BenchResult> results;
+	char line[256];
+	int lineNum = 0;
+	while(fgets(line, sizeof(line), fp))
+	{
+		lineNum ++;
+		line[strcspn(line, "\r\n")] = '\0';
+		if( (line[0] == '\0') || (line[0] == '#') )
+			continue;
+
+		if(line[0] == '!')
+		{
+			if(!RunDirective(line))
+			{
+				fprintf(stderr, "%s:%d: bad directive \"%s\"\n", scriptPath, lineNum, line);
+				fclose(fp);
+				return 1;
+			}
+			continue;
+		}
+
+		results.push_back(RunCommand(line));
+	}
+	fclose(fp);
+
+	if(verbose)
+		printf("\n\n");
+
+	//Report
+	printf("%-40s %12s %8s %8s %10s\n", "command", "latency_us", "mdio", "qspi", "qspi_bytes");
+	BenchResult total = {"(total)", 0, 0, 0, 0, false};
+	for(auto& r : results)
+	{
+		printf("%-40s %12.1f %8llu %8llu %10llu%s\n",
+			r.command.c_str(),
+			r.latencyNs / 1000.0,
+			(unsigned long long)r.mdio,
+			(unsigned long long)r.qspiTransactions,
+			(unsigned long long)r.qspiBytes,
+			r.timedOut ? " TIMEOUT" : "");
+		total.latencyNs += r.latencyNs;
+		total.mdio += r.mdio;
+		total.qspiTransactions += r.qspiTransactions;
+		total.qspiBytes += r.qspiBytes;
+	}
+	printf("%-40s %12.1f %8llu %8llu %10llu\n",
+		total.command.c_str(),
+		total.latencyNs / 1000.0,
+		(unsigned long long)total.mdio,
+		(unsigned long long)total.qspiTransactions,
+		(unsigned long long)total.qspiBytes);
+
+	if(csvPath)
+	{
+		FILE* csv = fopen(csvPath, "w");
+		if(!csv)
+		{
+			fprintf(stderr, "Couldn't open \"%s\"\n", csvPath);
+			return 1;
+		}
+		fprintf(csv, "command,latency_ns,mdio,qspi,qspi_bytes\n");
+		for(auto& r : results)
+		{
+			fprintf(csv, "\"%s\",%llu,%llu,%llu,%llu\n",
+				r.command.c_str(),
+				(unsigned long long)r.latencyNs,
+				(unsigned long long)r.mdio,
+				(unsigned long long)r.qspiTransactions,
+				(unsigned long long)r.qspiBytes);
+		}
+		fclose(csv);
+	}
+
+	int status = 0;
+	for(auto& r : results)
+	{
+		if(r.timedOut)
+			status = 1;
+	}
+
+	//Compare against the baseline: flag anything more than 10% slower, or doing more MDIO traffic
+	if(baselinePath)
+	{
+		std::vector<BenchResult> baseline;
+		if(!LoadBaseline(baselinePath, baseline))
+		{
+			fprintf(stderr, "Couldn't open baseline \"%s\"\n", baselinePath);
+			return 1;
+		}
+
+		for(size_t i=0; (i < results.size()) && (i < baseline.size()); i++)
+		{
+			auto& r = results[i];
+			auto& b = baseline[i];
+			if(r.command != b.command)
+			{
+				fprintf(stderr, "Baseline doesn't match script at \"%s\"\n", r.command.c_str());
+				return 1;
+			}
+
+			if(r.latencyNs > b.latencyNs + b.latencyNs/10)
+			{
+				printf("REGRESSION: %s: latency %.1f us, was %.1f us\n",
+					r.command.c_str(), r.latencyNs / 1000.0, b.latencyNs / 1000.0);
+				status = 1;
+			}
+			if(r.mdio > b.mdio)
+			{
+				printf("REGRESSION: %s: %llu MDIO transactions, was %llu\n",
+					r.command.c_str(), (unsigned long long)r.mdio, (unsigned long long)b.mdio);
+				status = 1;
+			}
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,95 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Host simulation stand-in for stm32-cpp's GPIOPin
+
+	Inputs are read from the simulator (see SimGPIORead()), outputs are ignored.
+ */
+#ifndef GPIO_h
+#define GPIO_h
+
+#include <stm32.h>
+
+bool SimGPIORead(volatile gpio_t* gpio, uint8_t pin);
+
+class GPIOPin
+{
+public:
+	enum gpiomode_t
+	{
+		MODE_INPUT,
+		MODE_OUTPUT,
+		MODE_PERIPHERAL,
+		MODE_ANALOG
+	};
+
+	enum slew_t
+	{
+		SLEW_SLOW,
+		SLEW_MEDIUM,
+		SLEW_FAST,
+		SLEW_VERYFAST
+	};
+
+	GPIOPin(volatile gpio_t* gpio, uint8_t pin, gpiomode_t mode, slew_t slew = SLEW_SLOW, uint8_t altmode = 0)
+		: m_gpio(gpio)
+		, m_pin(pin)
+		, m_mode(mode)
+		, m_value(false)
+	{
+		(void)slew;
+		(void)altmode;
+	}
+
+	void Set(bool b)
+	{ m_value = b; }
+
+	bool Get()
+	{
+		if(m_mode == MODE_INPUT)
+			return SimGPIORead(m_gpio, m_pin);
+		return m_value;
+	}
+
+	void operator=(bool b)
+	{ Set(b); }
+
+	operator bool()
+	{ return Get(); }
+
+protected:
+	volatile gpio_t*	m_gpio;
+	uint8_t				m_pin;
+	gpiomode_t			m_mode;
+	bool				m_value;
+};
+
+#endif
@@ -0,0 +1,119 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Host simulation stand-in for stm32-cpp's OctoSPI
+
+	Transactions go to the simulated FPGA register map (SimFPGA) and advance simulated time by the time they would
+	take on the wire.
+ */
+#ifndef OctoSPI_h
+#define OctoSPI_h
+
+#include <stm32.h>
+
+class OctoSPI
+{
+public:
+	enum mode_t
+	{
+		MODE_NONE,
+		MODE_SINGLE,
+		MODE_DUAL,
+		MODE_QUAD,
+		MODE_OCTAL
+	};
+
+	OctoSPI(volatile octospi_t* lane, uint32_t sizeBytes, uint8_t prescale);
+
+	void SetDoubleRateMode(bool ddr)
+	{ (void)ddr; }
+
+	void SetInstructionMode(mode_t mode, uint8_t nbytes = 1)
+	{
+		(void)mode;
+		(void)nbytes;
+	}
+
+	void SetAddressMode(mode_t mode, uint8_t nbytes = 1)
+	{
+		(void)mode;
+		(void)nbytes;
+	}
+
+	void SetAltBytesMode(mode_t mode, uint8_t nbytes = 1)
+	{
+		(void)mode;
+		(void)nbytes;
+	}
+
+	void SetDataMode(mode_t mode)
+	{ (void)mode; }
+
+	void SetDummyCycleCount(uint8_t n)
+	{ (void)n; }
+
+	void SetDQSEnable(bool enable)
+	{ (void)enable; }
+
+	void SetDeselectTime(uint8_t n)
+	{ (void)n; }
+
+	void SetSampleDelay(bool delay, bool ddr = false)
+	{
+		(void)delay;
+		(void)ddr;
+	}
+
+	void BlockingWrite(uint32_t insn, uint32_t addr, const uint8_t* data, uint32_t len);
+	void BlockingRead(uint32_t insn, uint32_t addr, uint8_t* data, uint32_t len);
+
+	void BlockingWrite8(uint32_t insn, uint32_t addr, uint8_t data)
+	{ BlockingWrite(insn, addr, &data, 1); }
+
+	uint8_t BlockingRead8(uint32_t insn, uint32_t addr)
+	{
+		uint8_t data;
+		BlockingRead(insn, addr, &data, 1);
+		return data;
+	}
+
+	uint16_t BlockingRead16(uint32_t insn, uint32_t addr)
+	{
+		uint8_t data[2];
+		BlockingRead(insn, addr, data, 2);
+		return data[0] | (data[1] << 8);
+	}
+
+protected:
+	uint8_t m_prescale;
+};
+
+#endif
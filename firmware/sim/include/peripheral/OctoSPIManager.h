@@ -0,0 +1,76 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Host simulation stand-in for stm32-cpp's OctoSPIManager
+ */
+#ifndef OctoSPIManager_h
+#define OctoSPIManager_h
+
+#include <stm32.h>
+
+class OctoSPIManager
+{
+public:
+	enum halfport_t
+	{
+		C1_LOW,
+		C1_HIGH,
+		C2_LOW,
+		C2_HIGH
+	};
+
+	enum port_t
+	{
+		PORT_1,
+		PORT_2
+	};
+
+	static void ConfigureMux(bool multiplexed)
+	{ (void)multiplexed; }
+
+	static void ConfigurePort(
+		uint8_t num,
+		bool dqhighEnable, halfport_t dqhighSel,
+		bool dqlowEnable, halfport_t dqlowSel,
+		bool csEnable, port_t csSel,
+		bool dqsEnable, port_t dqsSel,
+		bool clkEnable, port_t clkSel)
+	{
+		(void)num;
+		(void)dqhighEnable; (void)dqhighSel;
+		(void)dqlowEnable; (void)dqlowSel;
+		(void)csEnable; (void)csSel;
+		(void)dqsEnable; (void)dqsSel;
+		(void)clkEnable; (void)clkSel;
+	}
+};
+
+#endif
@@ -0,0 +1,136 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Host simulation stand-in for the stm32-cpp device header
+
+	Only the peripherals the firmware touches by name are declared. They're plain memory, except for the UART data
+	register which forwards to the simulated console.
+ */
+#ifndef stm32_h
+#define stm32_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum vos_t
+{
+	RANGE_VOS0,
+	RANGE_VOS1,
+	RANGE_VOS2,
+	RANGE_VOS3
+};
+
+struct dbgmcu_t
+{
+	uint32_t IDCODE;
+};
+
+struct syscfg_t
+{
+	uint32_t EXTICR[4];
+	uint32_t PKGR;
+};
+
+struct scb_t
+{
+	uint32_t AIRCR;
+};
+
+/**
+	@brief UART transmit data register. Writes go to the simulated console.
+ */
+struct SimUartTDR
+{
+	void operator=(uint32_t ch) volatile;
+};
+
+struct usart_t
+{
+	uint32_t	CR1;
+	uint32_t	CR2;
+	uint32_t	CR3;
+	uint32_t	BRR;
+	uint32_t	ISR;
+	uint32_t	RDR;
+	SimUartTDR	TDR;
+};
+
+struct tim_t
+{
+	uint32_t CNT;
+};
+
+struct octospi_t
+{
+	uint32_t CR;
+};
+
+struct gpio_t
+{
+	uint32_t IDR;
+	uint32_t ODR;
+};
+
+#define USART_ISR_RXNE		0x20
+#define USART_ISR_TXE		0x80
+#define USART_CR1_RXNEIE	0x20
+#define USART_CR1_TXEIE		0x80
+
+extern volatile dbgmcu_t DBGMCU;
+extern volatile syscfg_t SYSCFG;
+extern volatile scb_t SCB;
+extern volatile usart_t UART4;
+extern volatile tim_t TIM2;
+extern volatile octospi_t OCTOSPI1;
+extern volatile gpio_t GPIOA;
+extern volatile gpio_t GPIOB;
+extern volatile gpio_t GPIOC;
+extern volatile gpio_t GPIOD;
+extern volatile gpio_t GPIOE;
+extern volatile gpio_t GPIOF;
+extern volatile gpio_t GPIOG;
+extern volatile gpio_t GPIOH;
+
+extern uint32_t L_ID;
+extern uint32_t F_ID;
+extern uint32_t U_ID[3];
+
+//Linker script symbols for the .data copy in main(). glibc has its own __data_start, so point them at a dummy byte
+extern uint8_t g_simData;
+extern uint8_t g_simDataRom;
+#define __data_start g_simData
+#define __data_end g_simData
+#define __data_romstart g_simDataRom
+
+void EnableInterrupts();
+void DisableInterrupts();
+
+#endif
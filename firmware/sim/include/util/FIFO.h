@@ -0,0 +1,88 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Host simulation stand-in for stm32-cpp's FIFO
+ */
+#ifndef FIFO_h
+#define FIFO_h
+
+#include <stdint.h>
+
+template<class objtype, uint32_t depth>
+class FIFO
+{
+public:
+	FIFO()
+		: m_wptr(0)
+		, m_rptr(0)
+		, m_empty(true)
+	{}
+
+	void Push(objtype item)
+	{
+		if(IsFull())
+			return;
+		m_storage[m_wptr] = item;
+		m_wptr = (m_wptr + 1) % depth;
+		m_empty = false;
+	}
+
+	objtype Pop()
+	{
+		if(IsEmpty())
+			return objtype();
+		objtype item = m_storage[m_rptr];
+		m_rptr = (m_rptr + 1) % depth;
+		m_empty = (m_rptr == m_wptr);
+		return item;
+	}
+
+	bool IsEmpty()
+	{ return m_empty; }
+
+	bool IsFull()
+	{ return (m_wptr == m_rptr) && !m_empty; }
+
+	void Reset()
+	{
+		m_wptr = 0;
+		m_rptr = 0;
+		m_empty = true;
+	}
+
+protected:
+	objtype		m_storage[depth];
+	uint32_t	m_wptr;
+	uint32_t	m_rptr;
+	bool		m_empty;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Host simulation stand-in for stm32-cpp's Logger
+ */
+#ifndef Logger_h
+#define Logger_h
+
+#include <stdarg.h>
+#include <util/CharacterDevice.h>
+#include <peripheral/Timer.h>
+
+class Logger
+{
+public:
+	enum LogType
+	{
+		VERBOSE,
+		NOTICE,
+		WARNING,
+		ERROR
+	};
+
+	Logger()
+		: m_target(nullptr)
+		, m_timer(nullptr)
+		, m_indentLevel(0)
+	{}
+
+	void Initialize(CharacterDevice* target, Timer* timer)
+	{
+		m_target = target;
+		m_timer = timer;
+	}
+
+	void operator()(const char* format, ...);
+	void operator()(LogType type, const char* format, ...);
+
+	void Indent()
+	{ m_indentLevel ++; }
+
+	void Unindent()
+	{
+		if(m_indentLevel)
+			m_indentLevel --;
+	}
+
+protected:
+	void Print(LogType type, const char* format, va_list args);
+
+	CharacterDevice*	m_target;
+	Timer*				m_timer;
+	int					m_indentLevel;
+};
+
+class LogIndenter
+{
+public:
+	LogIndenter(Logger& log)
+		: m_log(log)
+	{ m_log.Indent(); }
+
+	~LogIndenter()
+	{ m_log.Unindent(); }
+
+protected:
+	Logger& m_log;
+};
+
+#endif
@@ -31,18 +31,32 @@
 
 typedef void(*fnptr)();
 
-extern uint32_t __stack;
 extern uint32_t __bss_start__;
 extern uint32_t __bss_end__;
 
+//TCM sections, from tcm.ld
+extern uint32_t __itcm_start;
+extern uint32_t __itcm_end;
+extern uint32_t __itcm_romstart;
+extern uint32_t __dtcm_data_start;
+extern uint32_t __dtcm_data_end;
+extern uint32_t __dtcm_data_romstart;
+extern uint32_t __dtcm_bss_start;
+extern uint32_t __dtcm_bss_end;
+extern uint32_t __dtcm_stack;
+
 //prototypes
-extern "C" void _start();
+extern "C" void __libc_init_array();
+int main();
+void Reset_Handler();
 void MMUFault_Handler();
 void UsageFault_Handler();
 void BusFault_Handler();
 void HardFault_Handler();
 void NMI_Handler();
 
+void SysTick_Handler();
+void EXTI15_10_Handler();
 void UART4_Handler();
 
 void defaultISR();
@@ -52,8 +66,8 @@ void defaultISR();
 
 fnptr __attribute__((section(".vector"))) vectorTable[] =
 {
-	(fnptr)&__stack,			//stack
-	_start,					//reset
+	(fnptr)&__dtcm_stack,	//stack
+	Reset_Handler,			//reset
 	NMI_Handler,			//NMI
 	HardFault_Handler,		//hardfault
 	MMUFault_Handler,		//mmufault
@@ -67,7 +81,7 @@ fnptr __attribute__((section(".vector"))) vectorTable[] =
 	defaultISR,				//debug
 	defaultISR,				//reserved_13
 	defaultISR,				//pend_sv
-	defaultISR,				//systick
+	SysTick_Handler,		//systick
 	defaultISR,				//irq0 WWDG
 	defaultISR,				//irq1 PVD
 	defaultISR,				//irq2 RTC_TAMP_STAMP_CSS_LSE
@@ -108,7 +122,7 @@ fnptr __attribute__((section(".vector"))) vectorTable[] =
 	defaultISR,				//irq37 USART1
 	defaultISR,				//irq38 USART2
 	defaultISR,				//irq39 USART3
-	defaultISR,				//irq40 EXTI15_10
+	EXTI15_10_Handler,		//irq40 EXTI15_10
 	defaultISR,				//irq41 RTC_Alarm
 	defaultISR,				//irq42 reserved
 	defaultISR,				//irq43 TIM8_BRK_TIM12
@@ -243,6 +257,37 @@ void defaultISR()
 	{}
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reset
+
+/**
+	@brief Sets up memory, runs global constructors, then calls main()
+
+	This replaces newlib's _start so that the TCMs are loaded before any constructor runs (some global objects live
+	there), and so the stack pointer the core loaded from the vector table (top of DTCM) isn't moved back to SRAM.
+ */
+void Reset_Handler()
+{
+	//Normal .data and .bss
+	memcpy(&__data_start, &__data_romstart, &__data_end - &__data_start + 1);
+	for(uint32_t* p = &__bss_start__; p < &__bss_end__; p++)
+		*p = 0;
+
+	//Code and data in the TCMs
+	for(uint32_t *src = &__itcm_romstart, *dst = &__itcm_start; dst < &__itcm_end; src++, dst++)
+		*dst = *src;
+	for(uint32_t *src = &__dtcm_data_romstart, *dst = &__dtcm_data_start; dst < &__dtcm_data_end; src++, dst++)
+		*dst = *src;
+	for(uint32_t* p = &__dtcm_bss_start; p < &__dtcm_bss_end; p++)
+		*p = 0;
+
+	__libc_init_array();
+	main();
+
+	while(1)
+	{}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Exception vectors
 
@@ -313,13 +358,36 @@ void MMUFault_Handler()
 	{}
 }
 
-void __attribute__((isr)) UART4_Handler()
+void __attribute__((isr)) ITCM_CODE SysTick_Handler()
 {
-	//Check why we got the IRQ.
-	//For now, ignore anything other than "data ready"
-	if(0 == (UART4.ISR & USART_ISR_RXNE))
+	//Nothing to do, this just wakes the main loop from WFI so periodic tasks can run
+}
+
+void __attribute__((isr)) ITCM_CODE EXTI15_10_Handler()
+{
+	//Only line 12 (FPGA IRQ) is enabled
+	volatile uint32_t* EXTI_C1PR1 = (volatile uint32_t*)(0x58000088);
+	if(0 == (*EXTI_C1PR1 & (1 << 12)))
 		return;
+	*EXTI_C1PR1 = (1 << 12);
+
+	FPGAEvent ev;
+	ev.timestamp = g_logTimer->GetCount();
+	g_fpgaEvents.Push(ev);
+	SchedulerWake(g_taskTable[TASK_FPGA_IRQ]);
+}
+
+void __attribute__((isr)) ITCM_CODE UART4_Handler()
+{
+	//Check why we got the IRQ.
+	//For now, ignore anything other than "data ready" and "transmit buffer empty"
+	uint32_t isr = UART4.ISR;
 
 	//rx data? Shove it in the fifo
-	g_cliUART->OnIRQRxData(UART4.RDR);
+	if(isr & USART_ISR_RXNE)
+		g_cliUART->OnIRQRxData(UART4.RDR);
+
+	//Ready for more tx data? Send the next byte
+	if( (isr & USART_ISR_TXE) && (UART4.CR1 & USART_CR1_TXEIE) )
+		g_cliUART->OnIRQTxEmpty();
 }
@@ -0,0 +1,149 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@brief Clause 22 MDIO master with run-time configurable MDC rate and optional preamble suppression
+
+	Drop-in replacement for EthernetMDIOTransceiver with two extra configuration inputs:
+		clk_div				MDC half period, in clk_125mhz cycles, minus one (30 gives the standard ~2 MHz)
+		preamble_suppress	Send a single idle bit instead of the full 32-bit preamble
+
+	Both should only be changed while the bus is idle.
+
+	MDIO is driven just after MDC falls and sampled as MDC rises, so the PHY's clock-to-out delay has to fit in one
+	MDC period. Whether a given rate works depends on the PHY and board, so firmware is expected to probe.
+ */
+module ConfigurableMDIOTransceiver(
+	input wire			clk_125mhz,
+	input wire[4:0]		phy_md_addr,
+
+	//Bus interface
+	output logic		mdio_tx_data	= 1,
+	output logic		mdio_tx_en		= 0,
+	input wire			mdio_rx_data,
+	output logic		mdc				= 0,
+
+	//Configuration
+	input wire[7:0]		clk_div,
+	input wire			preamble_suppress,
+
+	//Management interface
+	output logic		mgmt_busy_fwd	= 0,
+	input wire[4:0]		phy_reg_addr,
+	input wire[15:0]	phy_wr_data,
+	output logic[15:0]	phy_rd_data		= 0,
+	input wire			phy_reg_wr,
+	input wire			phy_reg_rd
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Frame layout (after preamble)
+	//	[31:30]	start of frame (01)
+	//	[29:28]	opcode (10 = read, 01 = write)
+	//	[27:23]	PHY address
+	//	[22:18]	register address
+	//	[17:16]	turnaround (10 for writes, released for reads)
+	//	[15:0]	data
+
+	logic[31:0]	frame		= 0;
+	logic		is_read		= 0;
+	logic[5:0]	preamble	= 0;
+	logic[6:0]	bitnum		= 0;
+	logic[7:0]	phase		= 0;
+	logic[15:0]	rd_shreg	= 0;
+
+	//Position within the frame of the bit currently on the wire
+	wire[6:0]	frame_bit	= bitnum - preamble;
+	wire		in_preamble	= (bitnum < preamble);
+	wire[6:0]	total_bits	= preamble + 32;
+
+	always_ff @(posedge clk_125mhz) begin
+
+		//Start a new transaction
+		if(!mgmt_busy_fwd && (phy_reg_rd || phy_reg_wr) ) begin
+			mgmt_busy_fwd	<= 1;
+			is_read			<= phy_reg_rd;
+			frame			<= { 2'b01, phy_reg_rd ? 2'b10 : 2'b01, phy_md_addr, phy_reg_addr, 2'b10, phy_wr_data };
+			preamble		<= preamble_suppress ? 6'd1 : 6'd32;
+			bitnum			<= 0;
+			phase			<= 0;
+			mdc				<= 0;
+
+			//First bit is always part of the preamble
+			mdio_tx_en		<= 1;
+			mdio_tx_data	<= 1;
+		end
+
+		else if(mgmt_busy_fwd) begin
+
+			phase			<= phase + 1;
+
+			if(phase == clk_div) begin
+				phase		<= 0;
+
+				//Rising edge: PHY samples our bit, and we sample data bits being read
+				if(!mdc) begin
+					mdc		<= 1;
+					if(is_read && !in_preamble && (frame_bit >= 16) )
+						rd_shreg	<= { rd_shreg[14:0], mdio_rx_data };
+				end
+
+				//Falling edge: move on to the next bit, or finish
+				else begin
+					mdc		<= 0;
+					bitnum	<= bitnum + 1;
+
+					if(bitnum + 1 == total_bits) begin
+						mgmt_busy_fwd	<= 0;
+						mdio_tx_en		<= 0;
+						mdio_tx_data	<= 1;
+						if(is_read)
+							phy_rd_data	<= rd_shreg;
+					end
+
+					else if(bitnum + 1 < preamble) begin
+						mdio_tx_en		<= 1;
+						mdio_tx_data	<= 1;
+					end
+
+					else begin
+						//Release the bus for the turnaround and data phases of a read
+						mdio_tx_en		<= !is_read || (bitnum + 1 - preamble < 14);
+						mdio_tx_data	<= frame[31 - (bitnum + 1 - preamble)];
+					end
+				end
+
+			end
+		end
+
+	end
+
+endmodule
@@ -0,0 +1,331 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+`include "EthernetBus.svh"
+`include "MicrocontrollerInterface.svh"
+
+/**
+	@brief EthernetCrossoverClockCrossing_x8 plus overflow accounting
+
+	The crossing FIFO silently discards frames that don't fit. FIFO occupancy is tracked from the outside (bytes
+	admitted on the RX side minus bytes sent on the TX side), which gives a high water mark and a way to see drops.
+
+	With ADMISSION_CONTROL set, we never let the FIFO fill up: a frame is only passed on if a maximum size frame would
+	still fit when it starts. Anything else is dropped here and counted, so the counts are exact.
+
+	With ADMISSION_CONTROL clear, every frame goes to the crossing exactly as if this wrapper weren't there. A frame
+	that ends with more than FIFO_BYTES in the FIFO is counted as dropped, since the crossing should have thrown it
+	out, but the crossing doesn't say whether it did, so these counts are estimates and no better than FIFO_BYTES.
+	Every frame is added to the occupancy estimate whether or not we think it was dropped: a wrong guess leaves the
+	estimate high (and over counts later drops) rather than low (and misses them). The estimate is pulled back into
+	line whenever the path goes idle long enough that the FIFO must be empty.
+
+	The TX side byte count reaches the RX clock domain a few cycles late, so the occupancy estimate is always on the
+	high side.
+
+	FIFO_BYTES is the size of the FIFO inside EthernetCrossoverClockCrossing_x8. With ADMISSION_CONTROL set it may be
+	smaller, never larger. The default has not been checked against the crossing.
+
+	Frames thrown out before they got here (upstream_drop, see MonitorFilter) are counted as drops too.
+
+	Statistics are snapshotted and cleared the same way as RmonCounters (the management side runs on tx_clk).
+ */
+module EthernetAccountedCrossing #(
+	parameter FIFO_BYTES		= 4096,
+	parameter MAX_FRAME_LEN		= 1536,
+	parameter ADMISSION_CONTROL	= 1
+)(
+
+	//Incoming frames
+	input wire					rx_clk,
+	input wire					rx_rst,
+	input wire EthernetRxBus	rx_bus,
+	output logic				frame_queued	= 0,	//a frame was committed to the FIFO (rx_clk domain)
+	input wire					upstream_drop,			//a frame was lost before it got here (rx_clk domain)
+	input wire[15:0]			upstream_drop_len,
+
+	//Outgoing frames
+	input wire					tx_clk,
+	input wire					tx_rst,
+	input wire					tx_ready,
+	output EthernetTxBus		tx_bus,
+
+	//Statistics (tx_clk domain)
+	input wire					snapshot,
+	input wire					clear,
+	output pathstats_t			snapshot_data,
+	output wire					snapshot_done
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Count bytes leaving the FIFO, and send the total back to the RX side
+
+	logic[31:0]	tx_total		= 0;
+	logic[7:0]	tx_idle_count	= 0;
+	logic		tx_sync_en		= 0;
+	logic		tx_sync_busy	= 0;
+	wire		tx_sync_ack;
+
+	//If the output has been ready this long without getting a frame, the FIFO is empty
+	wire		tx_empty		= (tx_idle_count == 8'hff);
+
+	always_ff @(posedge tx_clk) begin
+		tx_sync_en		<= 0;
+
+		if(tx_bus.data_valid)
+			tx_total	<= tx_total + tx_bus.bytes_valid;
+
+		if(!tx_ready || tx_bus.start || tx_bus.data_valid)
+			tx_idle_count	<= 0;
+		else if(!tx_empty)
+			tx_idle_count	<= tx_idle_count + 1;
+
+		//Keep sending the latest count
+		if(tx_sync_ack)
+			tx_sync_busy	<= 0;
+		else if(!tx_sync_busy && !tx_sync_en) begin
+			tx_sync_en		<= 1;
+			tx_sync_busy	<= 1;
+		end
+
+		if(tx_rst) begin
+			tx_total		<= 0;
+			tx_idle_count	<= 0;
+		end
+	end
+
+	wire[31:0]	tx_total_rx;
+	wire		tx_empty_rx;
+
+	RegisterSynchronizer #(
+		.WIDTH(33)
+	) sync_tx_total (
+		.clk_a(tx_clk),
+		.en_a(tx_sync_en),
+		.ack_a(tx_sync_ack),
+		.reg_a({tx_empty, tx_total}),
+
+		.clk_b(rx_clk),
+		.updated_b(),
+		.reset_b(1'b0),
+		.reg_b({tx_empty_rx, tx_total_rx})
+	);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Move statistics control strobes into the RX clock domain
+
+	wire	snapshot_rx;
+	wire	clear_rx;
+
+	PulseSynchronizer sync_snapshot(
+		.clk_a(tx_clk),
+		.pulse_a(snapshot),
+		.clk_b(rx_clk),
+		.pulse_b(snapshot_rx));
+
+	PulseSynchronizer sync_clear(
+		.clk_a(tx_clk),
+		.pulse_a(clear),
+		.clk_b(rx_clk),
+		.pulse_b(clear_rx));
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Admission control and occupancy tracking
+
+	//Bytes of committed frames written to the FIFO, plus bytes so far of the frame being written
+	logic[31:0]	rx_committed	= 0;
+	logic[15:0]	rx_frame_len	= 0;
+
+	//Nothing has come in for long enough that anything we committed has reached the TX side
+	logic[7:0]	rx_idle_count	= 0;
+	wire		rx_idle			= (rx_idle_count == 8'hff);
+
+	//Clamp at zero: right after a reset, the TX total can briefly be stale
+	wire[31:0]	occupancy_raw	= rx_committed + rx_frame_len - tx_total_rx;
+	wire[15:0]	occupancy		= occupancy_raw[31] ? 16'h0 : (occupancy_raw > 32'hffff) ? 16'hffff : occupancy_raw[15:0];
+
+	logic			dropping	= 0;
+	logic[15:0]		drop_len	= 0;
+	EthernetRxBus	fifo_bus;
+
+	pathstats_t		stats;
+
+	initial begin
+		fifo_bus		= 0;
+		stats			= 0;
+		stats.fifo_size	= FIFO_BYTES;
+	end
+
+	always_ff @(posedge rx_clk) begin
+
+		fifo_bus		<= rx_bus;
+		frame_queued	<= 0;
+
+		if(rx_bus.start || rx_bus.data_valid || rx_bus.commit)
+			rx_idle_count	<= 0;
+		else if(!rx_idle)
+			rx_idle_count	<= rx_idle_count + 1;
+
+		//Decide whether to take each frame as it starts
+		if(rx_bus.start) begin
+			if(ADMISSION_CONTROL && (occupancy + MAX_FRAME_LEN > FIFO_BYTES) ) begin
+				dropping		<= 1;
+				drop_len		<= 0;
+				fifo_bus.start	<= 0;
+			end
+			else begin
+				dropping		<= 0;
+				rx_frame_len	<= 0;
+			end
+		end
+
+		//Dropped frame: eat the rest of it, and count it if the MAC didn't throw it out anyway
+		else if(dropping) begin
+			fifo_bus.data_valid	<= 0;
+			fifo_bus.commit		<= 0;
+			fifo_bus.drop		<= 0;
+
+			if(rx_bus.data_valid)
+				drop_len	<= drop_len + rx_bus.bytes_valid;
+
+			if(rx_bus.commit) begin
+				stats.drop_frames	<= stats.drop_frames + 1;
+				stats.drop_bytes	<= stats.drop_bytes + drop_len + (rx_bus.data_valid ? rx_bus.bytes_valid : 0);
+				dropping			<= 0;
+			end
+			if(rx_bus.drop)
+				dropping			<= 0;
+		end
+
+		//Forwarded frame
+		else begin
+			if(rx_bus.data_valid)
+				rx_frame_len	<= rx_frame_len + rx_bus.bytes_valid;
+
+			if(rx_bus.commit) begin
+				rx_committed	<= rx_committed + rx_frame_len + (rx_bus.data_valid ? rx_bus.bytes_valid : 0);
+				rx_frame_len	<= 0;
+
+				//Count only: the crossing gets the frame regardless, but probably didn't keep it if it didn't fit
+				if(!ADMISSION_CONTROL && (occupancy + (rx_bus.data_valid ? rx_bus.bytes_valid : 0) > FIFO_BYTES) ) begin
+					stats.drop_frames	<= stats.drop_frames + 1;
+					stats.drop_bytes	<= stats.drop_bytes + rx_frame_len + (rx_bus.data_valid ? rx_bus.bytes_valid : 0);
+				end
+				else
+					frame_queued	<= 1;
+			end
+			if(rx_bus.drop)
+				rx_frame_len	<= 0;
+		end
+
+		//Both sides idle, so the FIFO is empty: drop whatever error the estimate has built up from frames the
+		//crossing threw out without telling us
+		if(!ADMISSION_CONTROL && rx_idle && tx_empty_rx)
+			rx_committed	<= tx_total_rx;
+
+		if(occupancy > stats.high_water)
+			stats.high_water	<= occupancy;
+
+		if(clear_rx) begin
+			stats.drop_frames	<= 0;
+			stats.drop_bytes	<= 0;
+			stats.high_water	<= 0;
+		end
+
+		//The FIFO is flushed on reset
+		if(rx_rst) begin
+			rx_committed	<= 0;
+			rx_frame_len	<= 0;
+			rx_idle_count	<= 0;
+			dropping		<= 0;
+			fifo_bus		<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Upstream drops, counted separately since they can come in the same clock as one of ours
+
+	logic[63:0]		upstream_frames	= 0;
+	logic[63:0]		upstream_bytes	= 0;
+
+	always_ff @(posedge rx_clk) begin
+		if(upstream_drop) begin
+			upstream_frames	<= upstream_frames + 1;
+			upstream_bytes	<= upstream_bytes + upstream_drop_len;
+		end
+
+		if(clear_rx) begin
+			upstream_frames	<= 0;
+			upstream_bytes	<= 0;
+		end
+	end
+
+	pathstats_t		stats_total;
+
+	always_comb begin
+		stats_total				= stats;
+		stats_total.drop_frames	= stats.drop_frames + upstream_frames;
+		stats_total.drop_bytes	= stats.drop_bytes + upstream_bytes;
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// The actual clock crossing
+
+	EthernetCrossoverClockCrossing_x8 crossing(
+		.rx_clk(rx_clk),
+		.rx_bus(fifo_bus),
+		.rx_rst(rx_rst),
+
+		.tx_clk(tx_clk),
+		.tx_rst(tx_rst),
+		.tx_ready(tx_ready),
+		.tx_bus(tx_bus)
+		);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Snapshot bank
+
+	RegisterSynchronizer #(
+		.WIDTH($bits(pathstats_t))
+	) sync_snapshot_data (
+		.clk_a(rx_clk),
+		.en_a(snapshot_rx),
+		.ack_a(),
+		.reg_a(stats_total),
+
+		.clk_b(tx_clk),
+		.updated_b(snapshot_done),
+		.reset_b(1'b0),
+		.reg_b(snapshot_data)
+	);
+
+endmodule
@@ -0,0 +1,295 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@brief FIFO of MDIO operations executed back to back on the PHY management buses
+
+	Each command is 32 bits:
+		[31:30]	opcode
+		[25:24]	port number
+		[23:16]	opcode specific
+		[15:0]	opcode specific
+
+	Opcodes:
+		0 = read
+			[20:16]	register address
+		1 = write
+			[20:16]	register address
+			[15:0]	write data
+		2 = MMD address setup (three writes: MMD_CTRL = mmd, MMD_DATA = register, MMD_CTRL = mode | mmd)
+			[23:22]	access mode for following data accesses (1 = no increment, 2 = post increment on read/write,
+					3 = post increment on write only)
+			[20:16]	MMD index
+			[15:0]	register address within the MMD
+		3 = MMD data read burst (reads MMD_DATA repeatedly)
+			[7:0]	number of reads (0 is treated as 1)
+
+	Commands are issued in order. Each port has its own MDIO bus, so a transaction is issued as soon as the bus it
+	targets is idle: commands to different ports execute concurrently, commands to the same port execute in order.
+
+	Every MDIO read produces one 16-bit result. Results are stored in the order the reads appear in the queue
+	regardless of the order they complete in (writes do not produce results). done_count counts whole commands, so
+	an MMD setup or burst only counts once all of its transactions have completed.
+ */
+module MDIOCommandQueue #(
+	parameter DEPTH			= 32,
+	parameter ADDR_BITS		= $clog2(DEPTH),
+	parameter RESULT_DEPTH	= 256,
+	parameter RESULT_BITS	= $clog2(RESULT_DEPTH)
+)(
+	input wire						clk,
+
+	//Command input
+	input wire						clear,
+	input wire						cmd_valid,
+	input wire[31:0]				cmd,
+
+	//Status and result readback
+	output logic[ADDR_BITS:0]		cmd_count		= 0,
+	output logic[ADDR_BITS:0]		done_count		= 0,
+	output wire						active,
+	input wire[RESULT_BITS-1:0]		result_addr,
+	output wire[15:0]				result_data,
+
+	//Interface to the MDIO transceivers
+	output logic[3:0]				mdio_rd_en		= 0,
+	output logic[3:0]				mdio_wr_en		= 0,
+	output logic[3:0][4:0]			mdio_regaddr	= 0,
+	output logic[3:0][15:0]			mdio_wdata		= 0,
+	input wire[3:0]					mdio_busy,
+	input wire[3:0][15:0]			mdio_rd_data
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Command and result memory
+
+	logic[31:0]	cmds[DEPTH-1:0];
+	logic[15:0]	results[RESULT_DEPTH-1:0];
+
+	logic[ADDR_BITS:0]		rd_ptr		= 0;
+	logic[RESULT_BITS-1:0]	result_ptr	= 0;
+
+	assign result_data = results[result_addr];
+
+	always_ff @(posedge clk) begin
+		if(clear)
+			cmd_count			<= 0;
+		else if(cmd_valid && (cmd_count != DEPTH)) begin
+			cmds[cmd_count[ADDR_BITS-1:0]]	<= cmd;
+			cmd_count			<= cmd_count + 1;
+		end
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Execution state machines (one per port)
+
+	localparam PORT_IDLE		= 2'h0;
+	localparam PORT_WAIT_START	= 2'h1;
+	localparam PORT_WAIT_DONE	= 2'h2;
+	localparam PORT_CAPTURE		= 2'h3;
+
+	logic[1:0]				port_state[3:0];
+	logic[3:0]				port_write		= 0;
+	logic[3:0]				port_last		= 0;
+	logic[RESULT_BITS-1:0]	port_result[3:0];
+	logic[7:0]				port_timeout[3:0];
+
+	initial begin
+		for(integer i=0; i<4; i++) begin
+			port_state[i]	= PORT_IDLE;
+			port_result[i]	= 0;
+			port_timeout[i]	= 0;
+		end
+	end
+
+	//Command at the head of the queue
+	wire		head_valid	= (rd_ptr != cmd_count);
+	wire[31:0]	head		= cmds[rd_ptr[ADDR_BITS-1:0]];
+	wire[1:0]	head_opcode	= head[31:30];
+	wire[1:0]	head_port	= head[25:24];
+
+	localparam OP_READ		= 2'h0;
+	localparam OP_WRITE		= 2'h1;
+	localparam OP_MMD_SETUP	= 2'h2;
+	localparam OP_MMD_READ	= 2'h3;
+
+	localparam REG_MMD_CTRL	= 5'h0d;
+	localparam REG_MMD_DATA	= 5'h0e;
+
+	//Expand the head command into the MDIO transaction for its current step
+	logic[7:0]	head_step	= 0;
+	logic		step_write;
+	logic[4:0]	step_regaddr;
+	logic[15:0]	step_wdata;
+	logic		step_last;
+
+	always_comb begin
+		step_write		= 0;
+		step_regaddr	= head[20:16];
+		step_wdata		= head[15:0];
+		step_last		= 1;
+
+		case(head_opcode)
+
+			OP_WRITE:
+				step_write		= 1;
+
+			OP_MMD_SETUP: begin
+				step_write		= 1;
+				step_last		= (head_step == 2);
+				case(head_step)
+					0: begin
+						step_regaddr	= REG_MMD_CTRL;
+						step_wdata		= { 11'h0, head[20:16] };
+					end
+					1: begin
+						step_regaddr	= REG_MMD_DATA;
+						step_wdata		= head[15:0];
+					end
+					default: begin
+						step_regaddr	= REG_MMD_CTRL;
+						step_wdata		= { head[23:22], 9'h0, head[20:16] };
+					end
+				endcase
+			end
+
+			OP_MMD_READ: begin
+				step_regaddr	= REG_MMD_DATA;
+				step_last		= (head_step + 1 >= head[7:0]);
+			end
+
+			default: begin
+			end
+
+		endcase
+	end
+
+	logic		any_busy;
+	always_comb begin
+		any_busy	= 0;
+		for(integer i=0; i<4; i++) begin
+			if(port_state[i] != PORT_IDLE)
+				any_busy	= 1;
+		end
+	end
+
+	assign active = head_valid || any_busy;
+
+	logic		captured;
+
+	always_ff @(posedge clk) begin
+
+		mdio_rd_en	<= 0;
+		mdio_wr_en	<= 0;
+
+		//Issue the next transaction as soon as its port is free
+		if(head_valid && (port_state[head_port] == PORT_IDLE) ) begin
+			mdio_regaddr[head_port]	<= step_regaddr;
+			mdio_wdata[head_port]	<= step_wdata;
+
+			if(step_write)
+				mdio_wr_en[head_port]	<= 1;
+			else begin
+				mdio_rd_en[head_port]	<= 1;
+				port_result[head_port]	<= result_ptr;
+				result_ptr				<= result_ptr + 1;
+			end
+
+			port_write[head_port]	<= step_write;
+			port_last[head_port]	<= step_last;
+			port_timeout[head_port]	<= 0;
+			port_state[head_port]	<= PORT_WAIT_START;
+
+			//Move on to the next command once every step of this one has been issued
+			if(step_last) begin
+				head_step			<= 0;
+				rd_ptr				<= rd_ptr + 1;
+			end
+			else
+				head_step			<= head_step + 1;
+		end
+
+		//Track completion on each port.
+		//Only one result can be saved per clock, so lowest numbered port wins if several finish at once.
+		captured	= 0;
+		for(integer i=0; i<4; i++) begin
+
+			case(port_state[i])
+
+				//Wait for the transceiver to pick up the request.
+				//If it never goes busy, give up rather than hanging the queue forever.
+				PORT_WAIT_START: begin
+					port_timeout[i]		<= port_timeout[i] + 1;
+					if(mdio_busy[i])
+						port_state[i]	<= PORT_WAIT_DONE;
+					else if(port_timeout[i] == 8'hff)
+						port_state[i]	<= PORT_CAPTURE;
+				end
+
+				PORT_WAIT_DONE: begin
+					if(!mdio_busy[i])
+						port_state[i]	<= PORT_CAPTURE;
+				end
+
+				//Read data has had a cycle to settle, save it
+				PORT_CAPTURE: begin
+					if(!captured) begin
+						captured		= 1;
+
+						if(!port_write[i])
+							results[port_result[i]]	<= mdio_rd_data[i];
+
+						if(port_last[i])
+							done_count	<= done_count + 1;
+						port_state[i]	<= PORT_IDLE;
+					end
+				end
+
+				default: begin
+				end
+
+			endcase
+
+		end
+
+		//Start a new batch
+		if(clear) begin
+			rd_ptr				<= 0;
+			head_step			<= 0;
+			result_ptr			<= 0;
+			done_count			<= 0;
+			for(integer i=0; i<4; i++)
+				port_state[i]	<= PORT_IDLE;
+		end
+
+	end
+
+endmodule
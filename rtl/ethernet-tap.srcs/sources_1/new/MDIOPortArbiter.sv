@@ -0,0 +1,163 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@brief Shares one PHY management bus between the MCU and the background register poller
+
+	Host requests (from direct register access or the command queue) are latched as soon as they arrive and take
+	priority over the poller, so a host transaction waits for at most one poller transaction to finish.
+
+	Read data is latched separately for each requester, so poller traffic never overwrites a value the host has not
+	read yet.
+ */
+module MDIOPortArbiter(
+	input wire				clk,
+
+	//Host side
+	input wire				host_rd_en,
+	input wire				host_wr_en,
+	input wire[4:0]			host_regaddr,
+	input wire[15:0]		host_wdata,
+	output wire				host_busy,
+	output logic			host_done		= 0,
+	output logic[15:0]		host_rd_data	= 0,
+
+	//Poller side (request is held until acknowledged)
+	input wire				poll_req,
+	input wire[4:0]			poll_regaddr,
+	output logic			poll_ack		= 0,
+	output logic			poll_done		= 0,
+	output logic[15:0]		poll_rd_data	= 0,
+
+	//Interface to the MDIO transceiver
+	output logic			mdio_rd_en		= 0,
+	output logic			mdio_wr_en		= 0,
+	output logic[4:0]		mdio_regaddr	= 0,
+	output logic[15:0]		mdio_wdata		= 0,
+	input wire				mdio_busy,
+	input wire[15:0]		mdio_rd_data
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Pending host request
+
+	logic		host_pending	= 0;
+	logic		host_write		= 0;
+	logic[4:0]	host_addr		= 0;
+	logic[15:0]	host_data		= 0;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Bus state machine
+
+	localparam STATE_IDLE		= 2'h0;
+	localparam STATE_WAIT_START	= 2'h1;
+	localparam STATE_WAIT_DONE	= 2'h2;
+	localparam STATE_CAPTURE	= 2'h3;
+
+	logic[1:0]	state			= STATE_IDLE;
+	logic		owner_host		= 0;
+	logic[7:0]	timeout			= 0;
+
+	assign host_busy = host_pending || ( (state != STATE_IDLE) && owner_host );
+
+	always_ff @(posedge clk) begin
+
+		mdio_rd_en		<= 0;
+		mdio_wr_en		<= 0;
+		host_done		<= 0;
+		poll_ack		<= 0;
+		poll_done		<= 0;
+
+		if(host_rd_en || host_wr_en) begin
+			host_pending	<= 1;
+			host_write		<= host_wr_en;
+			host_addr		<= host_regaddr;
+			host_data		<= host_wdata;
+		end
+
+		case(state)
+
+			STATE_IDLE: begin
+
+				if(host_pending) begin
+					host_pending	<= 0;
+					owner_host		<= 1;
+					mdio_regaddr	<= host_addr;
+					mdio_wdata		<= host_data;
+					mdio_rd_en		<= !host_write;
+					mdio_wr_en		<= host_write;
+					timeout			<= 0;
+					state			<= STATE_WAIT_START;
+				end
+
+				else if(poll_req && !poll_ack) begin
+					poll_ack		<= 1;
+					owner_host		<= 0;
+					mdio_regaddr	<= poll_regaddr;
+					mdio_rd_en		<= 1;
+					timeout			<= 0;
+					state			<= STATE_WAIT_START;
+				end
+
+			end
+
+			//Wait for the transceiver to pick up the request, give up if it never goes busy
+			STATE_WAIT_START: begin
+				timeout			<= timeout + 1;
+				if(mdio_busy)
+					state		<= STATE_WAIT_DONE;
+				else if(timeout == 8'hff)
+					state		<= STATE_CAPTURE;
+			end
+
+			STATE_WAIT_DONE: begin
+				if(!mdio_busy)
+					state		<= STATE_CAPTURE;
+			end
+
+			//Read data has had a cycle to settle, hand it to whoever asked for it
+			STATE_CAPTURE: begin
+				if(owner_host) begin
+					host_rd_data	<= mdio_rd_data;
+					host_done		<= 1;
+				end
+				else begin
+					poll_rd_data	<= mdio_rd_data;
+					poll_done		<= 1;
+				end
+				state			<= STATE_IDLE;
+			end
+
+		endcase
+
+	end
+
+endmodule
@@ -51,20 +51,55 @@ module MicrocontrollerInterface(
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Interface to internal FPGA blocks
 
-	output cfgregs_t			cfgregs	= 0,
+	output cfgregs_t			cfgregs,
 
-	output logic[3:0]			mdio_rd_en		= 0,
-	output logic[4:0]			mdio_regaddr	= 0,
 	input wire[15:0]			mdio_eth0_rd_data,
 	input wire[15:0]			mdio_eth1_rd_data,
 	input wire[15:0]			mdio_eth2_rd_data,
 	input wire[15:0]			mdio_eth3_rd_data,
+	input wire[3:0]				mdio_busy,
 
 	input wire[3:0]				link_up,
 	input wire lspeed_t[3:0]	link_speed,
-	input wire[3:0]				link_updated
+	input wire[3:0]				link_updated,
+
+	output logic				stats_snapshot	= 0,
+
+	output logic[1:0]			rmon_clear		= 0,
+	input wire rmon_counters_t[1:0]	rmon_snapshot_data,
+	input wire rmon_histogram_t[1:0]	rmon_histogram_data,
+	input wire[1:0]				rmon_snapshot_done,
+
+	output logic[3:0]			path_clear		= 0,
+	input wire pathstats_t[3:0]	path_snapshot_data,
+	input wire[3:0]				path_snapshot_done,
+
+	output logic				timestamp_set_en	= 0,
+	output logic[63:0]			timestamp_set_value	= 0,
+	input wire[63:0]			timestamp_ns,
+
+	output logic				filter_wr_en		= 0,
+	output logic[5:0]			filter_wr_addr		= 0,
+	output logic[287:0]			filter_wr_data		= 0,
+	output logic				filter_clear		= 0,
+	input wire filterhits_t[1:0]	filter_hits,
+	input wire samplestats_t[1:0]	sample_stats,
+	input wire[1:0]				filter_hits_done,
+	output logic				sample_clear		= 0
 );
 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Configuration register defaults
+
+	//Same MDC rate as EthernetMDIOTransceiver until firmware picks something faster
+	localparam MDIO_CLKDIV_DEFAULT = 8'd30;
+
+	initial begin
+		cfgregs = 0;
+		for(integer i=0; i<4; i++)
+			cfgregs.mdio_clkdiv[i] = MDIO_CLKDIV_DEFAULT;
+	end
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// QSPI interface
 
@@ -78,6 +113,8 @@ module MicrocontrollerInterface(
 	logic		rd_valid	= 0;
 	logic[7:0]	rd_data;
 
+	logic[15:0] count = 0;
+
 	QSPIDeviceInterface #(
 		.INSN_BYTES(2)
 	) qspi (
@@ -130,44 +167,341 @@ module MicrocontrollerInterface(
 										//IRQ line cleared on read
 
 		REG_TRIG_MUX		= 16'h0003,
+		REG_MDIO_BATCH		= 16'h0004,	//W: list of 4-byte MDIO commands, executed in order. Writing resets the queue.
+										//   byte 0 [7:6] opcode, [1:0] port
+										//     0 = read, 1 = write, 2 = MMD address setup, 3 = MMD data read burst
+										//   byte 1 [7:6] MMD access mode (setup only)
+										//          [4:0] register address, or MMD index for setup
+										//   byte 2-3 little endian write data, MMD register address, or burst length
+										//   (see MDIOCommandQueue for details)
+		REG_MDIO_BATCH_STAT	= 16'h0005,	//R: byte 0 number of commands completed
+										//   byte 1 [0] queue busy
+		REG_MDIO_BATCH_RD	= 16'h0006,	//R: 16 bit little endian read data for each MDIO read, in order (max 256)
+		REG_MDIO_RD_ALL		= 16'h0007,	//W: [4:0] register to read on all four ports at once
+		REG_MDIO_WR_ALL		= 16'h0008,	//W: byte 0 reg addr
+										//   byte 1-2 little endian write data, written to all four ports at once
+		REG_MDIO_RDATA_ALL	= 16'h0009,	//R: 16 bit little endian read data for eth0, eth1, eth2, eth3
+		REG_MDIO_STATUS		= 16'h000a,	//R: [7:4] transaction completed since last read, per port
+										//   [3:0] transaction in progress, per port
+										//MDIO IRQ cause cleared on read
+		REG_IRQ_STATUS		= 16'h000b,	//R: [2] shadowed PHY register changed
+										//   [1] MDIO transaction completed
+										//   [0] link state changed
+		REG_IRQ_ENABLE		= 16'h000c,	//W: mask of IRQ causes allowed to assert the IRQ line (same bits as status)
+		REG_MDIO_SHADOW		= 16'h000d,	//R: 16 bit little endian shadow register values, 8 slots per port
+										//   starting with eth0 slot 0
+		REG_MDIO_SHADOW_CHANGED	= 16'h000e,	//R: [3:0] shadowed value changed since last read, per port
+										//PHY shadow IRQ cause cleared on read
+		REG_MDIO_POLL_CFG	= 16'h000f,	//W: byte 0 [3:0] ports to poll
+										//   byte 1 number of registers to poll (max 8)
+										//   byte 2-9 register addresses
+		REG_STATS_SNAPSHOT	= 16'h0010,	//W: any single byte. Copies the RMON counters of both tap ports, the
+										//   size histograms of both tap ports, the overflow statistics of every path, and
+										//   the filter hit and sampling counters into the snapshot banks
+		REG_STATS_CLEAR		= 16'h0011,	//W: [1:0] ports whose RMON counters and size histogram should be zeroed
+										//   [5:2] paths whose overflow statistics should be zeroed
+										//   [6] zero the filter hit counters
+										//   [7] zero the sampling counters
+		REG_RMON_COUNTERS	= 16'h0012,	//R: byte 0 [1:0] snapshot still in progress, per port
+										//   then 64 bytes per port (eth0, eth1): eight 64 bit little endian counters
+										//   in rmon_index_t order, slots 6-7 reserved
+		REG_PATH_STATS		= 16'h0013,	//R: byte 0 [3:0] snapshot still in progress, per path
+										//   then 32 bytes per path (A->B, B->A, A->monA, B->monB), little endian:
+										//   0-7 dropped frames, 8-15 dropped bytes, 16-17 FIFO high water mark,
+										//   18-19 FIFO size, rest reserved
+		REG_MONITOR_CFG		= 16'h0014,	//W: byte 0 [0] aggregate both directions onto monA
+										//          [2:1] direction tag (montag_t)
+										//          [3] append arrival timestamp
+										//          [5:4] action for frames no filter rule matches (filteraction_t)
+										//   byte 1-2 little endian VLAN ID for frames received on porta
+										//   byte 3-4 little endian VLAN ID for frames received on portb
+		REG_MONITOR_SNAPLEN	= 16'h0015,	//W: 3 bytes for frames received on porta, then 3 for portb:
+										//   byte 0-1 little endian snap length (0 = no truncation)
+										//   byte 2 [0] cut at end of L4 header, [1] append original length
+		REG_TIMESTAMP_SET	= 16'h0016,	//W: 64 bit little endian nanosecond count, loaded when the last byte arrives
+		REG_TIMESTAMP		= 16'h0017,	//R: 64 bit little endian nanosecond count, as of the start of the read
+		REG_FILTER_RULE		= 16'h0018,	//W: byte 0 [3:0] rule index
+										//   byte 1 [1:0] action (filteraction_t)
+										//   then for each 144 bit row of filterkey_t: 18 byte value, 18 byte mask,
+										//   both big endian. FILTER_OFF takes effect right away, anything else once
+										//   all three rows are written.
+		REG_FILTER_HITS		= 16'h0019,	//R: byte 0 [1:0] snapshot still in progress, per port
+										//   then 64 bytes per port (eth0, eth1): 32 bit little endian hit count for
+										//   each rule
+		REG_MONITOR_SAMPLE	= 16'h001a,	//W: 8 bytes for frames received on porta, then 8 for portb:
+										//   byte 0 [1:0] mode (samplemode_t)
+										//   byte 1-3 little endian N for SAMPLE_COUNT
+										//   byte 4-7 little endian threshold for SAMPLE_RANDOM / SAMPLE_FLOW, a frame
+										//   is kept if its random number or flow hash is at or below it
+		REG_SAMPLE_STATS	= 16'h001b,	//R: byte 0 [1:0] snapshot still in progress, per port (same as REG_FILTER_HITS)
+										//   then 16 bytes per port (eth0, eth1): 64 bit little endian count of frames
+										//   kept, then skipped
+		REG_RMON_HISTOGRAM	= 16'h001c,	//R: byte 0 [1:0] snapshot still in progress, per port (same as REG_RMON_COUNTERS)
+										//   then 64 bytes per port (eth0, eth1): eight 64 bit little endian frame
+										//   counts in rmon_bin_t order
 
 		REG_ETH0_RST		= 16'h1000,	//W: [0] active low reset flag
 		REG_ETH0_MDIO_RADDR	= 16'h1001,	//W: [4:0] read register access. Operation is dispatched on completion of write
 		REG_ETH0_MDIO_RDATA	= 16'h1002, //R: 16 bit little endian read data
 		REG_ETH0_MDIO_WR	= 16'h1003,	//W: byte 0 reg addr
 										//   byte 1-2 little endian write data
+		REG_ETH0_MDIO_CFG	= 16'h1004,	//W: byte 0 MDC half period in 8ns cycles, minus one (default 30, ~2 MHz)
+										//   byte 1 [0] preamble suppression
 
 		REG_ETH1_RST		= 16'h2000,	//descriptions as in eth0
 		REG_ETH1_MDIO_RADDR	= 16'h2001,
 		REG_ETH1_MDIO_RDATA	= 16'h2002,
 		REG_ETH1_MDIO_WR	= 16'h2003,
+		REG_ETH1_MDIO_CFG	= 16'h2004,
 
 		REG_ETH2_RST		= 16'h3000,	//descriptions as in eth0
 		REG_ETH2_MDIO_RADDR	= 16'h3001,
 		REG_ETH2_MDIO_RDATA	= 16'h3002,
 		REG_ETH2_MDIO_WR	= 16'h3003,
+		REG_ETH2_MDIO_CFG	= 16'h3004,
 
 		REG_ETH3_RST		= 16'h4000,	//descriptions as in eth0
 		REG_ETH3_MDIO_RADDR	= 16'h4001,
 		REG_ETH3_MDIO_RDATA	= 16'h4002,
-		REG_ETH3_MDIO_WR	= 16'h4003
+		REG_ETH3_MDIO_WR	= 16'h4003,
+		REG_ETH3_MDIO_CFG	= 16'h4004
 
 	} opcode_t;
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Main QSPI state machine
+	// Background PHY register poller
+
+	logic[3:0]			poll_port_en	= 0;
+	logic[3:0]			poll_reg_count	= 0;
+	logic[7:0][4:0]		poll_reg_addrs	= 0;
+
+	wire[15:0]			poll_shadow_data;
+	wire				poll_changed;
+	wire[3:0]			poll_changed_now;
+	logic[3:0]			poll_changed_ports	= 0;
+
+	wire[3:0]			poll_req;
+	wire[3:0][4:0]		poll_regaddr;
+	wire[3:0]			poll_ack;
+	wire[3:0]			poll_done;
+	wire[3:0][15:0]		poll_rd_data;
+
+	PhyRegisterPoller #(
+		.NUM_REGS(8)
+	) poller (
+		.clk(clk_125mhz),
 
-	logic[15:0] count = 0;
+		.port_en(poll_port_en),
+		.reg_count(poll_reg_count),
+		.reg_addrs(poll_reg_addrs),
+
+		.shadow_port(count[5:4]),
+		.shadow_slot(count[3:1]),
+		.shadow_data(poll_shadow_data),
+
+		.changed(poll_changed),
+		.changed_ports(poll_changed_now),
+
+		.poll_req(poll_req),
+		.poll_regaddr(poll_regaddr),
+		.poll_ack(poll_ack),
+		.poll_done(poll_done),
+		.poll_rd_data(poll_rd_data)
+	);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Arbitration between host and poller on each MDIO bus
+
+	//Requests from the MCU (direct register access or command queue)
+	logic[3:0]			host_mdio_rd_en		= 0;
+	logic[3:0]			host_mdio_wr_en		= 0;
+	logic[3:0][4:0]		host_mdio_regaddr	= 0;
+	logic[3:0][15:0]	host_mdio_wdata		= 0;
+
+	wire[3:0]			host_busy;
+	wire[3:0]			host_done;
+	wire[3:0][15:0]		host_rd_data;
+
+	wire[3:0]			arb_rd_en;
+	wire[3:0]			arb_wr_en;
+	wire[3:0][4:0]		arb_regaddr;
+	wire[3:0][15:0]		arb_wdata;
+
+	wire[15:0]			mdio_rd_data[3:0];
+	assign mdio_rd_data[0] = mdio_eth0_rd_data;
+	assign mdio_rd_data[1] = mdio_eth1_rd_data;
+	assign mdio_rd_data[2] = mdio_eth2_rd_data;
+	assign mdio_rd_data[3] = mdio_eth3_rd_data;
+
+	for(genvar g=0; g<4; g=g+1) begin : arbiters
+		MDIOPortArbiter arb(
+			.clk(clk_125mhz),
+
+			.host_rd_en(host_mdio_rd_en[g]),
+			.host_wr_en(host_mdio_wr_en[g]),
+			.host_regaddr(host_mdio_regaddr[g]),
+			.host_wdata(host_mdio_wdata[g]),
+			.host_busy(host_busy[g]),
+			.host_done(host_done[g]),
+			.host_rd_data(host_rd_data[g]),
+
+			.poll_req(poll_req[g]),
+			.poll_regaddr(poll_regaddr[g]),
+			.poll_ack(poll_ack[g]),
+			.poll_done(poll_done[g]),
+			.poll_rd_data(poll_rd_data[g]),
+
+			.mdio_rd_en(arb_rd_en[g]),
+			.mdio_wr_en(arb_wr_en[g]),
+			.mdio_regaddr(arb_regaddr[g]),
+			.mdio_wdata(arb_wdata[g]),
+			.mdio_busy(mdio_busy[g]),
+			.mdio_rd_data(mdio_rd_data[g])
+		);
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// MDIO command queue
+
+	logic		queue_clear		= 0;
+	logic		queue_cmd_valid	= 0;
+	logic[31:0]	queue_cmd		= 0;
+
+	wire[5:0]	queue_done_count;
+	wire		queue_active;
+	wire[15:0]	queue_result;
+
+	wire[3:0]			queue_rd_en;
+	wire[3:0]			queue_wr_en;
+	wire[3:0][4:0]		queue_regaddr;
+	wire[3:0][15:0]		queue_wdata;
+
+	MDIOCommandQueue #(
+		.DEPTH(32),
+		.RESULT_DEPTH(256)
+	) mdio_queue (
+		.clk(clk_125mhz),
+
+		.clear(queue_clear),
+		.cmd_valid(queue_cmd_valid),
+		.cmd(queue_cmd),
+
+		.cmd_count(),
+		.done_count(queue_done_count),
+		.active(queue_active),
+		.result_addr(count[8:1]),
+		.result_data(queue_result),
+
+		.mdio_rd_en(queue_rd_en),
+		.mdio_wr_en(queue_wr_en),
+		.mdio_regaddr(queue_regaddr),
+		.mdio_wdata(queue_wdata),
+		.mdio_busy(host_busy),
+		.mdio_rd_data(host_rd_data)
+	);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Statistics snapshots
+
+	logic[1:0]	rmon_pending	= 0;
+	logic[3:0]	path_pending	= 0;
+	logic[1:0]	filter_pending	= 0;
+
+	//Byte of the snapshot bank being read (after the status byte)
+	logic[63:0]	timestamp_latched	= 0;
+
+	wire[15:0]	rmon_idx		= count - 1;
+	wire		rmon_port		= rmon_idx[6];
+	wire[2:0]	rmon_slot		= rmon_idx[5:3];
+	wire[2:0]	rmon_byte		= rmon_idx[2:0];
+
+	wire[1:0]	path_sel		= rmon_idx[6:5];
+	wire[4:0]	path_byte		= rmon_idx[4:0];
+
+	wire[3:0]	filter_rule		= rmon_idx[5:2];
+	wire[1:0]	filter_byte		= rmon_idx[1:0];
+
+	wire		sample_port		= rmon_idx[4];
+	wire[3:0]	sample_byte		= rmon_idx[3:0];
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Filter rule staging
+
+	logic[3:0]		filter_idx			= 0;
+	filteraction_t	filter_rule_action	= FILTER_OFF;	//applied once all rows are written
+	logic[1:0]		filter_row			= 0;
+	logic[5:0]		filter_row_byte		= 0;	//of the 36 in a row
+	logic[279:0]	filter_row_data		= 0;	//everything but the last byte of the row
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Interrupt causes
+
+	logic		irq_link		= 0;
+	logic		irq_mdio		= 0;
+	logic		irq_poll		= 0;
+	logic[2:0]	irq_enable		= 3'b001;
+
+	//Registered so the edge triggered MCU input never sees a glitch
+	always_ff @(posedge clk_125mhz) begin
+		irq <= (irq_link && irq_enable[0]) || (irq_mdio && irq_enable[1]) || (irq_poll && irq_enable[2]);
+	end
+
+	//MDIO completion tracking (host transactions only, poller traffic is invisible to the MCU)
+	logic[3:0]	mdio_done		= 0;
+	wire[3:0]	mdio_done_now	= host_done;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Main QSPI state machine
 
 	always_ff @(posedge clk_125mhz) begin
 
 		rd_valid					<= 0;
-		cfgregs.mdio_rd_en			<= 0;
-		cfgregs.mdio_wr_en			<= 0;
+		queue_clear					<= 0;
+		queue_cmd_valid				<= 0;
+		stats_snapshot				<= 0;
+		rmon_clear					<= 0;
+		path_clear					<= 0;
+		timestamp_set_en			<= 0;
+		filter_wr_en				<= 0;
+		filter_clear				<= 0;
+		sample_clear				<= 0;
+
+		//Snapshots land in each bank independently
+		rmon_pending				<= rmon_pending & ~rmon_snapshot_done;
+		path_pending				<= path_pending & ~path_snapshot_done;
+		filter_pending				<= filter_pending & ~filter_hits_done;
+
+		//Forward MDIO operations from the command queue
+		host_mdio_rd_en				<= queue_rd_en;
+		host_mdio_wr_en				<= queue_wr_en;
+		for(integer i=0; i<4; i++) begin
+			if(queue_rd_en[i] || queue_wr_en[i]) begin
+				host_mdio_regaddr[i]	<= queue_regaddr[i];
+				host_mdio_wdata[i]		<= queue_wdata[i];
+			end
+		end
+
+		//Forward arbitrated MDIO operations to the transceivers
+		cfgregs.mdio_rd_en			<= arb_rd_en;
+		cfgregs.mdio_wr_en			<= arb_wr_en;
+		cfgregs.mdio_regaddr		<= arb_regaddr;
+		cfgregs.mdio_wdata			<= arb_wdata;
 
 		//Set IRQ flag if any link state changes
 		if(link_updated)
-			irq						<= 1;
+			irq_link				<= 1;
+
+		//Set IRQ flag if any MDIO transaction completes
+		if(mdio_done_now) begin
+			mdio_done				<= mdio_done | mdio_done_now;
+			irq_mdio				<= 1;
+		end
+
+		//Set IRQ flag if any shadowed PHY register changes
+		if(poll_changed) begin
+			poll_changed_ports		<= poll_changed_ports | poll_changed_now;
+			irq_poll				<= 1;
+		end
 
 		//Output read data
 		if(rd_ready) begin
@@ -178,11 +512,108 @@ module MicrocontrollerInterface(
 
 				REG_FPGA_IDCODE:		rd_data <= idcode[(3 - count[1:0])*8 +: 8];
 				REG_FPGA_SERIAL:		rd_data <= die_serial[(7 - count[2:0])*8 +: 8];
+				REG_TIMESTAMP:			rd_data <= timestamp_latched[count[2:0]*8 +: 8];
+
+				REG_ETH0_MDIO_RDATA:	rd_data <= host_rd_data[0][count[0]*8 +: 8];
+				REG_ETH1_MDIO_RDATA:	rd_data <= host_rd_data[1][count[0]*8 +: 8];
+				REG_ETH2_MDIO_RDATA:	rd_data <= host_rd_data[2][count[0]*8 +: 8];
+				REG_ETH3_MDIO_RDATA:	rd_data <= host_rd_data[3][count[0]*8 +: 8];
+
+				REG_MDIO_BATCH_STAT: begin
+					if(count == 0)
+						rd_data	<= queue_done_count;
+					else
+						rd_data	<= { 7'h0, queue_active };
+				end
+				REG_MDIO_BATCH_RD:		rd_data <= queue_result[count[0]*8 +: 8];
+
+				REG_MDIO_STATUS: begin
+					if(count == 0) begin
+						rd_data		<= { mdio_done, host_busy };
+						mdio_done	<= mdio_done_now;
+						irq_mdio	<= (mdio_done_now != 0);
+					end
+					else
+						rd_data		<= 8'h0;
+				end
+
+				REG_IRQ_STATUS:			rd_data <= (count == 0) ? { 5'h0, irq_poll, irq_mdio, irq_link } : 8'h0;
+
+				REG_MDIO_SHADOW:		rd_data <= poll_shadow_data[count[0]*8 +: 8];
+
+				REG_MDIO_SHADOW_CHANGED: begin
+					if(count == 0) begin
+						rd_data				<= { 4'h0, poll_changed_ports };
+						poll_changed_ports	<= poll_changed ? poll_changed_now : 4'h0;
+						irq_poll			<= poll_changed;
+					end
+					else
+						rd_data				<= 8'h0;
+				end
+
+				REG_RMON_COUNTERS: begin
+					if(count == 0)
+						rd_data	<= { 6'h0, rmon_pending };
+					else if( (rmon_idx < 128) && (rmon_slot < RMON_COUNT) )
+						rd_data	<= rmon_snapshot_data[rmon_port][rmon_slot][rmon_byte*8 +: 8];
+					else
+						rd_data	<= 8'h0;
+				end
+
+				REG_RMON_HISTOGRAM: begin
+					if(count == 0)
+						rd_data	<= { 6'h0, rmon_pending };
+					else if(rmon_idx < 128)
+						rd_data	<= rmon_histogram_data[rmon_port][rmon_slot][rmon_byte*8 +: 8];
+					else
+						rd_data	<= 8'h0;
+				end
+
+				REG_PATH_STATS: begin
+					if(count == 0)
+						rd_data	<= { 4'h0, path_pending };
+					else if(rmon_idx >= 128)
+						rd_data	<= 8'h0;
+					else if(path_byte < 8)
+						rd_data	<= path_snapshot_data[path_sel].drop_frames[path_byte[2:0]*8 +: 8];
+					else if(path_byte < 16)
+						rd_data	<= path_snapshot_data[path_sel].drop_bytes[path_byte[2:0]*8 +: 8];
+					else if(path_byte < 18)
+						rd_data	<= path_snapshot_data[path_sel].high_water[path_byte[0]*8 +: 8];
+					else if(path_byte < 20)
+						rd_data	<= path_snapshot_data[path_sel].fifo_size[path_byte[0]*8 +: 8];
+					else
+						rd_data	<= 8'h0;
+				end
+
+				REG_FILTER_HITS: begin
+					if(count == 0)
+						rd_data	<= { 6'h0, filter_pending };
+					else if(rmon_idx < 128)
+						rd_data	<= filter_hits[rmon_port][filter_rule][filter_byte*8 +: 8];
+					else
+						rd_data	<= 8'h0;
+				end
 
-				REG_ETH0_MDIO_RDATA:	rd_data <= mdio_eth0_rd_data[count[0]*8 +: 8];
-				REG_ETH1_MDIO_RDATA:	rd_data <= mdio_eth1_rd_data[count[0]*8 +: 8];
-				REG_ETH2_MDIO_RDATA:	rd_data <= mdio_eth2_rd_data[count[0]*8 +: 8];
-				REG_ETH3_MDIO_RDATA:	rd_data <= mdio_eth3_rd_data[count[0]*8 +: 8];
+				REG_SAMPLE_STATS: begin
+					if(count == 0)
+						rd_data	<= { 6'h0, filter_pending };
+					else if(rmon_idx >= 32)
+						rd_data	<= 8'h0;
+					else if(sample_byte < 8)
+						rd_data	<= sample_stats[sample_port].kept[sample_byte[2:0]*8 +: 8];
+					else
+						rd_data	<= sample_stats[sample_port].skipped[sample_byte[2:0]*8 +: 8];
+				end
+
+				REG_MDIO_RDATA_ALL: begin
+					case(count[2:1])
+						0:	rd_data <= host_rd_data[0][count[0]*8 +: 8];
+						1:	rd_data <= host_rd_data[1][count[0]*8 +: 8];
+						2:	rd_data <= host_rd_data[2][count[0]*8 +: 8];
+						3:	rd_data <= host_rd_data[3][count[0]*8 +: 8];
+					endcase
+				end
 
 				REG_LINK_STATE: begin
 					case(count)
@@ -192,7 +623,7 @@ module MicrocontrollerInterface(
 
 						1: begin
 							rd_data		<= { link_up[3], 1'b0, link_speed[3], link_up[2], 1'b0, link_speed[2] };
-							irq		<= 0;
+							irq_link	<= 0;
 						end
 
 						default:	rd_data <= 8'h0;
@@ -213,10 +644,26 @@ module MicrocontrollerInterface(
 
 				REG_FPGA_IDCODE:		rd_mode	<= 1;
 				REG_FPGA_SERIAL:		rd_mode	<= 1;
+				REG_TIMESTAMP: begin
+					rd_mode				<= 1;
+					timestamp_latched	<= timestamp_ns;
+				end
 				REG_ETH0_MDIO_RDATA:	rd_mode <= 1;
 				REG_ETH1_MDIO_RDATA:	rd_mode <= 1;
 				REG_ETH2_MDIO_RDATA:	rd_mode <= 1;
 				REG_ETH3_MDIO_RDATA:	rd_mode <= 1;
+				REG_MDIO_BATCH_STAT:	rd_mode <= 1;
+				REG_MDIO_BATCH_RD:		rd_mode <= 1;
+				REG_MDIO_RDATA_ALL:		rd_mode <= 1;
+				REG_MDIO_STATUS:		rd_mode <= 1;
+				REG_IRQ_STATUS:			rd_mode <= 1;
+				REG_MDIO_SHADOW:		rd_mode <= 1;
+				REG_MDIO_SHADOW_CHANGED:	rd_mode <= 1;
+				REG_RMON_COUNTERS:		rd_mode <= 1;
+				REG_RMON_HISTOGRAM:		rd_mode <= 1;
+				REG_PATH_STATS:			rd_mode <= 1;
+				REG_FILTER_HITS:		rd_mode <= 1;
+				REG_SAMPLE_STATS:		rd_mode <= 1;
 				REG_LINK_STATE:	rd_mode <= 1;
 
 				//Reset count during read operations
@@ -235,6 +682,139 @@ module MicrocontrollerInterface(
 			case(insn)
 
 				REG_TRIG_MUX: cfgregs.trig_mux	<= wr_data;
+				REG_IRQ_ENABLE: irq_enable		<= wr_data[2:0];
+
+				REG_MDIO_POLL_CFG: begin
+					case(count)
+						0:			poll_port_en			<= wr_data[3:0];
+						1:			poll_reg_count			<= (wr_data > 8) ? 4'd8 : wr_data[3:0];
+						default: begin
+							if(count < 10)
+								poll_reg_addrs[count - 2]	<= wr_data[4:0];
+						end
+					endcase
+				end
+
+				REG_STATS_SNAPSHOT: begin
+					if(count == 0) begin
+						stats_snapshot	<= 1;
+						rmon_pending	<= 2'b11;
+						path_pending	<= 4'b1111;
+						filter_pending	<= 2'b11;
+					end
+				end
+
+				REG_MONITOR_CFG: begin
+					case(count)
+						0: begin
+							cfgregs.moncfg.aggregate	<= wr_data[0];
+							cfgregs.moncfg.tag_mode		<= montag_t'(wr_data[2:1]);
+							cfgregs.moncfg.timestamp	<= wr_data[3];
+							cfgregs.moncfg.filter_default	<= filteraction_t'(wr_data[5:4]);
+						end
+						1:	cfgregs.moncfg.vlan_id[0][7:0]	<= wr_data;
+						2:	cfgregs.moncfg.vlan_id[0][11:8]	<= wr_data[3:0];
+						3:	cfgregs.moncfg.vlan_id[1][7:0]	<= wr_data;
+						4:	cfgregs.moncfg.vlan_id[1][11:8]	<= wr_data[3:0];
+						default: begin
+						end
+					endcase
+				end
+
+				REG_TIMESTAMP_SET: begin
+					if(count < 8)
+						timestamp_set_value[count[2:0]*8 +: 8]	<= wr_data;
+					if(count == 7)
+						timestamp_set_en						<= 1;
+				end
+
+				REG_MONITOR_SNAPLEN: begin
+					case(count)
+						0:	cfgregs.moncfg.snaplen[0][7:0]	<= wr_data;
+						1:	cfgregs.moncfg.snaplen[0][15:8]	<= wr_data;
+						2: begin
+							cfgregs.moncfg.snap_header[0]	<= wr_data[0];
+							cfgregs.moncfg.snap_trailer[0]	<= wr_data[1];
+						end
+						3:	cfgregs.moncfg.snaplen[1][7:0]	<= wr_data;
+						4:	cfgregs.moncfg.snaplen[1][15:8]	<= wr_data;
+						5: begin
+							cfgregs.moncfg.snap_header[1]	<= wr_data[0];
+							cfgregs.moncfg.snap_trailer[1]	<= wr_data[1];
+						end
+						default: begin
+						end
+					endcase
+				end
+
+				REG_MONITOR_SAMPLE: begin
+					if(count < 16) begin
+						case(count[2:0])
+							0:	cfgregs.moncfg.sample_mode[count[3]]		<= samplemode_t'(wr_data[1:0]);
+							1:	cfgregs.moncfg.sample_rate[count[3]][7:0]	<= wr_data;
+							2:	cfgregs.moncfg.sample_rate[count[3]][15:8]	<= wr_data;
+							3:	cfgregs.moncfg.sample_rate[count[3]][23:16]	<= wr_data;
+							default:
+								cfgregs.moncfg.sample_threshold[count[3]][(count[2:0] - 4)*8 +: 8]	<= wr_data;
+						endcase
+					end
+				end
+
+				REG_STATS_CLEAR: begin
+					rmon_clear		<= wr_data[1:0];
+					path_clear		<= wr_data[5:2];
+					filter_clear	<= wr_data[6];
+					sample_clear	<= wr_data[7];
+				end
+
+				REG_FILTER_RULE: begin
+					case(count)
+						0:	filter_idx	<= wr_data[3:0];
+
+						1: begin
+							filter_rule_action	<= filteraction_t'(wr_data[1:0]);
+							filter_row			<= 0;
+							filter_row_byte		<= 0;
+
+							if(filteraction_t'(wr_data[1:0]) == FILTER_OFF)
+								cfgregs.moncfg.filter_action[filter_idx]	<= FILTER_OFF;
+						end
+
+						//Rule rows, each written to the table as soon as it's complete
+						default: begin
+							if(count < 110) begin
+								filter_row_data		<= { filter_row_data[271:0], wr_data };
+								filter_row_byte		<= filter_row_byte + 1;
+
+								if(filter_row_byte == 35) begin
+									filter_wr_en		<= 1;
+									filter_wr_addr		<= { filter_idx, 1'b0 } + filter_idx + filter_row;
+									filter_wr_data		<= { filter_row_data, wr_data };
+									filter_row			<= filter_row + 1;
+									filter_row_byte		<= 0;
+
+									if(filter_row == 2)
+										cfgregs.moncfg.filter_action[filter_idx]	<= filter_rule_action;
+								end
+							end
+						end
+					endcase
+				end
+
+				REG_MDIO_BATCH: begin
+					if(count == 0)
+						queue_clear		<= 1;
+
+					case(count[1:0])
+						0: queue_cmd[31:24]	<= wr_data;
+						1: queue_cmd[23:16]	<= wr_data;
+						2: queue_cmd[7:0]	<= wr_data;
+						3: begin
+							queue_cmd[15:8]	<= wr_data;
+							queue_cmd_valid	<= 1;
+						end
+					endcase
+				end
 
 				REG_ETH0_RST: cfgregs.phy_rst_n[0] <= wr_data[0];
 				REG_ETH1_RST: cfgregs.phy_rst_n[1] <= wr_data[0];
@@ -242,66 +822,112 @@ module MicrocontrollerInterface(
 				REG_ETH3_RST: cfgregs.phy_rst_n[3] <= wr_data[0];
 
 				REG_ETH0_MDIO_RADDR: begin
-					cfgregs.mdio_regaddr	<= wr_data[4:0];
-					cfgregs.mdio_rd_en[0]	<= 1;
+					host_mdio_regaddr[0]	<= wr_data[4:0];
+					host_mdio_rd_en[0]	<= 1;
 				end
 				REG_ETH1_MDIO_RADDR: begin
-					cfgregs.mdio_regaddr	<= wr_data[4:0];
-					cfgregs.mdio_rd_en[1]	<= 1;
+					host_mdio_regaddr[1]	<= wr_data[4:0];
+					host_mdio_rd_en[1]	<= 1;
 				end
 				REG_ETH2_MDIO_RADDR: begin
-					cfgregs.mdio_regaddr	<= wr_data[4:0];
-					cfgregs.mdio_rd_en[2]	<= 1;
+					host_mdio_regaddr[2]	<= wr_data[4:0];
+					host_mdio_rd_en[2]	<= 1;
 				end
 				REG_ETH3_MDIO_RADDR: begin
-					cfgregs.mdio_regaddr	<= wr_data[4:0];
-					cfgregs.mdio_rd_en[3]	<= 1;
+					host_mdio_regaddr[3]	<= wr_data[4:0];
+					host_mdio_rd_en[3]	<= 1;
+				end
+
+				REG_MDIO_RD_ALL: begin
+					for(integer i=0; i<4; i++)
+						host_mdio_regaddr[i]	<= wr_data[4:0];
+					host_mdio_rd_en			<= 4'hf;
+				end
+
+				REG_MDIO_WR_ALL: begin
+					for(integer i=0; i<4; i++) begin
+						case(count)
+							0: host_mdio_regaddr[i]		<= wr_data[4:0];
+							1: host_mdio_wdata[i][7:0]	<= wr_data;
+							2: host_mdio_wdata[i][15:8]	<= wr_data;
+						endcase
+					end
+					if(count == 2)
+						host_mdio_wr_en				<= 4'hf;
 				end
 
 				REG_ETH0_MDIO_WR: begin
 					case(count)
-						0: cfgregs.mdio_regaddr			<= wr_data[4:0];
-						1: cfgregs.mdio_wdata[7:0]		<= wr_data;
+						0: host_mdio_regaddr[0]			<= wr_data[4:0];
+						1: host_mdio_wdata[0][7:0]		<= wr_data;
 						2: begin
-							cfgregs.mdio_wdata[15:8]	<= wr_data;
-							cfgregs.mdio_wr_en[0]		<= 1;
+							host_mdio_wdata[0][15:8]	<= wr_data;
+							host_mdio_wr_en[0]			<= 1;
 						end
 					endcase
 				end
 
 				REG_ETH1_MDIO_WR: begin
 					case(count)
-						0: cfgregs.mdio_regaddr			<= wr_data[4:0];
-						1: cfgregs.mdio_wdata[7:0]		<= wr_data;
+						0: host_mdio_regaddr[1]			<= wr_data[4:0];
+						1: host_mdio_wdata[1][7:0]		<= wr_data;
 						2: begin
-							cfgregs.mdio_wdata[15:8]	<= wr_data;
-							cfgregs.mdio_wr_en[1]		<= 1;
+							host_mdio_wdata[1][15:8]	<= wr_data;
+							host_mdio_wr_en[1]			<= 1;
 						end
 					endcase
 				end
 
 				REG_ETH2_MDIO_WR: begin
 					case(count)
-						0: cfgregs.mdio_regaddr			<= wr_data[4:0];
-						1: cfgregs.mdio_wdata[7:0]		<= wr_data;
+						0: host_mdio_regaddr[2]			<= wr_data[4:0];
+						1: host_mdio_wdata[2][7:0]		<= wr_data;
 						2: begin
-							cfgregs.mdio_wdata[15:8]	<= wr_data;
-							cfgregs.mdio_wr_en[2]		<= 1;
+							host_mdio_wdata[2][15:8]	<= wr_data;
+							host_mdio_wr_en[2]			<= 1;
 						end
 					endcase
 				end
 
 				REG_ETH3_MDIO_WR: begin
 					case(count)
-						0: cfgregs.mdio_regaddr			<= wr_data[4:0];
-						1: cfgregs.mdio_wdata[7:0]		<= wr_data;
+						0: host_mdio_regaddr[3]			<= wr_data[4:0];
+						1: host_mdio_wdata[3][7:0]		<= wr_data;
 						2: begin
-							cfgregs.mdio_wdata[15:8]	<= wr_data;
-							cfgregs.mdio_wr_en[3]		<= 1;
+							host_mdio_wdata[3][15:8]	<= wr_data;
+							host_mdio_wr_en[3]			<= 1;
 						end
 					endcase
 				end
 
+				REG_ETH0_MDIO_CFG: begin
+					case(count)
+						0: cfgregs.mdio_clkdiv[0]				<= wr_data;
+						1: cfgregs.mdio_preamble_suppress[0]	<= wr_data[0];
+					endcase
+				end
+
+				REG_ETH1_MDIO_CFG: begin
+					case(count)
+						0: cfgregs.mdio_clkdiv[1]				<= wr_data;
+						1: cfgregs.mdio_preamble_suppress[1]	<= wr_data[0];
+					endcase
+				end
+
+				REG_ETH2_MDIO_CFG: begin
+					case(count)
+						0: cfgregs.mdio_clkdiv[2]				<= wr_data;
+						1: cfgregs.mdio_preamble_suppress[2]	<= wr_data[0];
+					endcase
+				end
+
+				REG_ETH3_MDIO_CFG: begin
+					case(count)
+						0: cfgregs.mdio_clkdiv[3]				<= wr_data;
+						1: cfgregs.mdio_preamble_suppress[3]	<= wr_data[0];
+					endcase
+				end
+
 			endcase
 
 
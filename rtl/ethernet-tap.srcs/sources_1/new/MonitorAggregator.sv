@@ -0,0 +1,226 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+`include "EthernetBus.svh"
+
+/**
+	@brief Merges the two monitor paths onto monA
+
+	When aggregate is clear, both paths pass straight through to their own ports.
+
+	When it's set, monA carries frames from both FIFOs and monB is idle. Each FIFO reports (via frame_queued, already
+	synchronized into clk) every frame it accepts, and the port number goes into an order queue. The head of the queue
+	says which FIFO gets to send next, so frames go out in the order they finished arriving, and neither direction can
+	starve the other.
+
+	Frames already sitting in the FIFOs when aggregation turns on never got an order queue entry. The aggregator keeps
+	a count of queued frames per FIFO at all times, and on entry to aggregate mode sends that backlog first (all of
+	A's, then all of B's) before following the order queue. Each FIFO is in order, so everything behind the backlog
+	still lines up with its queue entry.
+
+	A frame on the TX bus is a start strobe followed by an unbroken run of data words, so the frame is over on the
+	first cycle after that without data_valid. Every frame counted by frame_queued is in its FIFO and will come out,
+	so a grant waits for the start strobe as long as it takes; giving up would leave the frame in the FIFO and put
+	every later frame out of step with the order queue.
+
+	The combined rate can exceed what monA can carry; excess piles up in the two path FIFOs, and is dropped and counted
+	there once they fill, same as in the normal mode.
+ */
+module MonitorAggregator #(
+	parameter ORDER_DEPTH	= 256		//enough for two full FIFOs of minimum size frames
+)(
+	input wire					clk,
+	input wire					rst,
+	input wire					aggregate,
+
+	//Monitor path FIFOs
+	input wire[1:0]				frame_queued,
+	output logic[1:0]			in_ready,
+	input wire EthernetTxBus	in_bus[1:0],
+
+	//Monitor ports
+	input wire[1:0]				out_ready,
+	output EthernetTxBus		out_bus[1:0]
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Arrival order queue
+
+	localparam ORDER_BITS = $clog2(ORDER_DEPTH);
+
+	logic					order[ORDER_DEPTH-1:0];
+	logic[ORDER_BITS-1:0]	order_wr	= 0;
+	logic[ORDER_BITS-1:0]	order_rd	= 0;
+	logic[ORDER_BITS:0]		order_fill	= 0;
+
+	wire					order_head	= order[order_rd];
+	wire					order_empty	= (order_fill == 0);
+	logic					order_pop;
+
+	//Frames from both sides finishing in the same clock are queued A first
+	wire[1:0]				push		= aggregate ? frame_queued : 2'b00;
+	wire					full		= (order_fill + push[0] + push[1]) > ORDER_DEPTH;
+
+	always_ff @(posedge clk) begin
+
+		if(!full) begin
+			if(push == 2'b11) begin
+				order[order_wr]						<= 0;
+				order[order_wr + 1'b1]				<= 1;
+				order_wr							<= order_wr + 2;
+			end
+			else if(push[0]) begin
+				order[order_wr]						<= 0;
+				order_wr							<= order_wr + 1;
+			end
+			else if(push[1]) begin
+				order[order_wr]						<= 1;
+				order_wr							<= order_wr + 1;
+			end
+		end
+
+		if(order_pop)
+			order_rd	<= order_rd + 1;
+
+		order_fill	<= order_fill + (full ? 0 : (push[0] + push[1])) - order_pop;
+
+		//Both FIFOs get flushed on reset, and a mode change invalidates the queue anyway
+		if(rst || !aggregate) begin
+			order_wr	<= 0;
+			order_rd	<= 0;
+			order_fill	<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Backlog tracking
+
+	logic					aggregate_ff	= 0;
+	//A frame can start on the TX side before its frame_queued gets through the synchronizer, so pending briefly goes
+	//negative in pass-through mode. Half of ORDER_DEPTH is a full FIFO, so the MSB is only set when that happens.
+	logic[ORDER_BITS:0]		pending[1:0];		//frames in each FIFO
+	logic[ORDER_BITS:0]		stale[1:0];			//frames in each FIFO with no order queue entry
+
+	initial begin
+		for(integer i=0; i<2; i++) begin
+			pending[i]	= 0;
+			stale[i]	= 0;
+		end
+	end
+
+	wire					draining	= (stale[0] != 0) || (stale[1] != 0);
+
+	//The FIFO that gets to send next
+	wire					next_port	= draining ? (stale[0] == 0) : order_head;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Grant tracking
+
+	logic				busy		= 0;
+	logic				sel			= 0;
+	logic				saw_data	= 0;
+
+	wire				granting	= !busy && (draining || !order_empty);
+	wire				grant_done	= granting && in_bus[next_port].start;
+
+	always_comb begin
+		order_pop	= grant_done && !draining;
+	end
+
+	always_ff @(posedge clk) begin
+
+		aggregate_ff	<= aggregate;
+
+		for(integer i=0; i<2; i++) begin
+
+			//Frames leave either mode with a start strobe
+			if(in_bus[i].start)
+				pending[i]	<= pending[i] + frame_queued[i] - 1'b1;
+			else
+				pending[i]	<= pending[i] + frame_queued[i];
+
+			//Everything queued before this clock predates the order queue
+			if(aggregate && !aggregate_ff)
+				stale[i]	<= ( (pending[i] == 0) || pending[i][ORDER_BITS]) ? 0 : (pending[i] - in_bus[i].start);
+			else if(grant_done && draining && (next_port == i) )
+				stale[i]	<= stale[i] - 1'b1;
+
+			if(rst)
+				pending[i]	<= 0;
+			if(rst || !aggregate)
+				stale[i]	<= 0;
+
+		end
+
+		if(grant_done) begin
+			busy		<= 1;
+			sel			<= next_port;
+			saw_data	<= 0;
+		end
+
+		if(busy) begin
+			if(in_bus[sel].data_valid)
+				saw_data	<= 1;
+			else if(saw_data)
+				busy		<= 0;
+		end
+
+		if(rst || !aggregate) begin
+			busy		<= 0;
+			saw_data	<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Muxing
+
+	always_comb begin
+
+		if(!aggregate) begin
+			in_ready	= out_ready;
+			out_bus[0]	= in_bus[0];
+			out_bus[1]	= in_bus[1];
+		end
+
+		else begin
+			in_ready	= 0;
+			if(granting)
+				in_ready[next_port]	= out_ready[0];
+
+			out_bus[0]	= (busy || granting) ? in_bus[busy ? sel : next_port] : 0;
+			out_bus[1]	= 0;
+		end
+
+	end
+
+endmodule
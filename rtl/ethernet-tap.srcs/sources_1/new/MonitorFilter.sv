@@ -0,0 +1,755 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+`include "EthernetBus.svh"
+`include "MicrocontrollerInterface.svh"
+
+/**
+	@brief Decides which frames go to a monitor port
+
+	Runs in the RX clock domain at the head of the monitor path. Sixteen rules each match a filterkey_t under a bit
+	mask; the first enabled rule that matches picks the action, and frames no rule matches get default_action.
+
+	Header fields are picked out of the first 96 bytes as they go by (L3 always starts at byte 14 or 18, so every field
+	sits at a fixed byte lane, same as MonitorTruncator). Once the key is complete the rule table is scanned one row per
+	clock, three rows per rule, 48 clocks in all. Meanwhile the frame waits in the event queue; each start is held
+	until the verdict for that frame is ready.
+
+	Runts get default_action and frames the MAC dropped get FILTER_DROP straight away, without a scan. Those can come
+	in much faster than the scan runs, so every frame's verdict goes through the job queue in order. Full size keys
+	are at least 80 clocks apart (20 bytes of IFG and preamble plus a 60 byte minimum frame), so one waiting key is
+	enough; if a second one does turn up, that frame is dropped.
+
+	A frame in the event queue takes at least two slots, so no more than 32 can be waiting for or holding a verdict.
+	The job and verdict queues are that deep. A frame only starts into the event queue if there's room, and one slot
+	is kept spare so that a frame that fills it partway through can be ended early with a drop. Frames thrown out for
+	lack of room are reported on lost when the MAC commits them, and counted as drops by EthernetAccountedCrossing.
+
+	The rule table is written from the clk_125mhz domain and read asynchronously in the RX domain. A rule being written
+	can be seen half updated for a frame or two, so firmware disables it first.
+
+	Frames that get through the rules are then thinned out by MonitorSampler, if enabled. Rule hit counts include
+	frames the sampler skips.
+
+	A pulse on snapshot copies all of the hit counters and sampler counts at once into the clk_125mhz domain, same as
+	RmonCounters.
+ */
+module MonitorFilter #(
+	parameter SAMPLE_SEED		= 32'h1
+)(
+
+	//Filtered bus
+	input wire					rx_clk,
+	input wire					rst,
+	input wire EthernetRxBus	in_bus,
+	input wire[63:0]			in_timestamp,
+
+	input wire filteraction_t[15:0]	actions,
+	input wire filteraction_t		default_action,
+
+	input wire samplemode_t		sample_mode,
+	input wire[23:0]			sample_rate,
+	input wire[31:0]			sample_threshold,
+
+	output EthernetRxBus		out_bus,
+	output logic				out_truncate	= 0,	//FILTER_TRUNCATE, valid from out_bus.start to the next start
+	output logic[63:0]			out_timestamp	= 0,	//in_timestamp at the start of the frame, same timing
+	output logic				lost			= 0,	//a frame was thrown out because a queue was full
+	output logic[15:0]			lost_len		= 0,	//and how long it was
+
+	//Management interface
+	input wire					clk_125mhz,
+	input wire					rule_wr_en,
+	input wire[5:0]				rule_wr_addr,			//rule * 3 + row
+	input wire[287:0]			rule_wr_data,			//{ value, mask } for one row of filterkey_t
+	input wire					snapshot,
+	input wire					clear,
+	input wire					sample_clear,
+	output filterhits_t			snapshot_data,
+	output samplestats_t		sample_snapshot_data,
+	output wire					snapshot_done
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Event queue
+
+	localparam MIN_FRAME_LEN = 60;
+
+	wire			push	= in_bus.start || in_bus.data_valid || in_bus.commit || in_bus.drop;
+	wire			ending	= in_bus.commit || in_bus.drop;
+
+	(* ram_style = "distributed" *)
+	EthernetRxBus	queue[63:0];
+	logic[5:0]		wr_ptr	= 0;
+	logic[5:0]		rd_ptr	= 0;
+
+	wire EthernetRxBus	head	= queue[rd_ptr];
+	wire				empty	= (wr_ptr == rd_ptr);
+	wire[5:0]			fill	= wr_ptr - rd_ptr;
+
+	//Room for this event with a slot to spare
+	wire			room	= (fill < 62);
+
+	logic			pop;
+
+	//Take a new frame only if both it and its verdict will fit
+	wire			job_room;
+	wire			accept		= in_bus.start && room && job_room;
+
+	//Key overflow (see job queue) for a frame that's still arriving, or one that just ended
+	wire			lose_running;
+	wire			lose_ended;
+
+	logic			discarding	= 0;		//throwing out the rest of the current frame
+	logic			lose		= 0;		//current frame gets reported on lost
+	logic[15:0]		frame_len	= 0;
+	wire[15:0]		cur_len		= (in_bus.start ? 16'h0 : frame_len) + (in_bus.data_valid ? in_bus.bytes_valid : 16'h0);
+
+	//Ends a frame that ran out of room
+	EthernetRxBus	cut_event;
+	always_comb begin
+		cut_event		= 0;
+		cut_event.drop	= 1;
+	end
+
+	always_ff @(posedge rx_clk) begin
+
+		lost	<= 0;
+
+		if(in_bus.start || in_bus.data_valid)
+			frame_len	<= cur_len;
+
+		if(in_bus.start) begin
+			discarding	<= !accept;
+			lose		<= !accept;
+		end
+		if(lose_running)
+			lose		<= 1;
+
+		if(push) begin
+
+			if(accept || (!in_bus.start && !discarding && (ending || room) ) ) begin
+				queue[wr_ptr]	<= in_bus;
+				wr_ptr			<= wr_ptr + 1;
+			end
+
+			//Out of room partway through a frame
+			else if(!in_bus.start && !discarding) begin
+				queue[wr_ptr]	<= cut_event;
+				wr_ptr			<= wr_ptr + 1;
+				discarding		<= 1;
+				lose			<= 1;
+			end
+
+		end
+
+		//Report lost frames once the MAC is done with them, unless it dropped them anyway
+		if(!in_bus.start && in_bus.commit && (lose || lose_running) ) begin
+			lost		<= 1;
+			lost_len	<= cur_len;
+		end
+		if(lose_ended) begin
+			lost		<= 1;
+			lost_len	<= frame_len;
+		end
+
+		if(!in_bus.start && ending) begin
+			discarding	<= 0;
+			lose		<= 0;
+		end
+
+		if(pop)
+			rd_ptr	<= rd_ptr + 1;
+
+		if(rst) begin
+			wr_ptr		<= 0;
+			rd_ptr		<= 0;
+			discarding	<= 0;
+			lose		<= 0;
+			lost		<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Key extraction
+
+	filterkey_t		parse_key;
+	logic[63:0]		parse_timestamp	= 0;
+	logic			parsing			= 0;
+	logic			parse_done		= 0;
+	logic			parse_scan		= 0;		//key needs a rule scan
+	filteraction_t	parse_action	= FILTER_OFF;	//verdict if not
+	logic			parse_ended		= 0;		//frame is over (otherwise parse_done came at word 23)
+
+	logic[4:0]		word_idx		= 0;
+	logic			vlan			= 0;		//802.1Q tag present, everything after it is one word later
+	logic			is_ipv4			= 0;
+	logic			is_ipv6			= 0;
+	logic			has_ports		= 0;
+	logic[4:0]		port_word		= 0;		//word holding the source port (always lane 2)
+
+	initial
+		parse_key	= 0;
+
+	//The start and the first data word can share a cycle
+	wire[4:0]		cur_word	= in_bus.start ? 5'd0 : word_idx;
+
+	//Word index as if there were no VLAN tag
+	wire[4:0]		l3_word		= cur_word - vlan;
+
+	always_ff @(posedge rx_clk) begin
+
+		parse_done	<= 0;
+
+		if(in_bus.start) begin
+			parse_key		<= 0;
+			parse_timestamp	<= in_timestamp;
+			parsing			<= accept;
+			word_idx		<= 0;
+			vlan			<= 0;
+			is_ipv4			<= 0;
+			is_ipv6			<= 0;
+			has_ports		<= 0;
+		end
+
+		if( (parsing || accept) && in_bus.data_valid) begin
+
+			word_idx	<= cur_word + 1;
+
+			//Everything we need is in the first 24 words (IPv4 with maximum options ends at byte 78)
+			if(cur_word == 23) begin
+				parsing		<= 0;
+				parse_done	<= 1;
+				parse_scan	<= 1;
+				parse_ended	<= 0;
+			end
+
+			//Ethernet header
+			case(cur_word)
+				0:	parse_key.dst_mac[47:16]	<= in_bus.data;
+				1: begin
+					parse_key.dst_mac[15:0]		<= in_bus.data[31:16];
+					parse_key.src_mac[47:32]	<= in_bus.data[15:0];
+				end
+				2:	parse_key.src_mac[31:0]		<= in_bus.data;
+				3: begin
+					if(in_bus.data[31:16] == 16'h8100) begin
+						vlan				<= 1;
+						parse_key.vlan		<= { 4'h8, in_bus.data[11:0] };
+					end
+				end
+				default: begin
+				end
+			endcase
+
+			//Ethertype and first two bytes of L3 header
+			if( (l3_word == 3) && !( (cur_word == 3) && (in_bus.data[31:16] == 16'h8100) ) ) begin
+				parse_key.ethertype		<= in_bus.data[31:16];
+
+				if( (in_bus.data[31:16] == 16'h0800) && (in_bus.data[15:12] == 4) ) begin
+					is_ipv4					<= 1;
+					parse_key.ip_version	<= 4;
+					parse_key.src_ip		<= { 80'h0, 16'hffff, 32'h0 };
+					parse_key.dst_ip		<= { 80'h0, 16'hffff, 32'h0 };
+
+					//L4 starts at 14 + 4*IHL, always lane 2
+					port_word				<= 3 + vlan + in_bus.data[11:8];
+				end
+
+				else if( (in_bus.data[31:16] == 16'h86dd) && (in_bus.data[15:12] == 6) ) begin
+					is_ipv6					<= 1;
+					parse_key.ip_version	<= 6;
+
+					//L4 starts at 54, no extension headers
+					port_word				<= 13 + vlan;
+				end
+			end
+
+			//IPv4 header
+			if(is_ipv4) begin
+				case(l3_word)
+
+					//Flags/fragment offset, protocol. Only the first fragment has ports.
+					5: begin
+						parse_key.ip_proto	<= in_bus.data[7:0];
+						has_ports			<=
+							(in_bus.data[28:16] == 0) &&
+							( (in_bus.data[7:0] == 6) || (in_bus.data[7:0] == 17) || (in_bus.data[7:0] == 132) );
+					end
+
+					6:	parse_key.src_ip[31:16]	<= in_bus.data[15:0];
+					7: begin
+						parse_key.src_ip[15:0]	<= in_bus.data[31:16];
+						parse_key.dst_ip[31:16]	<= in_bus.data[15:0];
+					end
+					8:	parse_key.dst_ip[15:0]	<= in_bus.data[31:16];
+
+					default: begin
+					end
+				endcase
+			end
+
+			//IPv6 header
+			if(is_ipv6) begin
+				case(l3_word)
+					5: begin
+						parse_key.ip_proto			<= in_bus.data[31:24];
+						parse_key.src_ip[127:112]	<= in_bus.data[15:0];
+						has_ports					<=
+							(in_bus.data[31:24] == 6) || (in_bus.data[31:24] == 17) || (in_bus.data[31:24] == 132);
+					end
+					6:	parse_key.src_ip[111:80]	<= in_bus.data;
+					7:	parse_key.src_ip[79:48]		<= in_bus.data;
+					8:	parse_key.src_ip[47:16]		<= in_bus.data;
+					9: begin
+						parse_key.src_ip[15:0]		<= in_bus.data[31:16];
+						parse_key.dst_ip[127:112]	<= in_bus.data[15:0];
+					end
+					10:	parse_key.dst_ip[111:80]	<= in_bus.data;
+					11:	parse_key.dst_ip[79:48]		<= in_bus.data;
+					12:	parse_key.dst_ip[47:16]		<= in_bus.data;
+					13:	parse_key.dst_ip[15:0]		<= in_bus.data[31:16];
+
+					default: begin
+					end
+				endcase
+			end
+
+			//TCP/UDP/SCTP ports (has_ports is left over from the last frame during the start cycle)
+			if(has_ports && !in_bus.start) begin
+				if(cur_word == port_word)
+					parse_key.src_port	<= in_bus.data[15:0];
+				if(cur_word == port_word + 1)
+					parse_key.dst_port	<= in_bus.data[31:16];
+			end
+
+		end
+
+		//Short frames: whatever we got is the key. The last data word may come with the commit, so the key is
+		//copied a cycle later. Runts and dropped frames don't need one.
+		if(parsing && ending) begin
+			parsing			<= 0;
+			parse_done		<= 1;
+			parse_scan		<= in_bus.commit && (cur_len >= MIN_FRAME_LEN);
+			parse_action	<= in_bus.drop ? FILTER_DROP : default_action;
+			parse_ended		<= 1;
+		end
+
+		if(rst) begin
+			parsing		<= 0;
+			parse_done	<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Rule table
+
+	(* ram_style = "distributed" *)
+	logic[287:0]	rules[47:0];
+
+	integer i;
+	initial begin
+		for(i=0; i<48; i=i+1)
+			rules[i]	= 0;
+	end
+
+	always_ff @(posedge clk_125mhz) begin
+		if(rule_wr_en)
+			rules[rule_wr_addr]	<= rule_wr_data;
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Job queue: how each frame gets its verdict, in frame order
+
+	(* ram_style = "distributed" *)
+	logic[66:0]		jobs[31:0];					//{ scan, action, timestamp }
+	logic[4:0]		job_wr_ptr		= 0;
+	logic[4:0]		job_rd_ptr		= 0;
+	logic[5:0]		job_fill		= 0;
+
+	//Every frame already in the event queue has its job by the time the next one starts
+	assign			job_room		= (job_fill != 32);
+
+	wire			job_scan		= jobs[job_rd_ptr][66];
+	wire filteraction_t	job_action	= filteraction_t'(jobs[job_rd_ptr][65:64]);
+	wire[63:0]		job_timestamp	= jobs[job_rd_ptr][63:0];
+
+	wire			verdict_room;
+	logic			job_issue;
+
+	//The key for the first scan job in the queue
+	filterkey_t		next_key;
+	logic			key_waiting		= 0;
+
+	initial
+		next_key	= 0;
+
+	wire			key_free		= !key_waiting || (job_issue && job_scan);
+	wire			key_overflow	= parse_done && parse_scan && !key_free;
+
+	assign			lose_running	= key_overflow && !parse_ended;
+	assign			lose_ended		= key_overflow && parse_ended;
+
+	always_ff @(posedge rx_clk) begin
+
+		if(parse_done) begin
+			jobs[job_wr_ptr]	<= { parse_scan && key_free, parse_scan ? FILTER_DROP : parse_action, parse_timestamp };
+			job_wr_ptr			<= job_wr_ptr + 1;
+		end
+
+		if(job_issue)
+			job_rd_ptr	<= job_rd_ptr + 1;
+
+		job_fill	<= job_fill + parse_done - job_issue;
+
+		if(parse_done && parse_scan && key_free) begin
+			next_key	<= parse_key;
+			key_waiting	<= 1;
+		end
+		else if(job_issue && job_scan)
+			key_waiting	<= 0;
+
+		if(rst) begin
+			job_wr_ptr	<= 0;
+			job_rd_ptr	<= 0;
+			job_fill	<= 0;
+			key_waiting	<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Rule evaluation
+
+	filterkey_t		eval_key;
+	logic[63:0]		eval_timestamp	= 0;
+
+	initial
+		eval_key	= 0;
+
+	//Read stage
+	logic			scanning		= 0;
+	logic[3:0]		rd_rule			= 0;
+	logic[1:0]		rd_row			= 0;
+	wire[5:0]		rd_addr			= { rd_rule, 1'b0 } + rd_rule + rd_row;
+
+	//Compare stage
+	logic			cmp_valid		= 0;
+	logic[3:0]		cmp_rule		= 0;
+	logic[1:0]		cmp_row			= 0;
+	logic[287:0]	cmp_entry		= 0;
+	logic[143:0]	cmp_key			= 0;
+
+	wire			row_match		= ( (cmp_entry[287:144] ^ cmp_key) & cmp_entry[143:0] ) == 0;
+
+	logic			rule_match		= 1;	//all rows of the current rule so far
+
+	//Current rule matches (only meaningful on its last row)
+	wire			rule_hit		= rule_match && row_match && (actions[cmp_rule] != FILTER_OFF);
+
+	logic			found			= 0;
+	filteraction_t	found_action	= FILTER_OFF;
+	logic[3:0]		found_rule		= 0;
+
+	//Verdict for the frame just scanned, or skipped
+	logic			verdict_valid	= 0;
+	filteraction_t	verdict_action	= FILTER_OFF;
+	logic			verdict_scanned	= 0;
+	logic			hit_valid		= 0;
+	logic[3:0]		hit_rule		= 0;
+
+	logic			final_valid		= 0;
+
+	//One job at a time, once the last one's verdict is queued
+	always_comb
+		job_issue	= (job_fill != 0) && !scanning && !cmp_valid && !verdict_valid && !final_valid && verdict_room;
+
+	always_ff @(posedge rx_clk) begin
+
+		verdict_valid	<= 0;
+		hit_valid		<= 0;
+
+		if(job_issue) begin
+			eval_timestamp	<= job_timestamp;
+
+			if(job_scan) begin
+				eval_key		<= next_key;
+				scanning		<= 1;
+				rd_rule			<= 0;
+				rd_row			<= 0;
+				found			<= 0;
+				rule_match		<= 1;
+			end
+
+			else begin
+				verdict_valid	<= 1;
+				verdict_action	<= job_action;
+				verdict_scanned	<= 0;
+			end
+		end
+
+		//Read one row
+		cmp_valid	<= scanning;
+		cmp_rule	<= rd_rule;
+		cmp_row		<= rd_row;
+		cmp_entry	<= rules[rd_addr];
+		case(rd_row)
+			0:			cmp_key	<= eval_key[431:288];
+			1:			cmp_key	<= eval_key[287:144];
+			default:	cmp_key	<= eval_key[143:0];
+		endcase
+
+		if(scanning) begin
+			if(rd_row == 2) begin
+				rd_row	<= 0;
+				rd_rule	<= rd_rule + 1;
+				if(rd_rule == 15)
+					scanning	<= 0;
+			end
+			else
+				rd_row	<= rd_row + 1;
+		end
+
+		//Compare it
+		if(cmp_valid) begin
+
+			if(cmp_row != 2)
+				rule_match	<= rule_match && row_match;
+
+			else begin
+				rule_match	<= 1;
+
+				if(!found && rule_hit) begin
+					found			<= 1;
+					found_action	<= actions[cmp_rule];
+					found_rule		<= cmp_rule;
+				end
+
+				//End of the table. The last rule's result isn't in found yet.
+				if(cmp_rule == 15) begin
+					verdict_valid	<= 1;
+					verdict_scanned	<= 1;
+
+					if(found) begin
+						verdict_action	<= found_action;
+						hit_valid		<= 1;
+						hit_rule		<= found_rule;
+					end
+					else if(rule_hit) begin
+						verdict_action	<= actions[cmp_rule];
+						hit_valid		<= 1;
+						hit_rule		<= cmp_rule;
+					end
+					else
+						verdict_action	<= default_action;
+				end
+
+			end
+
+		end
+
+		if(rst) begin
+			scanning		<= 0;
+			cmp_valid		<= 0;
+			verdict_valid	<= 0;
+			hit_valid		<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Sampling, a cycle after the scan (eval_key doesn't change until the next scan starts)
+
+	wire			sample_clear_rx;
+	samplestats_t	sample_stats;
+
+	wire			sample_decide	= verdict_valid && verdict_scanned && (verdict_action != FILTER_DROP);
+	wire			sample_keep;
+
+	MonitorSampler #(
+		.SEED(SAMPLE_SEED)
+	) sampler (
+		.clk(rx_clk),
+		.rst(rst),
+		.mode(sample_mode),
+		.rate(sample_rate),
+		.threshold(sample_threshold),
+		.key(eval_key),
+		.decide(sample_decide),
+		.keep(sample_keep),
+		.clear(sample_clear_rx),
+		.stats(sample_stats)
+		);
+
+	filteraction_t	final_action	= FILTER_OFF;
+	logic[63:0]		final_timestamp	= 0;
+
+	always_ff @(posedge rx_clk) begin
+		final_valid		<= verdict_valid && !rst;
+		final_action	<= (sample_decide && !sample_keep) ? FILTER_DROP : verdict_action;
+		final_timestamp	<= eval_timestamp;
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Verdict queue (a frame can finish arriving before the previous one has left the event queue)
+
+	(* ram_style = "distributed" *)
+	logic[65:0]		verdicts[31:0];
+	logic[4:0]		verdict_wr_ptr	= 0;
+	logic[4:0]		verdict_rd_ptr	= 0;
+	logic[5:0]		verdict_fill	= 0;
+
+	//Only one verdict is ever on its way in (see job_issue)
+	assign			verdict_room	= (verdict_fill != 32);
+
+	wire			verdict_pop;
+
+	wire filteraction_t	next_action		= filteraction_t'(verdicts[verdict_rd_ptr][65:64]);
+	wire[63:0]			next_timestamp	= verdicts[verdict_rd_ptr][63:0];
+
+	always_ff @(posedge rx_clk) begin
+
+		if(final_valid) begin
+			verdicts[verdict_wr_ptr]	<= { final_action, final_timestamp };
+			verdict_wr_ptr				<= verdict_wr_ptr + 1;
+		end
+
+		if(verdict_pop)
+			verdict_rd_ptr	<= verdict_rd_ptr + 1;
+
+		verdict_fill	<= verdict_fill + final_valid - verdict_pop;
+
+		if(rst) begin
+			verdict_wr_ptr	<= 0;
+			verdict_rd_ptr	<= 0;
+			verdict_fill	<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Replay, dropping filtered frames
+
+	logic			dropping	= 0;
+
+	//Each start waits for its verdict
+	assign	verdict_pop	= !empty && head.start && (verdict_fill != 0);
+
+	always_comb begin
+		if(empty)
+			pop	= 0;
+		else if(head.start)
+			pop	= (verdict_fill != 0);
+		else
+			pop	= 1;
+	end
+
+	initial
+		out_bus	= 0;
+
+	always_ff @(posedge rx_clk) begin
+
+		out_bus	<= 0;
+
+		if(pop) begin
+
+			if(head.start) begin
+				dropping		<= (next_action == FILTER_DROP);
+				out_truncate	<= (next_action == FILTER_TRUNCATE);
+				out_timestamp	<= next_timestamp;
+
+				if(next_action != FILTER_DROP)
+					out_bus		<= head;
+			end
+
+			else if(!dropping)
+				out_bus	<= head;
+
+		end
+
+		if(rst) begin
+			out_bus		<= 0;
+			dropping	<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Hit counters and snapshot bank
+
+	wire	snapshot_rx;
+	wire	clear_rx;
+
+	PulseSynchronizer sync_snapshot(
+		.clk_a(clk_125mhz),
+		.pulse_a(snapshot),
+		.clk_b(rx_clk),
+		.pulse_b(snapshot_rx));
+
+	PulseSynchronizer sync_clear(
+		.clk_a(clk_125mhz),
+		.pulse_a(clear),
+		.clk_b(rx_clk),
+		.pulse_b(clear_rx));
+
+	PulseSynchronizer sync_sample_clear(
+		.clk_a(clk_125mhz),
+		.pulse_a(sample_clear),
+		.clk_b(rx_clk),
+		.pulse_b(sample_clear_rx));
+
+	filterhits_t	hits	= 0;
+
+	always_ff @(posedge rx_clk) begin
+		if(hit_valid)
+			hits[hit_rule]	<= hits[hit_rule] + 1;
+
+		if(clear_rx)
+			hits	<= 0;
+	end
+
+	RegisterSynchronizer #(
+		.WIDTH($bits(filterhits_t) + $bits(samplestats_t))
+	) sync_snapshot_data (
+		.clk_a(rx_clk),
+		.en_a(snapshot_rx),
+		.ack_a(),
+		.reg_a({ hits, sample_stats }),
+
+		.clk_b(clk_125mhz),
+		.updated_b(snapshot_done),
+		.reset_b(1'b0),
+		.reg_b({ snapshot_data, sample_snapshot_data })
+	);
+
+endmodule
@@ -0,0 +1,148 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+`include "MicrocontrollerInterface.svh"
+
+/**
+	@brief Picks which frames a monitor port keeps when it can't take them all
+
+	Runs in the RX clock domain as part of MonitorFilter, which asks once per frame the filter lets through (decide)
+	and drops the frame if keep is low in that cycle.
+
+	* SAMPLE_COUNT keeps every rate'th frame.
+	* SAMPLE_RANDOM keeps a frame if a free running LFSR is at or below threshold, i.e. with probability about
+	  (threshold + 1) / 2^32.
+	* SAMPLE_FLOW does the same with a hash of the 5-tuple instead, so every frame of a flow gets the same answer.
+	  Endpoints are put in order before hashing, so both directions of a flow agree as long as both samplers have the
+	  same threshold. Non-IP frames have no flow and are sampled at random.
+
+	key must be stable for three cycles before decide (MonitorFilter holds it for the whole rule scan).
+ */
+module MonitorSampler #(
+	parameter SEED				= 32'h1
+)(
+	input wire					clk,
+	input wire					rst,
+
+	input wire samplemode_t		mode,
+	input wire[23:0]			rate,
+	input wire[31:0]			threshold,
+
+	input wire filterkey_t		key,
+	input wire					decide,
+	output logic				keep,
+
+	//Live counts of kept and skipped frames
+	input wire					clear,
+	output samplestats_t		stats		= 0
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Random source: x^32 + x^22 + x^2 + x + 1, Galois form
+
+	logic[31:0]		lfsr	= SEED;
+
+	always_ff @(posedge clk) begin
+		lfsr	<= { 1'b0, lfsr[31:1] } ^ (lfsr[0] ? 32'h80200003 : 32'h0);
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Flow hash
+
+	function automatic logic[31:0] Fold(input logic[127:0] ip, input logic[15:0] port);
+		return ip[127:96] ^ ip[95:64] ^ ip[63:32] ^ ip[31:0] ^ { 16'h0, port };
+	endfunction
+
+	//CRC-32 of the two folded endpoints, unrolled into one XOR tree per bit
+	function automatic logic[31:0] Crc32(input logic[63:0] data);
+		logic[31:0] crc;
+		crc = 32'hffffffff;
+		for(integer i=63; i>=0; i--)
+			crc = { crc[30:0], 1'b0 } ^ ( (crc[31] ^ data[i]) ? 32'h04c11db7 : 32'h0 );
+		return crc;
+	endfunction
+
+	wire			swap		= { key.src_ip, key.src_port } > { key.dst_ip, key.dst_port };
+
+	logic[31:0]		fold_lo		= 0;
+	logic[31:0]		fold_hi		= 0;
+	logic[31:0]		flow_hash	= 0;
+
+	always_ff @(posedge clk) begin
+		if(swap) begin
+			fold_lo	<= Fold(key.dst_ip, key.dst_port);
+			fold_hi	<= Fold(key.src_ip, key.src_port) ^ { 24'h0, key.ip_proto };
+		end
+		else begin
+			fold_lo	<= Fold(key.src_ip, key.src_port);
+			fold_hi	<= Fold(key.dst_ip, key.dst_port) ^ { 24'h0, key.ip_proto };
+		end
+
+		flow_hash	<= Crc32({ fold_lo, fold_hi });
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Decision
+
+	logic[23:0]		count	= 0;
+
+	always_comb begin
+		case(mode)
+			SAMPLE_COUNT:	keep = (count == 0);
+			SAMPLE_RANDOM:	keep = (lfsr <= threshold);
+			SAMPLE_FLOW:	keep = (key.ip_version == 0) ? (lfsr <= threshold) : (flow_hash <= threshold);
+			default:		keep = 1;
+		endcase
+	end
+
+	always_ff @(posedge clk) begin
+
+		if(decide) begin
+			if( (count + 1) >= rate)
+				count	<= 0;
+			else
+				count	<= count + 1;
+
+			if(keep)
+				stats.kept		<= stats.kept + 1;
+			else
+				stats.skipped	<= stats.skipped + 1;
+		end
+
+		if(clear)
+			stats	<= 0;
+
+		if(rst)
+			count	<= 0;
+
+	end
+
+endmodule
@@ -0,0 +1,209 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+`include "EthernetBus.svh"
+`include "MicrocontrollerInterface.svh"
+
+/**
+	@brief Adds a direction tag to frames headed for a monitor port
+
+	Runs in the RX clock domain, ahead of the monitor path FIFO. Bus events are queued and replayed one per cycle, with
+	extra words slotted in where needed:
+	* MON_TAG_VLAN inserts an 802.1Q tag (PCP/DEI zero) after the source MAC. That's a whole word at a word boundary,
+	  so nothing after it has to be realigned.
+	* MON_TAG_TRAILER appends one byte after the last byte of the frame. The last word is held back until the commit
+	  shows up so we know where the end is.
+
+	The MAC never delivers data words back to back, so the extra cycles are soaked up by the gaps and the queue stays
+	nearly empty.
+ */
+module MonitorTagger(
+	input wire					clk,
+	input wire					rst,
+
+	input wire EthernetRxBus	in_bus,
+
+	input wire montag_t			tag_mode,
+	input wire[11:0]			vlan_id,
+	input wire[7:0]				trailer,
+
+	output EthernetRxBus		out_bus
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Event queue
+
+	//A data word and the commit/drop flag can arrive in the same cycle; split them so each entry is one event
+	EthernetRxBus	in_data;
+	EthernetRxBus	in_end;
+
+	always_comb begin
+		in_data				= in_bus;
+		in_data.commit		= 0;
+		in_data.drop		= 0;
+
+		in_end				= 0;
+		in_end.commit		= in_bus.commit;
+		in_end.drop			= in_bus.drop;
+	end
+
+	wire			push_data	= in_data.start || in_data.data_valid;
+	wire			push_end	= in_end.commit || in_end.drop;
+
+	EthernetRxBus	queue[7:0];
+	logic[2:0]		wr_ptr		= 0;
+	logic[2:0]		rd_ptr		= 0;
+	logic[3:0]		fill		= 0;
+
+	wire EthernetRxBus	head	= queue[rd_ptr];
+	wire EthernetRxBus	next	= queue[rd_ptr + 3'd1];
+
+	logic			pop;
+
+	always_ff @(posedge clk) begin
+
+		if(push_data && push_end) begin
+			queue[wr_ptr]			<= in_data;
+			queue[wr_ptr + 3'd1]	<= in_end;
+			wr_ptr					<= wr_ptr + 2;
+		end
+		else if(push_data) begin
+			queue[wr_ptr]			<= in_data;
+			wr_ptr					<= wr_ptr + 1;
+		end
+		else if(push_end) begin
+			queue[wr_ptr]			<= in_end;
+			wr_ptr					<= wr_ptr + 1;
+		end
+
+		if(pop)
+			rd_ptr	<= rd_ptr + 1;
+
+		fill	<= fill + push_data + push_end - pop;
+
+		if(rst) begin
+			wr_ptr	<= 0;
+			rd_ptr	<= 0;
+			fill	<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Replay with tags added
+
+	//Index of the current data word within the frame (saturating, we only care about the first few)
+	logic[1:0]		word_idx			= 0;
+
+	logic			vlan_pending		= 0;
+	logic			trailer_pending		= 0;
+
+	//Mode is latched at the start of each frame so a config change can't tag half a frame
+	montag_t		frame_mode			= MON_TAG_NONE;
+
+	initial
+		out_bus	= 0;
+
+	always_comb begin
+
+		//Inserted words take priority
+		if(vlan_pending || trailer_pending || (fill == 0))
+			pop = 0;
+
+		//Trailer mode can't send a data word until it knows whether it's the last one
+		else if(head.data_valid && (frame_mode == MON_TAG_TRAILER) && !head.start)
+			pop = (fill >= 2);
+
+		else
+			pop = 1;
+	end
+
+	always_ff @(posedge clk) begin
+
+		out_bus	<= 0;
+
+		if(vlan_pending) begin
+			out_bus.data_valid	<= 1;
+			out_bus.bytes_valid	<= 4;
+			out_bus.data		<= { 16'h8100, 4'h0, vlan_id };
+			vlan_pending		<= 0;
+		end
+
+		else if(trailer_pending) begin
+			out_bus.data_valid	<= 1;
+			out_bus.bytes_valid	<= 1;
+			out_bus.data		<= { trailer, 24'h0 };
+			trailer_pending		<= 0;
+		end
+
+		else if(pop) begin
+			out_bus	<= head;
+
+			if(head.start) begin
+				word_idx	<= 0;
+				frame_mode	<= tag_mode;
+
+				//Start and first data word can share a cycle; the first word never ends a frame, so the trailer
+				//logic doesn't need to see it
+				if(head.data_valid)
+					word_idx	<= 1;
+			end
+
+			else if(head.data_valid) begin
+				if(word_idx != 3)
+					word_idx	<= word_idx + 1;
+
+				//Tag goes in right after the third word (dst MAC, src MAC)
+				if( (frame_mode == MON_TAG_VLAN) && (word_idx == 2) )
+					vlan_pending	<= 1;
+
+				//Last word of the frame: squeeze the trailer in if there's room, otherwise it gets a word of its own
+				if( (frame_mode == MON_TAG_TRAILER) && next.commit ) begin
+					if(head.bytes_valid < 4) begin
+						out_bus.bytes_valid								<= head.bytes_valid + 1;
+						out_bus.data[(3 - head.bytes_valid[1:0])*8 +: 8]	<= trailer;
+					end
+					else
+						trailer_pending	<= 1;
+				end
+			end
+
+		end
+
+		if(rst) begin
+			out_bus			<= 0;
+			vlan_pending	<= 0;
+			trailer_pending	<= 0;
+		end
+
+	end
+
+endmodule
@@ -0,0 +1,158 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+`include "EthernetBus.svh"
+
+/**
+	@brief Appends the arrival time to monitor copies of frames
+
+	timestamp is the TimestampCounter value captured when the MAC started the frame. It's latched here on our own
+	(slightly later) start strobe, and appended after the last byte as 64 bit big endian nanoseconds.
+
+	Same hold-back scheme as MonitorTruncator: the last word waits for the commit so the timestamp can be packed
+	straight after it.
+
+	doc/monitor-trailer.lua describes the complete trailer layout and dissects it in Wireshark.
+ */
+module MonitorTimestamper(
+	input wire					clk,
+	input wire					rst,
+
+	input wire EthernetRxBus	in_bus,
+
+	input wire					enable,
+	input wire[63:0]			timestamp,
+
+	output EthernetRxBus		out_bus
+);
+
+	logic			frame_enable	= 0;
+	logic[63:0]		frame_ts		= 0;
+
+	//Last word of the frame so far
+	logic			held_valid		= 0;
+	logic[2:0]		held_bytes		= 0;
+	logic[31:0]		held_data		= 0;
+
+	//The tail goes out starting the cycle after the commit, so a data word arriving with the commit is already held
+	logic			tail_now		= 0;
+
+	//Held word plus timestamp, left aligned, sent a word at a time
+	logic[95:0]		tail_data		= 0;
+	logic[3:0]		tail_bytes		= 0;
+	logic			tail_active		= 0;
+
+	logic[95:0]		packed_tail;
+
+	always_comb begin
+		packed_tail	= { held_valid ? held_data : 32'h0, 64'h0 };
+		packed_tail[95 - (held_valid ? held_bytes : 3'd0)*8 -: 64]	= frame_ts;
+	end
+
+	initial
+		out_bus	= 0;
+
+	always_ff @(posedge clk) begin
+
+		out_bus		<= 0;
+		tail_now	<= 0;
+
+		//Send out the tail, then the commit
+		if(tail_active) begin
+			if(tail_bytes == 0) begin
+				out_bus.commit		<= 1;
+				tail_active			<= 0;
+			end
+			else begin
+				out_bus.data_valid	<= 1;
+				out_bus.bytes_valid	<= (tail_bytes > 4) ? 3'd4 : tail_bytes[2:0];
+				out_bus.data		<= tail_data[95:64];
+				tail_data			<= { tail_data[63:0], 32'h0 };
+				tail_bytes			<= (tail_bytes > 4) ? (tail_bytes - 4) : 4'd0;
+			end
+		end
+
+		if(in_bus.start) begin
+			out_bus.start	<= 1;
+			frame_enable	<= enable;
+			frame_ts		<= timestamp;
+			held_valid		<= 0;
+		end
+
+		if(in_bus.data_valid) begin
+			if(frame_enable) begin
+				held_valid		<= 1;
+				held_bytes		<= in_bus.bytes_valid;
+				held_data		<= in_bus.data;
+
+				if(held_valid) begin
+					out_bus.data_valid	<= 1;
+					out_bus.bytes_valid	<= held_bytes;
+					out_bus.data		<= held_data;
+				end
+			end
+
+			else begin
+				out_bus.data_valid	<= 1;
+				out_bus.bytes_valid	<= in_bus.bytes_valid;
+				out_bus.data		<= in_bus.data;
+			end
+		end
+
+		if(in_bus.commit) begin
+			if(frame_enable)
+				tail_now		<= 1;
+			else
+				out_bus.commit	<= 1;
+		end
+
+		if(tail_now) begin
+			tail_active	<= 1;
+			tail_data	<= packed_tail;
+			tail_bytes	<= (held_valid ? held_bytes : 0) + 8;
+			held_valid	<= 0;
+		end
+
+		if(in_bus.drop) begin
+			out_bus.drop	<= 1;
+			held_valid		<= 0;
+		end
+
+		if(rst) begin
+			out_bus		<= 0;
+			held_valid	<= 0;
+			tail_now	<= 0;
+			tail_active	<= 0;
+		end
+
+	end
+
+endmodule
@@ -0,0 +1,307 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+`include "EthernetBus.svh"
+
+/**
+	@brief Cuts monitor copies of frames down to a snap length
+
+	Runs in the RX clock domain, ahead of the monitor path FIFO, so truncated frames take up less buffer space as well
+	as less bandwidth. The monitor MAC generates a fresh FCS for whatever comes out.
+
+	snaplen is the number of bytes kept (0 = don't truncate). In header mode the frame is cut at the end of the L4
+	header instead, if that comes first:
+	* TCP, UDP, ICMP and ICMPv6 over IPv4 (with options) or IPv6 (without extension headers), optionally 802.1Q tagged
+	* other IP protocols are cut at the end of the IP header
+	* non-IP frames are only limited by snaplen
+
+	Frames are never cut below 60 bytes, so the monitor MAC won't pad them (which would push the trailer away from
+	the end).
+
+	With add_trailer set, every frame gets two extra bytes at the end: the original length, big endian, not counting
+	FCS.
+
+	force_header turns on header mode for the frame starting this cycle (MonitorFilter's FILTER_TRUNCATE action).
+
+	L3 always starts at byte 14 or 18, so every header field we need sits at a fixed byte lane, and all the word
+	offsets are known one word before they're needed.
+ */
+module MonitorTruncator(
+	input wire					clk,
+	input wire					rst,
+
+	input wire EthernetRxBus	in_bus,
+
+	input wire[15:0]			snaplen,
+	input wire					header_mode,
+	input wire					force_header,
+	input wire					add_trailer,
+
+	output EthernetRxBus		out_bus
+);
+
+	localparam MIN_LEN	= 16'd60;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Header parsing
+
+	logic[15:0]		pos			= 0;		//offset of the first byte in the current word
+	logic[15:0]		orig_len	= 0;		//bytes so far, before truncation
+	logic[15:0]		cut			= 16'hffff;	//bytes to keep
+
+	//Settings are latched at the start of each frame
+	logic			frame_header_mode	= 0;
+	logic			frame_trailer		= 0;
+
+	logic[13:0]		word_idx	= 0;
+	logic			vlan		= 0;		//802.1Q tag present, everything after it is one word later
+	logic			is_ipv4		= 0;
+	logic			is_ipv6		= 0;
+	logic[15:0]		l4_start	= 0;
+	logic[13:0]		tcp_word	= 0;		//word holding the TCP data offset byte (always lane 2)
+	logic			tcp			= 0;
+
+	//Word index as if there were no VLAN tag
+	wire[13:0]		l3_word		= word_idx - vlan;
+	wire[15:0]		l3_start	= vlan ? 16'd18 : 16'd14;
+
+	function automatic logic[15:0] Clamp(input logic[15:0] len, input logic[15:0] limit);
+		logic[15:0] ret;
+		ret = (len < limit) ? len : limit;
+		return (ret < MIN_LEN) ? MIN_LEN : ret;
+	endfunction
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Truncation of the current word
+
+	logic[2:0]		keep_bytes;
+	logic[31:0]		keep_data;
+
+	always_comb begin
+		if(pos >= cut)
+			keep_bytes	= 0;
+		else if( (cut - pos) < in_bus.bytes_valid)
+			keep_bytes	= cut - pos;
+		else
+			keep_bytes	= in_bus.bytes_valid;
+
+		keep_data		= in_bus.data;
+		for(integer i=0; i<4; i++) begin
+			if(i >= keep_bytes)
+				keep_data[(3-i)*8 +: 8]	= 0;
+		end
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Output with optional trailer
+
+	//The last word sent is held back until we know it's the last one, so the trailer can be packed into it
+	logic			held_valid	= 0;
+	logic[2:0]		held_bytes	= 0;
+	logic[31:0]		held_data	= 0;
+
+	//The trailer goes out a cycle after the commit, so the last data word (which may arrive with the commit) has
+	//already been moved into the holding register. Nothing else can show up that soon after a commit.
+	logic			trailer_now	= 0;
+
+	//Leftover trailer bytes and the commit, sent after the frame ends
+	logic			extra_valid	= 0;
+	logic[2:0]		extra_bytes	= 0;
+	logic[31:0]		extra_data	= 0;
+	logic			commit_pending	= 0;
+
+	//Last word followed by the length, left aligned in two words
+	logic[63:0]		packed_tail;
+
+	always_comb begin
+		packed_tail		= { held_data, 32'h0 };
+		if(!held_valid)
+			packed_tail	= { orig_len, 48'h0 };
+		else
+			packed_tail[(8 - held_bytes)*8 - 1 -: 16]	= orig_len;
+	end
+
+	initial
+		out_bus	= 0;
+
+	always_ff @(posedge clk) begin
+
+		out_bus		<= 0;
+		trailer_now	<= 0;
+
+		//Finish off a frame that ended last cycle
+		if(extra_valid) begin
+			out_bus.data_valid	<= 1;
+			out_bus.bytes_valid	<= extra_bytes;
+			out_bus.data		<= extra_data;
+			extra_valid			<= 0;
+		end
+		else if(commit_pending) begin
+			out_bus.commit		<= 1;
+			commit_pending		<= 0;
+		end
+
+		if(in_bus.start) begin
+			out_bus.start		<= 1;
+
+			pos					<= 0;
+			orig_len			<= 0;
+			cut					<= (snaplen == 0) ? 16'hffff : Clamp(snaplen, 16'hffff);
+			frame_header_mode	<= header_mode || force_header;
+			frame_trailer		<= add_trailer;
+
+			word_idx			<= 0;
+			vlan				<= 0;
+			is_ipv4				<= 0;
+			is_ipv6				<= 0;
+			tcp					<= 0;
+			held_valid			<= 0;
+		end
+
+		if(in_bus.data_valid) begin
+			pos			<= pos + in_bus.bytes_valid;
+			orig_len	<= orig_len + in_bus.bytes_valid;
+			word_idx	<= word_idx + 1;
+
+			//Forward whatever is left of the word, holding it back a word if we need to add a trailer
+			if(keep_bytes != 0) begin
+				if(frame_trailer) begin
+					held_valid		<= 1;
+					held_bytes		<= keep_bytes;
+					held_data		<= keep_data;
+
+					if(held_valid) begin
+						out_bus.data_valid	<= 1;
+						out_bus.bytes_valid	<= held_bytes;
+						out_bus.data		<= held_data;
+					end
+				end
+
+				else begin
+					out_bus.data_valid	<= 1;
+					out_bus.bytes_valid	<= keep_bytes;
+					out_bus.data		<= keep_data;
+				end
+			end
+
+			//Look for the end of the L4 header
+			if(frame_header_mode) begin
+
+				//Ethertype, then version/IHL in the same word
+				if( (word_idx == 3) && (in_bus.data[31:16] == 16'h8100) && !vlan)
+					vlan	<= 1;
+				else if(l3_word == 3) begin
+					if( (in_bus.data[31:16] == 16'h0800) && (in_bus.data[15:12] == 4) ) begin
+						is_ipv4		<= 1;
+						l4_start	<= l3_start + { in_bus.data[11:8], 2'b0 };
+					end
+					else if( (in_bus.data[31:16] == 16'h86dd) && (in_bus.data[15:12] == 6) ) begin
+						is_ipv6		<= 1;
+						l4_start	<= l3_start + 16'd40;
+					end
+				end
+
+				//Protocol (byte 9 of the IPv4 header) or next header (byte 6 of the IPv6 header)
+				if(l3_word == 5) begin
+					if(is_ipv4) begin
+						case(in_bus.data[7:0])
+							8'd1, 8'd17:	cut	<= Clamp(l4_start + 16'd8, cut);
+							8'd6: begin
+								tcp			<= 1;
+								tcp_word	<= l4_start[15:2] + 14'd3;
+							end
+							default:		cut	<= Clamp(l4_start, cut);
+						endcase
+					end
+					else if(is_ipv6) begin
+						case(in_bus.data[31:24])
+							8'd17, 8'd58:	cut	<= Clamp(l4_start + 16'd8, cut);
+							8'd6: begin
+								tcp			<= 1;
+								tcp_word	<= l4_start[15:2] + 14'd3;
+							end
+							default:		cut	<= Clamp(l4_start, cut);
+						endcase
+					end
+				end
+
+				//TCP data offset
+				if(tcp && (word_idx == tcp_word)) begin
+					cut	<= Clamp(l4_start + { in_bus.data[15:12], 2'b0 }, cut);
+					tcp	<= 0;
+				end
+
+			end
+		end
+
+		if(in_bus.commit) begin
+			if(frame_trailer)
+				trailer_now		<= 1;
+			else
+				out_bus.commit	<= 1;
+		end
+
+		//Append the original length to the last word, spilling into another word if needed
+		if(trailer_now) begin
+			out_bus.data_valid		<= 1;
+			out_bus.data			<= packed_tail[63:32];
+
+			if(!held_valid)
+				out_bus.bytes_valid	<= 2;
+			else if(held_bytes <= 2)
+				out_bus.bytes_valid	<= held_bytes + 2;
+			else begin
+				out_bus.bytes_valid	<= 4;
+				extra_valid			<= 1;
+				extra_bytes			<= held_bytes - 2;
+				extra_data			<= packed_tail[31:0];
+			end
+
+			held_valid				<= 0;
+			commit_pending			<= 1;
+		end
+
+		if(in_bus.drop) begin
+			out_bus.drop	<= 1;
+			held_valid		<= 0;
+		end
+
+		if(rst) begin
+			out_bus			<= 0;
+			held_valid		<= 0;
+			trailer_now		<= 0;
+			extra_valid		<= 0;
+			commit_pending	<= 0;
+		end
+
+	end
+
+endmodule
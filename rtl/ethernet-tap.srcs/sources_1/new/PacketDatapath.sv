@@ -30,6 +30,7 @@
 ***********************************************************************************************************************/
 
 `include "EthernetBus.svh"
+`include "MicrocontrollerInterface.svh"
 
 module PacketDatapath(
 
@@ -53,9 +54,41 @@ module PacketDatapath(
 	input wire					monA_tx_ready,
 	output EthernetTxBus		monA_tx_bus,
 	input wire					monB_tx_ready,
-	output EthernetTxBus		monB_tx_bus
+	output EthernetTxBus		monB_tx_bus,
+
+	//Monitor path configuration (clk_125mhz domain)
+	input wire moncfg_t			moncfg,
+
+	//Current TimestampCounter value (clk_125mhz domain)
+	input wire[63:0]			timestamp_ns,
+
+	//Overflow statistics for each path (clk_125mhz domain), in pathid order
+	input wire					stats_snapshot,
+	input wire[3:0]				stats_clear,
+	output pathstats_t[3:0]		stats,
+	output wire[3:0]			stats_done,
+
+	//Monitor filter rules, hit counters and sampling counters for each direction (clk_125mhz domain)
+	input wire					filter_wr_en,
+	input wire[5:0]				filter_wr_addr,
+	input wire[287:0]			filter_wr_data,
+	input wire					filter_clear,
+	input wire					sample_clear,
+	output filterhits_t[1:0]	filter_hits,
+	output samplestats_t[1:0]	sample_stats,
+	output wire[1:0]			filter_hits_done
 	);
 
+	//Path indexes for statistics
+	localparam PATH_A_TO_B		= 0;
+	localparam PATH_B_TO_A		= 1;
+	localparam PATH_A_TO_MON	= 2;
+	localparam PATH_B_TO_MON	= 3;
+
+	//Size of the FIFO in each EthernetCrossoverClockCrossing_x8 (see EthernetAccountedCrossing).
+	//Not yet checked against the crossing, so the forwarding path drop counts are only estimates.
+	localparam CROSSING_FIFO_BYTES	= 4096;
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Resets
 
@@ -78,54 +111,357 @@ module PacketDatapath(
 		.clk(portB_rx_clk),
 		.rst_out_n(rst_portB_rx_n));
 
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Monitor config, continuously copied into each RX clock domain
+
+	//Both sides run off the same strobe, so wait for both to finish before sending again
+	logic		moncfg_sync_en		= 0;
+	logic[1:0]	moncfg_sync_busy	= 0;
+	wire		moncfg_sync_ack_a;
+	wire		moncfg_sync_ack_b;
+
+	always_ff @(posedge clk_125mhz) begin
+		moncfg_sync_en	<= 0;
+
+		if(moncfg_sync_ack_a)
+			moncfg_sync_busy[0]	<= 0;
+		if(moncfg_sync_ack_b)
+			moncfg_sync_busy[1]	<= 0;
+
+		if( (moncfg_sync_busy == 0) && !moncfg_sync_en) begin
+			moncfg_sync_en		<= 1;
+			moncfg_sync_busy	<= 2'b11;
+		end
+	end
+
+	moncfg_t	moncfg_portA;
+	moncfg_t	moncfg_portB;
+
+	RegisterSynchronizer #(
+		.WIDTH($bits(moncfg_t))
+	) sync_moncfg_a (
+		.clk_a(clk_125mhz),
+		.en_a(moncfg_sync_en),
+		.ack_a(moncfg_sync_ack_a),
+		.reg_a(moncfg),
+
+		.clk_b(portA_rx_clk),
+		.updated_b(),
+		.reset_b(1'b0),
+		.reg_b(moncfg_portA)
+	);
+
+	RegisterSynchronizer #(
+		.WIDTH($bits(moncfg_t))
+	) sync_moncfg_b (
+		.clk_a(clk_125mhz),
+		.en_a(moncfg_sync_en),
+		.ack_a(moncfg_sync_ack_b),
+		.reg_a(moncfg),
+
+		.clk_b(portB_rx_clk),
+		.updated_b(),
+		.reset_b(1'b0),
+		.reg_b(moncfg_portB)
+	);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Arrival timestamps (captured by MonitorFilter as each frame starts)
+
+	wire[63:0]	timestamp_portA;
+	wire[63:0]	timestamp_portB;
+
+	TimestampSynchronizer sync_timestamp_a(
+		.clk_a(clk_125mhz),
+		.count_a(timestamp_ns),
+		.clk_b(portA_rx_clk),
+		.count_b(timestamp_portA)
+	);
+
+	TimestampSynchronizer sync_timestamp_b(
+		.clk_a(clk_125mhz),
+		.count_a(timestamp_ns),
+		.clk_b(portB_rx_clk),
+		.count_b(timestamp_portB)
+	);
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Forwarding path
 
-	EthernetCrossoverClockCrossing_x8 a_to_b(
+	//Tapped traffic is never held back: these only count what the crossing loses
+	EthernetAccountedCrossing #(
+		.FIFO_BYTES(CROSSING_FIFO_BYTES),
+		.ADMISSION_CONTROL(0)
+	) a_to_b (
 		.rx_clk(portA_rx_clk),
 		.rx_bus(portA_mac_rx_bus),
 		.rx_rst(rst_portA_rx),
+		.frame_queued(),
+		.upstream_drop(1'b0),
+		.upstream_drop_len(16'h0),
 
 		.tx_clk(clk_125mhz),
 		.tx_rst(rst),
 		.tx_ready(portB_tx_ready),
-		.tx_bus(portB_tx_bus)
+		.tx_bus(portB_tx_bus),
+
+		.snapshot(stats_snapshot),
+		.clear(stats_clear[PATH_A_TO_B]),
+		.snapshot_data(stats[PATH_A_TO_B]),
+		.snapshot_done(stats_done[PATH_A_TO_B])
 		);
 
-	EthernetCrossoverClockCrossing_x8 b_to_a(
+	EthernetAccountedCrossing #(
+		.FIFO_BYTES(CROSSING_FIFO_BYTES),
+		.ADMISSION_CONTROL(0)
+	) b_to_a (
 		.rx_clk(portB_rx_clk),
 		.rx_bus(portB_mac_rx_bus),
 		.rx_rst(rst_portB_rx),
+		.frame_queued(),
+		.upstream_drop(1'b0),
+		.upstream_drop_len(16'h0),
 
 		.tx_clk(clk_125mhz),
 		.tx_rst(rst),
 		.tx_ready(portA_tx_ready),
-		.tx_bus(portA_tx_bus)
+		.tx_bus(portA_tx_bus),
+
+		.snapshot(stats_snapshot),
+		.clear(stats_clear[PATH_B_TO_A]),
+		.snapshot_data(stats[PATH_B_TO_A]),
+		.snapshot_done(stats_done[PATH_B_TO_A])
 		);
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	// Monitor path
+	// Filtering, truncation, timestamping, and direction tagging for the monitor path
+
+	EthernetRxBus	portA_filt_rx_bus;
+	EthernetRxBus	portB_filt_rx_bus;
 
-	EthernetCrossoverClockCrossing_x8 a_to_mon(
+	//Filtering holds frames back until the rules have been checked, so the arrival time travels with the frame
+	wire			truncate_portA;
+	wire			truncate_portB;
+	wire[63:0]		start_time_portA;
+	wire[63:0]		start_time_portB;
+
+	//Frames the filters had no room for
+	wire			lost_portA;
+	wire			lost_portB;
+	wire[15:0]		lost_len_portA;
+	wire[15:0]		lost_len_portB;
+
+	MonitorFilter #(
+		.SAMPLE_SEED(32'h1)
+	) filt_a (
 		.rx_clk(portA_rx_clk),
-		.rx_bus(portA_mac_rx_bus),
+		.rst(rst_portA_rx),
+		.in_bus(portA_mac_rx_bus),
+		.in_timestamp(timestamp_portA),
+		.actions(moncfg_portA.filter_action),
+		.default_action(moncfg_portA.filter_default),
+		.sample_mode(moncfg_portA.sample_mode[0]),
+		.sample_rate(moncfg_portA.sample_rate[0]),
+		.sample_threshold(moncfg_portA.sample_threshold[0]),
+		.out_bus(portA_filt_rx_bus),
+		.out_truncate(truncate_portA),
+		.out_timestamp(start_time_portA),
+		.lost(lost_portA),
+		.lost_len(lost_len_portA),
+
+		.clk_125mhz(clk_125mhz),
+		.rule_wr_en(filter_wr_en),
+		.rule_wr_addr(filter_wr_addr),
+		.rule_wr_data(filter_wr_data),
+		.snapshot(stats_snapshot),
+		.clear(filter_clear),
+		.sample_clear(sample_clear),
+		.snapshot_data(filter_hits[0]),
+		.sample_snapshot_data(sample_stats[0]),
+		.snapshot_done(filter_hits_done[0])
+		);
+
+	MonitorFilter #(
+		.SAMPLE_SEED(32'h2c9277b5)
+	) filt_b (
+		.rx_clk(portB_rx_clk),
+		.rst(rst_portB_rx),
+		.in_bus(portB_mac_rx_bus),
+		.in_timestamp(timestamp_portB),
+		.actions(moncfg_portB.filter_action),
+		.default_action(moncfg_portB.filter_default),
+		.sample_mode(moncfg_portB.sample_mode[1]),
+		.sample_rate(moncfg_portB.sample_rate[1]),
+		.sample_threshold(moncfg_portB.sample_threshold[1]),
+		.out_bus(portB_filt_rx_bus),
+		.out_truncate(truncate_portB),
+		.out_timestamp(start_time_portB),
+		.lost(lost_portB),
+		.lost_len(lost_len_portB),
+
+		.clk_125mhz(clk_125mhz),
+		.rule_wr_en(filter_wr_en),
+		.rule_wr_addr(filter_wr_addr),
+		.rule_wr_data(filter_wr_data),
+		.snapshot(stats_snapshot),
+		.clear(filter_clear),
+		.sample_clear(sample_clear),
+		.snapshot_data(filter_hits[1]),
+		.sample_snapshot_data(sample_stats[1]),
+		.snapshot_done(filter_hits_done[1])
+		);
+
+	EthernetRxBus	portA_trunc_rx_bus;
+	EthernetRxBus	portB_trunc_rx_bus;
+
+	MonitorTruncator trunc_a(
+		.clk(portA_rx_clk),
+		.rst(rst_portA_rx),
+		.in_bus(portA_filt_rx_bus),
+		.snaplen(moncfg_portA.snaplen[0]),
+		.header_mode(moncfg_portA.snap_header[0]),
+		.force_header(truncate_portA),
+		.add_trailer(moncfg_portA.snap_trailer[0]),
+		.out_bus(portA_trunc_rx_bus)
+		);
+
+	MonitorTruncator trunc_b(
+		.clk(portB_rx_clk),
+		.rst(rst_portB_rx),
+		.in_bus(portB_filt_rx_bus),
+		.snaplen(moncfg_portB.snaplen[1]),
+		.header_mode(moncfg_portB.snap_header[1]),
+		.force_header(truncate_portB),
+		.add_trailer(moncfg_portB.snap_trailer[1]),
+		.out_bus(portB_trunc_rx_bus)
+		);
+
+	EthernetRxBus	portA_ts_rx_bus;
+	EthernetRxBus	portB_ts_rx_bus;
+
+	MonitorTimestamper ts_a(
+		.clk(portA_rx_clk),
+		.rst(rst_portA_rx),
+		.in_bus(portA_trunc_rx_bus),
+		.enable(moncfg_portA.timestamp),
+		.timestamp(start_time_portA),
+		.out_bus(portA_ts_rx_bus)
+		);
+
+	MonitorTimestamper ts_b(
+		.clk(portB_rx_clk),
+		.rst(rst_portB_rx),
+		.in_bus(portB_trunc_rx_bus),
+		.enable(moncfg_portB.timestamp),
+		.timestamp(start_time_portB),
+		.out_bus(portB_ts_rx_bus)
+		);
+
+	EthernetRxBus	portA_mon_rx_bus;
+	EthernetRxBus	portB_mon_rx_bus;
+
+	MonitorTagger tag_a(
+		.clk(portA_rx_clk),
+		.rst(rst_portA_rx),
+		.in_bus(portA_ts_rx_bus),
+		.tag_mode(moncfg_portA.tag_mode),
+		.vlan_id(moncfg_portA.vlan_id[0]),
+		.trailer(8'h00),
+		.out_bus(portA_mon_rx_bus)
+		);
+
+	MonitorTagger tag_b(
+		.clk(portB_rx_clk),
+		.rst(rst_portB_rx),
+		.in_bus(portB_ts_rx_bus),
+		.tag_mode(moncfg_portB.tag_mode),
+		.vlan_id(moncfg_portB.vlan_id[1]),
+		.trailer(8'h01),
+		.out_bus(portB_mon_rx_bus)
+		);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Monitor path FIFOs
+
+	wire[1:0]		mon_frame_queued_rx;
+	wire[1:0]		mon_frame_queued;
+	wire[1:0]		mon_fifo_ready;
+	EthernetTxBus	mon_fifo_bus[1:0];
+
+	EthernetAccountedCrossing #(
+		.FIFO_BYTES(CROSSING_FIFO_BYTES),
+		.ADMISSION_CONTROL(1)
+	) a_to_mon (
+		.rx_clk(portA_rx_clk),
+		.rx_bus(portA_mon_rx_bus),
 		.rx_rst(rst_portA_rx),
+		.frame_queued(mon_frame_queued_rx[0]),
+		.upstream_drop(lost_portA),
+		.upstream_drop_len(lost_len_portA),
 
 		.tx_clk(clk_125mhz),
 		.tx_rst(rst),
-		.tx_ready(monA_tx_ready),
-		.tx_bus(monA_tx_bus)
+		.tx_ready(mon_fifo_ready[0]),
+		.tx_bus(mon_fifo_bus[0]),
+
+		.snapshot(stats_snapshot),
+		.clear(stats_clear[PATH_A_TO_MON]),
+		.snapshot_data(stats[PATH_A_TO_MON]),
+		.snapshot_done(stats_done[PATH_A_TO_MON])
 		);
 
-	EthernetCrossoverClockCrossing_x8 b_to_mon(
+	EthernetAccountedCrossing #(
+		.FIFO_BYTES(CROSSING_FIFO_BYTES),
+		.ADMISSION_CONTROL(1)
+	) b_to_mon (
 		.rx_clk(portB_rx_clk),
-		.rx_bus(portB_mac_rx_bus),
+		.rx_bus(portB_mon_rx_bus),
 		.rx_rst(rst_portB_rx),
+		.frame_queued(mon_frame_queued_rx[1]),
+		.upstream_drop(lost_portB),
+		.upstream_drop_len(lost_len_portB),
 
 		.tx_clk(clk_125mhz),
 		.tx_rst(rst),
-		.tx_ready(monB_tx_ready),
-		.tx_bus(monB_tx_bus)
+		.tx_ready(mon_fifo_ready[1]),
+		.tx_bus(mon_fifo_bus[1]),
+
+		.snapshot(stats_snapshot),
+		.clear(stats_clear[PATH_B_TO_MON]),
+		.snapshot_data(stats[PATH_B_TO_MON]),
+		.snapshot_done(stats_done[PATH_B_TO_MON])
+		);
+
+	PulseSynchronizer sync_queued_a(
+		.clk_a(portA_rx_clk),
+		.pulse_a(mon_frame_queued_rx[0]),
+		.clk_b(clk_125mhz),
+		.pulse_b(mon_frame_queued[0]));
+
+	PulseSynchronizer sync_queued_b(
+		.clk_a(portB_rx_clk),
+		.pulse_a(mon_frame_queued_rx[1]),
+		.clk_b(clk_125mhz),
+		.pulse_b(mon_frame_queued[1]));
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Monitor port assignment
+
+	EthernetTxBus	mon_tx_bus[1:0];
+	assign			monA_tx_bus	= mon_tx_bus[0];
+	assign			monB_tx_bus	= mon_tx_bus[1];
+
+	MonitorAggregator aggregator(
+		.clk(clk_125mhz),
+		.rst(rst),
+		.aggregate(moncfg.aggregate),
+
+		.frame_queued(mon_frame_queued),
+		.in_ready(mon_fifo_ready),
+		.in_bus(mon_fifo_bus),
+
+		.out_ready({monB_tx_ready, monA_tx_ready}),
+		.out_bus(mon_tx_bus)
 		);
 
 endmodule
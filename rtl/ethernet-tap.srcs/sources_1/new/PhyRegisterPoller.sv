@@ -0,0 +1,136 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@brief Reads a configurable list of registers from each PHY over and over, and keeps the latest values in a
+	shadow RAM the MCU can read in one burst
+
+	The same list of up to NUM_REGS register addresses is polled on every port enabled in port_en. Each port walks
+	the list independently at whatever rate its MDIO bus allows.
+
+	changed goes high for one cycle whenever a shadowed value differs from the previous value in that slot, and
+	changed_ports records which ports saw the change.
+ */
+module PhyRegisterPoller #(
+	parameter NUM_REGS	= 8,
+	parameter SLOT_BITS	= $clog2(NUM_REGS)
+)(
+	input wire							clk,
+
+	//Configuration
+	input wire[3:0]						port_en,
+	input wire[SLOT_BITS:0]				reg_count,
+	input wire[NUM_REGS-1:0][4:0]		reg_addrs,
+
+	//Shadow RAM readback
+	input wire[1:0]						shadow_port,
+	input wire[SLOT_BITS-1:0]			shadow_slot,
+	output wire[15:0]					shadow_data,
+
+	//Change notification
+	output logic						changed			= 0,
+	output logic[3:0]					changed_ports	= 0,
+
+	//Interface to the per-port arbiters
+	output logic[3:0]					poll_req		= 0,
+	output logic[3:0][4:0]				poll_regaddr	= 0,
+	input wire[3:0]						poll_ack,
+	input wire[3:0]						poll_done,
+	input wire[3:0][15:0]				poll_rd_data
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Shadow RAM
+
+	logic[15:0]	shadow[3:0][NUM_REGS-1:0];
+
+	initial begin
+		for(integer i=0; i<4; i++) begin
+			for(integer j=0; j<NUM_REGS; j++)
+				shadow[i][j]	= 0;
+		end
+	end
+
+	assign shadow_data = shadow[shadow_port][shadow_slot];
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Per-port polling
+
+	logic[SLOT_BITS-1:0]	slot[3:0];
+	logic[3:0]				in_flight	= 0;
+
+	initial begin
+		for(integer i=0; i<4; i++)
+			slot[i]	= 0;
+	end
+
+	always_ff @(posedge clk) begin
+
+		changed			<= 0;
+		changed_ports	<= 0;
+
+		for(integer i=0; i<4; i++) begin
+
+			//Request the current slot whenever the port is enabled and nothing is outstanding
+			if(poll_ack[i]) begin
+				poll_req[i]		<= 0;
+				in_flight[i]	<= 1;
+			end
+			else if(port_en[i] && (reg_count != 0) && !in_flight[i] && !poll_req[i]) begin
+				poll_req[i]		<= 1;
+				poll_regaddr[i]	<= reg_addrs[slot[i]];
+			end
+
+			//Save the result and move on to the next slot
+			if(poll_done[i]) begin
+				in_flight[i]	<= 0;
+
+				shadow[i][slot[i]]	<= poll_rd_data[i];
+				if(shadow[i][slot[i]] != poll_rd_data[i]) begin
+					changed				<= 1;
+					changed_ports[i]	<= 1;
+				end
+
+				if(slot[i] + 1 >= reg_count)
+					slot[i]		<= 0;
+				else
+					slot[i]		<= slot[i] + 1;
+			end
+
+			//Drop any request that hasn't been picked up yet if polling is turned off
+			if(!port_en[i] && !poll_ack[i])
+				poll_req[i]		<= 0;
+
+		end
+
+	end
+
+endmodule
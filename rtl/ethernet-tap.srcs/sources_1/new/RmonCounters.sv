@@ -0,0 +1,210 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+`include "EthernetBus.svh"
+`include "MicrocontrollerInterface.svh"
+
+/**
+	@brief RMON style statistics for frames received on one port
+
+	All counters are 64 bits and count in the receive clock domain. Frame lengths are as seen on the MAC bus, i.e.
+	not including preamble or FCS, except for the size histogram (see rmon_bin_t).
+
+	A pulse on snapshot copies every counter and histogram bin at once (in the same rx_clk cycle) and moves the copy
+	into the clk_125mhz domain. snapshot_done pulses when snapshot_data and histogram_data are valid. A pulse on clear
+	zeroes the live counters and histogram.
+ */
+module RmonCounters(
+
+	//Counted bus
+	input wire					rx_clk,
+	input wire EthernetRxBus	rx_bus,
+
+	//Management interface
+	input wire					clk_125mhz,
+	input wire					snapshot,
+	input wire					clear,
+	output rmon_counters_t		snapshot_data,
+	output rmon_histogram_t		histogram_data,
+	output wire					snapshot_done
+);
+
+	//Legal frame sizes without FCS: 60 bytes minimum, 1514 plus a VLAN tag maximum
+	localparam MIN_FRAME_LEN = 60;
+	localparam MAX_FRAME_LEN = 1518;
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Move control strobes into the receive clock domain
+
+	wire	snapshot_rx;
+	wire	clear_rx;
+
+	PulseSynchronizer sync_snapshot(
+		.clk_a(clk_125mhz),
+		.pulse_a(snapshot),
+		.clk_b(rx_clk),
+		.pulse_b(snapshot_rx));
+
+	PulseSynchronizer sync_clear(
+		.clk_a(clk_125mhz),
+		.pulse_a(clear),
+		.clk_b(rx_clk),
+		.pulse_b(clear_rx));
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Per-frame state
+
+	logic[15:0]	frame_len	= 0;
+	logic[1:0]	word_count	= 0;
+	logic		bcast		= 0;
+	logic		mcast		= 0;
+
+	//Length including the current word, in case commit comes in the same cycle as the last data
+	wire[15:0]	frame_len_now	= frame_len + (rx_bus.data_valid ? rx_bus.bytes_valid : 0);
+
+	always_ff @(posedge rx_clk) begin
+
+		if(rx_bus.start) begin
+			frame_len	<= 0;
+			word_count	<= 0;
+			bcast		<= 1;
+			mcast		<= 0;
+		end
+
+		//Destination MAC is the first four bytes of word 0 and the first two of word 1
+		else if(rx_bus.data_valid) begin
+			frame_len	<= frame_len_now;
+
+			if(word_count != 2'h3)
+				word_count	<= word_count + 1;
+
+			if(word_count == 0) begin
+				mcast	<= rx_bus.data[24];
+				if(rx_bus.data != 32'hffffffff)
+					bcast	<= 0;
+			end
+			if( (word_count == 1) && (rx_bus.data[31:16] != 16'hffff) )
+				bcast	<= 0;
+		end
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Counters
+
+	rmon_counters_t	counters	= 0;
+
+	always_ff @(posedge rx_clk) begin
+
+		if(rx_bus.commit) begin
+
+			//Runts and oversize frames only count as errors
+			if( (frame_len_now < MIN_FRAME_LEN) || (frame_len_now > MAX_FRAME_LEN) )
+				counters[RMON_ERRORS]	<= counters[RMON_ERRORS] + 1;
+
+			else begin
+				counters[RMON_FRAMES]		<= counters[RMON_FRAMES] + 1;
+				counters[RMON_BYTES]		<= counters[RMON_BYTES] + frame_len_now;
+
+				if(bcast)
+					counters[RMON_BROADCAST]	<= counters[RMON_BROADCAST] + 1;
+				else if(mcast)
+					counters[RMON_MULTICAST]	<= counters[RMON_MULTICAST] + 1;
+			end
+
+		end
+
+		//Frames the MAC discarded (bad FCS or PHY error)
+		if(rx_bus.drop)
+			counters[RMON_DROPS]		<= counters[RMON_DROPS] + 1;
+
+		if(clear_rx)
+			counters	<= 0;
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Size histogram
+
+	//Size on the wire, including FCS
+	wire[15:0]	wire_len	= frame_len_now + 4;
+
+	rmon_bin_t	bin;
+
+	always_comb begin
+		if( (frame_len_now < MIN_FRAME_LEN) || (frame_len_now > MAX_FRAME_LEN) )
+			bin	= RMON_BIN_BAD_LEN;
+		else if(wire_len == 64)
+			bin	= RMON_BIN_64;
+		else if(wire_len < 128)
+			bin	= RMON_BIN_65_127;
+		else if(wire_len < 256)
+			bin	= RMON_BIN_128_255;
+		else if(wire_len < 512)
+			bin	= RMON_BIN_256_511;
+		else if(wire_len < 1024)
+			bin	= RMON_BIN_512_1023;
+		else if(wire_len < 1519)
+			bin	= RMON_BIN_1024_1518;
+		else
+			bin	= RMON_BIN_1519_MAX;
+	end
+
+	rmon_histogram_t	histogram	= 0;
+
+	always_ff @(posedge rx_clk) begin
+
+		if(rx_bus.commit)
+			histogram[bin]	<= histogram[bin] + 1;
+
+		if(clear_rx)
+			histogram	<= 0;
+
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Snapshot bank
+
+	RegisterSynchronizer #(
+		.WIDTH($bits(rmon_counters_t) + $bits(rmon_histogram_t))
+	) sync_snapshot_data (
+		.clk_a(rx_clk),
+		.en_a(snapshot_rx),
+		.ack_a(),
+		.reg_a({ counters, histogram }),
+
+		.clk_b(clk_125mhz),
+		.updated_b(snapshot_done),
+		.reset_b(1'b0),
+		.reg_b({ snapshot_data, histogram_data })
+	);
+
+endmodule
@@ -126,11 +126,36 @@ module TapTop(
 
 	cfgregs_t cfgregs;
 	wire[15:0]	mdio_rd_data[3:0];
+	wire[3:0]	mdio_busy;
 
 	wire[3:0]		link_up_sync;
 	lspeed_t[3:0]	link_speed_sync;
 	wire[3:0]		link_updated_sync;
 
+	wire			stats_snapshot;
+
+	wire[1:0]		rmon_clear;
+	rmon_counters_t[1:0]	rmon_snapshot_data;
+	rmon_histogram_t[1:0]	rmon_histogram_data;
+	wire[1:0]		rmon_snapshot_done;
+
+	wire[3:0]		path_clear;
+	pathstats_t[3:0]	path_snapshot_data;
+	wire[3:0]		path_snapshot_done;
+
+	wire			timestamp_set_en;
+	wire[63:0]		timestamp_set_value;
+	wire[63:0]		timestamp_ns;
+
+	wire			filter_wr_en;
+	wire[5:0]		filter_wr_addr;
+	wire[287:0]		filter_wr_data;
+	wire			filter_clear;
+	filterhits_t[1:0]	filter_hits;
+	samplestats_t[1:0]	sample_stats;
+	wire[1:0]		filter_hits_done;
+	wire			sample_clear;
+
 	MicrocontrollerInterface mgmt(
 		.clk_50mhz(clk_50mhz),
 		.clk_125mhz(clk_125mhz),
@@ -144,9 +169,44 @@ module TapTop(
 		.mdio_eth1_rd_data(mdio_rd_data[1]),
 		.mdio_eth2_rd_data(mdio_rd_data[2]),
 		.mdio_eth3_rd_data(mdio_rd_data[3]),
+		.mdio_busy(mdio_busy),
 		.link_up(link_up_sync),
 		.link_speed(link_speed_sync),
-		.link_updated(link_updated_sync)
+		.link_updated(link_updated_sync),
+
+		.stats_snapshot(stats_snapshot),
+
+		.rmon_clear(rmon_clear),
+		.rmon_snapshot_data(rmon_snapshot_data),
+		.rmon_histogram_data(rmon_histogram_data),
+		.rmon_snapshot_done(rmon_snapshot_done),
+
+		.path_clear(path_clear),
+		.path_snapshot_data(path_snapshot_data),
+		.path_snapshot_done(path_snapshot_done),
+
+		.timestamp_set_en(timestamp_set_en),
+		.timestamp_set_value(timestamp_set_value),
+		.timestamp_ns(timestamp_ns),
+
+		.filter_wr_en(filter_wr_en),
+		.filter_wr_addr(filter_wr_addr),
+		.filter_wr_data(filter_wr_data),
+		.filter_clear(filter_clear),
+		.filter_hits(filter_hits),
+		.sample_stats(sample_stats),
+		.filter_hits_done(filter_hits_done),
+		.sample_clear(sample_clear)
+	);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Time base for arrival timestamps
+
+	TimestampCounter timestamp(
+		.clk_125mhz(clk_125mhz),
+		.set_en(timestamp_set_en),
+		.set_value(timestamp_set_value),
+		.count_ns(timestamp_ns)
 	);
 
 	//Hook up PHY resets
@@ -318,7 +378,51 @@ module TapTop(
 		.monA_tx_ready(monA_mac_tx_ready),
 		.monA_tx_bus(monA_mac_tx_bus),
 		.monB_tx_ready(monB_mac_tx_ready),
-		.monB_tx_bus(monB_mac_tx_bus)
+		.monB_tx_bus(monB_mac_tx_bus),
+
+		.moncfg(cfgregs.moncfg),
+		.timestamp_ns(timestamp_ns),
+
+		.stats_snapshot(stats_snapshot),
+		.stats_clear(path_clear),
+		.stats(path_snapshot_data),
+		.stats_done(path_snapshot_done),
+
+		.filter_wr_en(filter_wr_en),
+		.filter_wr_addr(filter_wr_addr),
+		.filter_wr_data(filter_wr_data),
+		.filter_clear(filter_clear),
+		.sample_clear(sample_clear),
+		.filter_hits(filter_hits),
+		.sample_stats(sample_stats),
+		.filter_hits_done(filter_hits_done)
+	);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Traffic statistics for each direction through the tap
+
+	RmonCounters rmon_portA(
+		.rx_clk(mac_rx_clk[0]),
+		.rx_bus(portA_mac_rx_bus),
+
+		.clk_125mhz(clk_125mhz),
+		.snapshot(stats_snapshot),
+		.clear(rmon_clear[0]),
+		.snapshot_data(rmon_snapshot_data[0]),
+		.histogram_data(rmon_histogram_data[0]),
+		.snapshot_done(rmon_snapshot_done[0])
+	);
+
+	RmonCounters rmon_portB(
+		.rx_clk(mac_rx_clk[1]),
+		.rx_bus(portB_mac_rx_bus),
+
+		.clk_125mhz(clk_125mhz),
+		.snapshot(stats_snapshot),
+		.clear(rmon_clear[1]),
+		.snapshot_data(rmon_snapshot_data[1]),
+		.histogram_data(rmon_histogram_data[1]),
+		.snapshot_done(rmon_snapshot_done[1])
 	);
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -328,7 +432,6 @@ module TapTop(
 		wire	mdio_tx_en;
 		wire	mdio_tx_data;
 		wire	mdio_rx_data;
-		wire	busy;
 
 		BidirectionalBuffer iobuf(
 			.fabric_in(mdio_rx_data),
@@ -337,7 +440,7 @@ module TapTop(
 			.oe(mdio_tx_en)
 		);
 
-		EthernetMDIOTransceiver txvr(
+		ConfigurableMDIOTransceiver txvr(
 			.clk_125mhz(clk_125mhz),
 			.phy_md_addr(5'b0),
 			.mdio_tx_data(mdio_tx_data),
@@ -345,9 +448,12 @@ module TapTop(
 			.mdio_rx_data(mdio_rx_data),
 			.mdc(mdc[i]),
 
-			.mgmt_busy_fwd(busy),
-			.phy_reg_addr(cfgregs.mdio_regaddr),
-			.phy_wr_data(cfgregs.mdio_wdata),
+			.clk_div(cfgregs.mdio_clkdiv[i]),
+			.preamble_suppress(cfgregs.mdio_preamble_suppress[i]),
+
+			.mgmt_busy_fwd(mdio_busy[i]),
+			.phy_reg_addr(cfgregs.mdio_regaddr[i]),
+			.phy_wr_data(cfgregs.mdio_wdata[i]),
 			.phy_rd_data(mdio_rd_data[i]),
 			.phy_reg_wr(cfgregs.mdio_wr_en[i]),
 			.phy_reg_rd(cfgregs.mdio_rd_en[i])
@@ -0,0 +1,83 @@
+`timescale 1ns / 1ps
+`default_nettype none
+/***********************************************************************************************************************
+*                                                                                                                      *
+* ethernet-tap v0.1                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2023 Andrew D. Zonenberg and contributors                                                              *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@brief Moves a TimestampCounter value into another clock domain
+
+	The count advances by 8 every clock, so bits 63:3 are sent as Gray code: only one bit changes at a time and any
+	value sampled mid-change is either the old or the new count. Bits 2:0 only change when the counter is loaded, and
+	so does everything else at that moment; the first sample or two after a load may be garbage.
+
+	Output lags the source by about three clk_b cycles.
+ */
+module TimestampSynchronizer(
+	input wire			clk_a,
+	input wire[63:0]	count_a,
+
+	input wire			clk_b,
+	output logic[63:0]	count_b	= 0
+);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Source side
+
+	logic[60:0]	gray_a		= 0;
+	logic[2:0]	low_a		= 0;
+
+	always_ff @(posedge clk_a) begin
+		gray_a	<= count_a[63:3] ^ (count_a[63:3] >> 1);
+		low_a	<= count_a[2:0];
+	end
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Destination side
+
+	(* ASYNC_REG = "TRUE" *)
+	logic[63:0]	sync0		= 0;
+
+	(* ASYNC_REG = "TRUE" *)
+	logic[63:0]	sync1		= 0;
+
+	logic[60:0]	binary;
+
+	always_comb begin
+		binary[60]	= sync1[63];
+		for(integer i=59; i>=0; i--)
+			binary[i]	= binary[i+1] ^ sync1[i+3];
+	end
+
+	always_ff @(posedge clk_b) begin
+		sync0	<= { gray_a, low_a };
+		sync1	<= sync0;
+		count_b	<= { binary, sync1[2:0] };
+	end
+
+endmodule